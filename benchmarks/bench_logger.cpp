@@ -0,0 +1,58 @@
+// Benchmarki propusknoy sposobnosti logirovaniya
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include "Logger.h"
+#include "serverlogmodel.h"
+
+static void BM_LoggerLog(benchmark::State& state)
+{
+    Logger logger;
+    const std::string message(static_cast<size_t>(state.range(0)), 'x');
+
+    for (auto _ : state) {
+        logger.log(message, LogType::CHAT);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoggerLog)->Arg(64)->Arg(512)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_ServerLogModelAdd(benchmark::State& state)
+{
+    ServerLogModel model;
+    const QString message(64, QLatin1Char('x'));
+
+    // Partiya - zapisi odnogo kadra pri potoke 50k strok v sekundu
+    int pending = 0;
+    for (auto _ : state) {
+        model.addLogMessage(message, "CHAT", "alice");
+        if (++pending == state.range(0)) {
+            model.flushPendingLogs();
+            pending = 0;
+        }
+    }
+    model.flushPendingLogs();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ServerLogModelAdd)->Arg(1)->Arg(800);
+
+// Smena fil'tra na zapolnennoy modeli: polnyy prokhod i utochnenie po indeksu
+static void BM_ServerLogModelFilter(benchmark::State& state)
+{
+    ServerLogModel model;
+    for (int i = 0; i < state.range(0); ++i) {
+        model.addLogMessage(QString("message %1").arg(i), i % 10 ? "CHAT" : "SYSTEM",
+            QString("user%1").arg(i % 1000));
+    }
+    model.flushPendingLogs();
+
+    for (auto _ : state) {
+        model.filterLogs("user1");
+        model.filterLogs("user12");
+        model.filterLogs(QString());
+        benchmark::DoNotOptimize(model.rowCount());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ServerLogModelFilter)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,26 @@
+// bench_main.cpp : Tochka vkhoda nabora mikrobenchmarkov chat_bench.
+//
+// Zapusk s vyvodom v JSON dlya sravneniya mezhdu relizami:
+//   chat_bench --benchmark_out=chat_bench.json --benchmark_out_format=json
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QTemporaryDir>
+#include <benchmark/benchmark.h>
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Logger i SecurityManager pishut fayly v tekushchiy katalog
+    QTemporaryDir workDir;
+    QDir::setCurrent(workDir.path());
+    QDir().mkpath("logs");
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
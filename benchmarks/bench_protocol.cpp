@@ -0,0 +1,125 @@
+// Benchmarki razbora i serializatsii soobshcheniy
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QVariantMap>
+#include <benchmark/benchmark.h>
+#include "config.h"
+#include "ChatProtocol.h"
+#include "FrameCodec.h"
+#include "Message.h"
+#include "User.h"
+
+namespace {
+
+QString makeText(int length)
+{
+    return QString(length, QLatin1Char('x'));
+}
+
+// Pravdopodobnye stroki chata: povtoryayushchiesya imena, komnaty i slova
+std::string makeChatLine(int index, int length)
+{
+    static const char* words[] = { "privet", "kak", "dela", "vstrecha", "zavtra", "ok",
+        "server", "obnovlenie", "komnata", "segodnya", "spasibo", "gotovo" };
+    std::string line = "user" + std::to_string(index % 200) + " -> #room" + std::to_string(index % 10) + ": ";
+    for (int i = 0; static_cast<int>(line.size()) < length; ++i) {
+        line += words[(index * 7 + i * 3) % 12];
+        line += ' ';
+    }
+    line.back() = '\n';
+    return line;
+}
+
+} // namespace
+
+static void BM_FormatChatLine(benchmark::State& state)
+{
+    const QString text = makeText(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(formatChatLine("alice", "bob", text));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(QChar));
+}
+BENCHMARK(BM_FormatChatLine)->Arg(16)->Arg(256)->Arg(MESSAGE_MAX_LENGTH);
+
+static void BM_ParseChatLine(benchmark::State& state)
+{
+    const QString line = formatChatLine("alice", "bob", makeText(static_cast<int>(state.range(0))));
+    ChatLine parsed;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parseChatLine(line, parsed));
+    }
+    state.SetBytesProcessed(state.iterations() * line.size() * sizeof(QChar));
+}
+BENCHMARK(BM_ParseChatLine)->Arg(16)->Arg(256)->Arg(MESSAGE_MAX_LENGTH);
+
+// Szhatie odnogo kadra: (dlina stroki, 1 - s obuchennym slovarem).
+// compression_ratio - dolya baytov na provode ot iskhodnogo razmera.
+static void BM_EncodeFrameBlock(benchmark::State& state)
+{
+    const int length = static_cast<int>(state.range(0));
+    DictionaryPtr dictionary;
+    if (state.range(1) != 0) {
+        std::vector<std::string> samples;
+        for (int i = 0; i < 2000; ++i)
+            samples.push_back(makeChatLine(i, 40 + i % 200));
+        auto trained = std::make_shared<CompressionDictionary>();
+        if (!trained->load(CompressionDictionary::train(samples))) {
+            state.SkipWithError("zstd nedostupen");
+            return;
+        }
+        dictionary = trained;
+    }
+
+    FrameEncoder encoder(dictionary, 0);
+    std::vector<std::string> lines;
+    for (int i = 0; i < 64; ++i)
+        lines.push_back(makeChatLine(i + 5000, length));
+
+    std::string out;
+    size_t input = 0;
+    size_t output = 0;
+    size_t index = 0;
+    for (auto _ : state) {
+        const std::string& line = lines[index++ % lines.size()];
+        out.clear();
+        encoder.encodeBlock(line.data(), line.size(), out);
+        input += line.size();
+        output += out.size();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(input));
+    state.counters["compression_ratio"] = input ? static_cast<double>(output) / input : 0.0;
+}
+BENCHMARK(BM_EncodeFrameBlock)->Args({ 64, 0 })->Args({ 64, 1 })->Args({ 256, 0 })->Args({ 256, 1 })
+    ->Args({ MESSAGE_MAX_LENGTH, 0 })->Args({ MESSAGE_MAX_LENGTH, 1 });
+
+static void BM_MessageToJson(benchmark::State& state)
+{
+    User* sender = new User();
+    sender->setUsername("alice");
+    Message message("1", sender, makeText(static_cast<int>(state.range(0))), "bob", Message::PrivateMessage);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(QJsonDocument(message.toJson()).toJson(QJsonDocument::Compact));
+    }
+}
+BENCHMARK(BM_MessageToJson)->Arg(16)->Arg(256)->Arg(MESSAGE_MAX_LENGTH);
+
+static void BM_MessageFromMap(benchmark::State& state)
+{
+    QVariantMap map;
+    map["id"] = "1";
+    map["sender"] = "alice";
+    map["timestamp"] = "2024-01-01T12:00:00";
+    map["content"] = makeText(static_cast<int>(state.range(0)));
+    map["isRead"] = false;
+    map["recipient"] = "bob";
+    map["type"] = "private";
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Message::fromMap(map).getId());
+    }
+}
+BENCHMARK(BM_MessageFromMap)->Arg(16)->Arg(256)->Arg(MESSAGE_MAX_LENGTH);
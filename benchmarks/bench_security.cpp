@@ -0,0 +1,118 @@
+// Benchmarki autentifikatsii na bol'shikh spiskakh pol'zovateley
+
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <benchmark/benchmark.h>
+#include "Logger.h"
+#include "PasswordHasher.h"
+#include "Sha256MultiBuffer.h"
+#include "Security.h"
+
+namespace {
+
+// Fayl USERS_FILE s count zapisyami; SecurityManager chitaet ego v konstruktore.
+// Zapisi s parametrami po umolchaniyu, chtoby vkhod ne vyzyval perekheshirovanie.
+void writeUsersFile(int count, const QString& password)
+{
+    QString hash = QString::fromStdString(PasswordHasher().hash(password.toStdString()));
+
+    QDir().mkpath(DATA_DIR);
+    QFile file(USERS_FILE);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
+    QTextStream out(&file);
+    for (int i = 0; i < count; ++i) {
+        out << "user" << i << ":" << hash << "\n";
+    }
+}
+
+} // namespace
+
+static void BM_AuthenticateUser(benchmark::State& state)
+{
+    const int userCount = static_cast<int>(state.range(0));
+    writeUsersFile(userCount, "password");
+
+    Logger logger;
+    SecurityManager security(&logger);
+
+    // Khudshiy sluchay - posledniy pol'zovatel' v spiske
+    const QString username = QString("user%1").arg(userCount - 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(security.authenticateUser(username, "password"));
+    }
+    state.SetLabel(std::to_string(userCount) + " users");
+}
+BENCHMARK(BM_AuthenticateUser)->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+// Proverki parolya v sekundu na yadro: (algoritm, stoimost') pri 1..8 potokakh.
+// Dlya scrypt stoimost' - N (pamyat' 128 * r * N bayt), dlya PBKDF2 - chislo iteratsiy.
+static void BM_VerifyPassword(benchmark::State& state)
+{
+    PasswordHasher::Params params = PasswordHasher::defaultParams();
+    params.algorithm = static_cast<PasswordHasher::Algorithm>(state.range(0));
+    if (params.algorithm == PasswordHasher::SCRYPT)
+        params.scryptN = static_cast<uint32_t>(state.range(1));
+    else
+        params.iterations = static_cast<uint32_t>(state.range(1));
+
+    PasswordHasher hasher(params);
+    const std::string record = hasher.hash("password");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hasher.verify(record, "password"));
+    }
+    state.counters["verify_per_core"] = benchmark::Counter(static_cast<double>(state.iterations()),
+        benchmark::Counter::kIsRate | benchmark::Counter::kAvgThreads);
+}
+BENCHMARK(BM_VerifyPassword)
+    ->Args({ PasswordHasher::SCRYPT, 4096 })
+    ->Args({ PasswordHasher::SCRYPT, 16384 })
+    ->Args({ PasswordHasher::SCRYPT, 65536 })
+    ->Args({ PasswordHasher::PBKDF2_SHA256, 100000 })
+    ->Args({ PasswordHasher::PBKDF2_SHA256, 600000 })
+    ->ThreadRange(1, 8)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Vosstanovlenie posle restarta: 64 vkhoda odnim paketom protiv posledovatel'noy
+// proverki. PBKDF2 schitaetsya mnogobufernym SHA-256 (yadro vybiraetsya pri
+// zapuske); scrypt s parametrami po umolchaniyu proveryaetsya po odnoy zapisi,
+// i eta para pokazyvaet, chto v konfiguratsii po umolchaniyu paket ne uskoryaet vkhod
+static void BM_VerifyPasswordBatch(benchmark::State& state)
+{
+    PasswordHasher::Params params = PasswordHasher::defaultParams();
+    params.algorithm = static_cast<PasswordHasher::Algorithm>(state.range(2));
+    if (params.algorithm == PasswordHasher::PBKDF2_SHA256)
+        params.iterations = 100000;
+    PasswordHasher hasher(params);
+
+    const size_t batchSize = static_cast<size_t>(state.range(0));
+    const bool batched = state.range(1) != 0;
+    std::vector<std::string> records;
+    std::vector<std::string> passwords;
+    for (size_t i = 0; i < batchSize; ++i) {
+        passwords.push_back("password" + std::to_string(i));
+        records.push_back(hasher.hash(passwords.back()));
+    }
+
+    for (auto _ : state) {
+        if (batched) {
+            benchmark::DoNotOptimize(hasher.verifyBatch(records, passwords));
+        }
+        else {
+            for (size_t i = 0; i < batchSize; ++i)
+                benchmark::DoNotOptimize(hasher.verify(records[i], passwords[i]));
+        }
+    }
+    state.counters["verify_per_core"] = benchmark::Counter(static_cast<double>(state.iterations() * batchSize),
+        benchmark::Counter::kIsRate | benchmark::Counter::kAvgThreads);
+    std::string algorithm = params.algorithm == PasswordHasher::SCRYPT ? "scrypt " : "pbkdf2 ";
+    state.SetLabel(algorithm + (batched ? Sha256MultiBuffer::kernelName() : "sequential"));
+}
+BENCHMARK(BM_VerifyPasswordBatch)
+    ->Args({ 64, 0, PasswordHasher::PBKDF2_SHA256 })
+    ->Args({ 64, 1, PasswordHasher::PBKDF2_SHA256 })
+    ->Args({ 64, 0, PasswordHasher::SCRYPT })
+    ->Args({ 64, 1, PasswordHasher::SCRYPT })
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
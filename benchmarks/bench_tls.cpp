@@ -0,0 +1,154 @@
+// Benchmarki rukopozhatiya TLS po loopback: polnoe i s vozobnovleniem sessii.
+//
+// Nuzhny sertifikat i klyuch servera v formate PEM:
+//   CHAT_BENCH_TLS_CERT=cert.pem CHAT_BENCH_TLS_KEY=privkey.pem chat_bench --benchmark_filter=Tls
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSslSocket>
+#include <QTimer>
+#include <functional>
+#include <benchmark/benchmark.h>
+#include "chattcpserver.h"
+
+namespace {
+
+// Obrabotka sobytiy, poka ne vypolneno uslovie (ne dol'she 5 s)
+bool spinUntil(const std::function<bool()>& done)
+{
+    QTimer wake;
+    wake.start(100);
+    QElapsedTimer timer;
+    timer.start();
+    while (!done()) {
+        if (timer.elapsed() > 5000)
+            return false;
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    return true;
+}
+
+// Odno rukopozhatie do pervogo bayta ot servera. Bilet novoy sessii
+// sokhranyaetsya v configuration, esli keepTicket
+bool handshake(ChatTcpServer& server, QSslConfiguration& configuration, bool keepTicket,
+    QSsl::SslProtocol& protocol)
+{
+    QSslSocket client;
+    client.setSslConfiguration(configuration);
+    client.connectToHostEncrypted("127.0.0.1", server.serverPort());
+
+    QSslSocket* peer = nullptr;
+    bool ok = spinUntil([&]() {
+        if (!peer)
+            peer = qobject_cast<QSslSocket*>(server.nextPendingConnection());
+        return (peer && peer->isEncrypted() && client.isEncrypted())
+            || client.state() == QAbstractSocket::UnconnectedState;
+    });
+    if (ok && peer && peer->isEncrypted()) {
+        peer->write("\n");
+        ok = spinUntil([&]() {
+            return client.bytesAvailable() > 0 || client.state() == QAbstractSocket::UnconnectedState;
+        }) && client.bytesAvailable() > 0;
+    }
+    else {
+        ok = false;
+    }
+
+    if (ok) {
+        protocol = client.sessionProtocol();
+        if (keepTicket)
+            configuration.setSessionTicket(client.sslConfiguration().sessionTicket());
+    }
+    client.abort();
+    delete peer;
+    return ok;
+}
+
+} // namespace
+
+// Rukopozhatiy v sekundu: 0 - polnoe, 1 - po biletu predydushchey sessii.
+// Schitaetsya do gotovnosti obeikh storon i pervogo bayta ot servera,
+// k etomu momentu klient uzhe poluchil bilet TLS 1.3.
+// V rezhime 1 vozobnovlenie proveryaetsya: klient dolzhen poluchat' bilety,
+// a rukopozhatie s biletom - idti zametno bystree polnogo (bez podpisi
+// sertifikatom). Inache, naprimer pri sborke bez CHAT_SHARED_SSL_CONTEXT,
+// bilet ne prinimaetsya i benchmark zavershaetsya oshibkoy.
+static void BM_TlsHandshake(benchmark::State& state)
+{
+    const bool resume = state.range(0) != 0;
+
+    ChatTcpServer server;
+    if (!server.enableTls(QString::fromLocal8Bit(qgetenv("CHAT_BENCH_TLS_CERT")),
+            QString::fromLocal8Bit(qgetenv("CHAT_BENCH_TLS_KEY")))) {
+        state.SkipWithError("Nuzhny CHAT_BENCH_TLS_CERT i CHAT_BENCH_TLS_KEY");
+        return;
+    }
+    if (!server.listen(QHostAddress::LocalHost, 0)) {
+        state.SkipWithError("Ne udalos' otkryt' port");
+        return;
+    }
+
+    QSslConfiguration configuration = QSslConfiguration::defaultConfiguration();
+    configuration.setPeerVerifyMode(QSslSocket::VerifyNone);
+    configuration.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+
+    // Srednee vremya polnogo rukopozhatiya - etalon dlya proverki vozobnovleniya
+    QSsl::SslProtocol protocol = QSsl::UnknownProtocol;
+    double fullSeconds = 0;
+    if (resume) {
+        const int samples = 16;
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < samples; ++i) {
+            QSslConfiguration fresh = configuration;
+            if (!handshake(server, fresh, false, protocol)) {
+                state.SkipWithError("Polnoe rukopozhatie ne udalos'");
+                return;
+            }
+        }
+        fullSeconds = timer.nsecsElapsed() / 1e9 / samples;
+    }
+
+    int64_t failures = 0;
+    int64_t offered = 0;
+    QElapsedTimer resumedTimer;
+    qint64 resumedNs = 0;
+    for (auto _ : state) {
+        const bool withTicket = !configuration.sessionTicket().isEmpty();
+        if (withTicket) {
+            ++offered;
+            resumedTimer.start();
+        }
+        if (!handshake(server, configuration, resume, protocol))
+            ++failures;
+        if (withTicket)
+            resumedNs += resumedTimer.nsecsElapsed();
+    }
+
+    state.counters["handshakes_per_s"] = benchmark::Counter(
+        static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+    state.counters["failures"] = static_cast<double>(failures);
+
+    QString label = resume ? "resumed" : "full";
+    if (protocol == QSsl::TlsV1_3)
+        label += " TLS 1.3";
+    else if (protocol == QSsl::TlsV1_2)
+        label += " TLS 1.2";
+    state.SetLabel(label.toStdString());
+
+    // Pervoe rukopozhatie tsikla vsegda polnoe, ostal'nye dolzhny idti s biletom
+    if (resume && state.iterations() > 1) {
+        if (offered == 0) {
+            state.SkipWithError("Server ne vydal bilet sessii, vozobnovlenie ne rabotaet");
+            return;
+        }
+        const double resumedSeconds = resumedNs / 1e9 / offered;
+        state.counters["full_over_resumed"] = fullSeconds / resumedSeconds;
+        if (resumedSeconds > fullSeconds * 0.8) {
+            state.SkipWithError(ChatTcpServer::sharesSslContext()
+                ? "Rukopozhatie s biletom ne bystree polnogo, bilet ne prinyat"
+                : "Sborka bez CHAT_SHARED_SSL_CONTEXT, bilety ne prinimayutsya");
+        }
+    }
+}
+BENCHMARK(BM_TlsHandshake)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond)->UseRealTime();
@@ -0,0 +1,51 @@
+// Benchmarki spiska pol'zovateley administratora
+
+#include <benchmark/benchmark.h>
+#include <QString>
+#include "serveruserlistmodel.h"
+#include "serveruserproxymodel.h"
+
+// Vkhod i vykhod pol'zovateley pri zapolnennom spiske
+static void BM_UserListChurn(benchmark::State& state)
+{
+    ServerUserListModel model;
+    const int users = static_cast<int>(state.range(0));
+    for (int i = 0; i < users; ++i)
+        model.addUser(ServerUser(QString("user%1").arg(i), "10.0.0.1"));
+
+    int next = 0;
+    for (auto _ : state) {
+        QString nickname = QString("user%1").arg(next % users);
+        model.removeUser(nickname);
+        model.addUser(ServerUser(nickname, "10.0.0.2"));
+        model.banUser(nickname);
+        ++next;
+    }
+    model.flushChanges();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UserListChurn)->Arg(1000)->Arg(100000);
+
+// Ta zhe nagruzka cherez sortiruyushchiy proksi s fil'trom po prefiksu
+static void BM_UserProxyChurn(benchmark::State& state)
+{
+    ServerUserListModel model;
+    ServerUserProxyModel proxy;
+    proxy.setSourceModel(&model);
+    proxy.setNicknamePrefix("user1");
+
+    const int users = static_cast<int>(state.range(0));
+    for (int i = 0; i < users; ++i)
+        model.addUser(ServerUser(QString("user%1").arg(i), "10.0.0.1"));
+
+    int next = 0;
+    for (auto _ : state) {
+        QString nickname = QString("user%1").arg(next % users);
+        model.removeUser(nickname);
+        model.addUser(ServerUser(nickname, "10.0.0.2"));
+        model.flushChanges();
+        ++next;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UserProxyChurn)->Arg(1000)->Arg(100000);
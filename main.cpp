@@ -9,6 +9,7 @@
 #include "SecurityManager.h"
 #include "ServerMainWindow.h"
 #include "ClientMainWindow.h"
+#include "MessageJournal.h"
 using namespace std;
 
 // Global'nye ob"ekty prilozheniya
@@ -39,6 +40,18 @@ int main(int argc, char* argv[])
         serverWindow->show();
     }
     else {
+        chatManager.setLogger(&logger);
+        chatManager.setNetwork(&networkManager);
+        chatManager.setSecurity(&securityManager);
+
+        // Zhurnal prinyatykh soobshcheniy: istoriya vosstanavlivaetsya do
+        // pokaza okna, bez zhurnala klient rabotaet kak ran'she
+        static MessageJournal journal(&logger);
+        if (journal.open()) {
+            chatManager.setJournal(&journal);
+            chatManager.restoreFromJournal();
+        }
+
         // Zapusk klientskoj chasti
         ClientMainWindow* clientWindow = ClientMainWindow::createClient();
         if (clientWindow) {
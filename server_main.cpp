@@ -0,0 +1,193 @@
+﻿// server_main.cpp : Tochka vkhoda servera bez graficheskogo interfeysa.
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <QTimer>
+#include <atomic>
+#include <csignal>
+#include "config.h"
+#include "Logger.h"
+#include "Security.h"
+#include "BanList.h"
+#include "servermanager.h"
+#include "metricsendpoint.h"
+#include "TraceRecorder.h"
+#include "FrameCodec.h"
+
+namespace {
+
+// Flag ostanovki, vystavlyaemyy obrabotchikom signalov
+std::atomic<bool> stopRequested(false);
+
+void handleStopSignal(int)
+{
+    stopRequested = true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("chat-server");
+    QCoreApplication::setApplicationVersion(APP_VERSION);
+
+    // Razbor argumentov: -port <nomer>, -metrics-port <nomer> (0 - bez metrik)
+    const QStringList args = app.arguments();
+    auto portArgument = [&](const QString& name, quint16 defaultPort) {
+        int index = args.indexOf(name);
+        if (index != -1 && index + 1 < args.size()) {
+            bool ok = false;
+            quint16 value = args.at(index + 1).toUShort(&ok);
+            if (ok)
+                return value;
+        }
+        return defaultPort;
+    };
+    quint16 port = portArgument("-port", SERVER_PORT);
+    quint16 metricsPort = portArgument("-metrics-port", METRICS_PORT);
+
+    // -trace <N>: zapis' kazhdogo N-go dereva intervalov (nuzhna sborka s CHAT_ENABLE_TRACING)
+    int traceIndex = args.indexOf("-trace");
+    if (traceIndex != -1 && traceIndex + 1 < args.size()) {
+        uint sampleRate = args.at(traceIndex + 1).toUInt();
+        if (sampleRate > 0) {
+            TraceRecorder::instance().setSampleRate(sampleRate);
+            TraceRecorder::instance().setEnabled(true);
+            TraceRecorder::instance().setThreadName("main");
+        }
+    }
+
+    // -train-dictionary <fayl>: obuchenie slovarya szhatiya po strokam fayla
+    // (naprimer, vygruzke istorii) i zapis' v COMPRESSION_DICTIONARY_FILE
+    int trainIndex = args.indexOf("-train-dictionary");
+    if (trainIndex != -1 && trainIndex + 1 < args.size()) {
+        QFile samplesFile(args.at(trainIndex + 1));
+        if (!samplesFile.open(QIODevice::ReadOnly))
+            return 1;
+        std::vector<std::string> samples;
+        while (!samplesFile.atEnd())
+            samples.push_back(samplesFile.readLine().toStdString());
+
+        std::string dictionary = CompressionDictionary::train(samples);
+        QDir().mkpath(DATA_DIR);
+        QFile output(COMPRESSION_DICTIONARY_FILE);
+        if (dictionary.empty() || !output.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return 1;
+        output.write(dictionary.data(), static_cast<qint64>(dictionary.size()));
+        return 0;
+    }
+
+    // -add-user <imya> <parol'>: registratsiya uchetnoy zapisi v USERS_FILE;
+    // -add-users <prefiks> <N> <parol'>: zapisi <prefiks>0..<prefiks>N-1 dlya chat-loadgen.
+    // Vypolnyaetsya pri ostanovlennom servere: rabotayushchiy perezapishet fayl svoim spiskom
+    int addUserIndex = args.indexOf("-add-user");
+    int addUsersIndex = args.indexOf("-add-users");
+    if (addUserIndex != -1 || addUsersIndex != -1) {
+        QStringList usernames;
+        QString password;
+        if (addUserIndex != -1 && addUserIndex + 2 < args.size()) {
+            usernames << args.at(addUserIndex + 1);
+            password = args.at(addUserIndex + 2);
+        }
+        else if (addUsersIndex != -1 && addUsersIndex + 3 < args.size()) {
+            bool ok = false;
+            int count = args.at(addUsersIndex + 2).toInt(&ok);
+            if (!ok || count <= 0)
+                return 1;
+            for (int i = 0; i < count; ++i)
+                usernames << args.at(addUsersIndex + 1) + QString::number(i);
+            password = args.at(addUsersIndex + 3);
+        }
+        else {
+            return 1;
+        }
+
+        Logger logger;
+        SecurityManager security(&logger);
+        return security.registerUsers(usernames, password) > 0 ? 0 : 1;
+    }
+
+    // -ban-user <imya>, -unban-user <imya>, -ban-subnet <podset'>, -unban-subnet <podset'>:
+    // izmenenie BAN_LIST_FILE. Zapushchennyy server perechityvaet fayl
+    // i otklyuchaet sessii, popavshie pod ban
+    const QStringList banOptions = { "-ban-user", "-unban-user", "-ban-subnet", "-unban-subnet" };
+    for (const QString& option : banOptions) {
+        int index = args.indexOf(option);
+        if (index == -1)
+            continue;
+        if (index + 1 >= args.size())
+            return 1;
+
+        QDir().mkpath(DATA_DIR);
+        BanList bans;
+        bans.load();
+        const std::string value = args.at(index + 1).toStdString();
+        bool changed = option == "-ban-user" ? bans.banUser(value)
+            : option == "-unban-user" ? bans.unbanUser(value)
+            : option == "-ban-subnet" ? bans.banSubnet(value)
+            : bans.unbanSubnet(value);
+        return changed ? 0 : 1;
+    }
+
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+
+    ServerManager server;
+
+    // -max-per-address <N>, -address-rate <v sekundu>[:<vsplesk>]: limity na
+    // adres i podset'. chat-loadgen otkryvaet vse soedineniya s 127.0.0.1,
+    // pri znacheniyakh po umolchaniyu ego klienty otklonyayutsya i ogranichivayutsya
+    int perAddressIndex = args.indexOf("-max-per-address");
+    if (perAddressIndex != -1 && perAddressIndex + 1 < args.size()) {
+        bool ok = false;
+        uint value = args.at(perAddressIndex + 1).toUInt(&ok);
+        if (!ok || value == 0)
+            return 1;
+        AdmissionController::Limits limits = server.admissionController().getLimits();
+        limits.maxPerAddress = value;
+        limits.maxConnections = qMax<size_t>(limits.maxConnections, value);
+        server.admissionController().setLimits(limits);
+    }
+    int addressRateIndex = args.indexOf("-address-rate");
+    if (addressRateIndex != -1 && addressRateIndex + 1 < args.size()) {
+        const QStringList parts = args.at(addressRateIndex + 1).split(':');
+        bool rateOk = false;
+        bool burstOk = true;
+        RatePolicy policy;
+        policy.ratePerSecond = parts.at(0).toUInt(&rateOk);
+        policy.burst = parts.size() > 1 ? parts.at(1).toUInt(&burstOk) : policy.ratePerSecond * 2;
+        if (!rateOk || !burstOk || policy.ratePerSecond == 0 || policy.burst == 0)
+            return 1;
+        server.rateLimiter().setPolicy(RateLimiter::ADDRESS_SCOPE, policy);
+    }
+
+    // -tls [-cert <fayl>] [-key <fayl>]: shifrovanie soedineniy klientov
+    if (args.contains("-tls")) {
+        auto fileArgument = [&](const QString& name, const QString& defaultFile) {
+            int index = args.indexOf(name);
+            return index != -1 && index + 1 < args.size() ? args.at(index + 1) : defaultFile;
+        };
+        if (!server.enableTls(fileArgument("-cert", SSL_CERT_FILE), fileArgument("-key", SSL_KEY_FILE)))
+            return 1;
+    }
+    server.startServer(port);
+
+    MetricsEndpoint metrics;
+    if (metricsPort != 0)
+        metrics.start(metricsPort);
+
+    // Proverka flaga ostanovki v tsikle sobytiy
+    QTimer stopTimer;
+    QObject::connect(&stopTimer, &QTimer::timeout, &app, [&]() {
+        if (stopRequested) {
+            server.stopServer();
+            app.quit();
+        }
+    });
+    stopTimer.start(200);
+
+    return app.exec();
+}
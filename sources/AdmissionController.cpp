@@ -0,0 +1,161 @@
+#include "AdmissionController.h"
+#include <algorithm>
+#include <chrono>
+#include "MetricsRegistry.h"
+
+namespace {
+
+Counter& rejectedConnections(AdmissionController::Decision decision) {
+    static Counter* metrics[AdmissionController::DECISION_COUNT] = {
+        nullptr,
+        &MetricsRegistry::instance().counter("chat_admission_rejected_capacity_total", "Soedineniya, otklonennye po limitu servera"),
+        &MetricsRegistry::instance().counter("chat_admission_rejected_address_total", "Soedineniya, otklonennye po limitu adresa"),
+        &MetricsRegistry::instance().counter("chat_admission_rejected_handshakes_total", "Soedineniya, otklonennye po limitu ozhidayushchikh vkhoda"),
+    };
+    return *metrics[decision];
+}
+
+Gauge& pendingHandshakes() {
+    static Gauge& metric = MetricsRegistry::instance().gauge(
+        "chat_pending_handshakes", "Soedineniya, eshche ne vypolnivshie vkhod");
+    return metric;
+}
+
+} // namespace
+
+AdmissionController::AdmissionController()
+    : limits{ MAX_CONNECTIONS, MAX_CONNECTIONS_PER_ADDRESS, MAX_PENDING_HANDSHAKES, ACCEPT_BATCH, HANDSHAKE_TIMEOUT }
+    , pendingCount(0) {
+    for (auto& counter : rejected) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+int64_t AdmissionController::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// IPv4 is counted per address, IPv6 per /64 since one host owns a whole /64
+std::string AdmissionController::addressKey(const BanList::Address& address) {
+    static const uint8_t mappedPrefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+    bool ipv4 = std::equal(mappedPrefix, mappedPrefix + 12, address.begin());
+    return std::string(reinterpret_cast<const char*>(address.data()), ipv4 ? address.size() : 8);
+}
+
+void AdmissionController::setLimits(const Limits& newLimits) {
+    std::lock_guard<std::mutex> lock(mtx);
+    limits = newLimits;
+    limits.acceptBatch = std::max<size_t>(1, limits.acceptBatch);
+}
+
+AdmissionController::Limits AdmissionController::getLimits() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return limits;
+}
+
+AdmissionController::Decision AdmissionController::admit(uint64_t key, const BanList::Address& address) {
+    std::string addressId = addressKey(address);
+    Decision decision = ADMITTED;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto count = addressCounts.find(addressId);
+        if (entries.size() >= limits.maxConnections) {
+            decision = REJECTED_CAPACITY;
+        }
+        else if (count != addressCounts.end() && count->second >= limits.maxPerAddress) {
+            decision = REJECTED_ADDRESS;
+        }
+        else if (pendingCount >= limits.maxPendingHandshakes) {
+            decision = REJECTED_HANDSHAKES;
+        }
+        else if (entries.emplace(key, Entry{ addressId, true, nowMs() }).second) {
+            ++addressCounts[addressId];
+            ++pendingCount;
+            pendingHandshakes().set(static_cast<int64_t>(pendingCount));
+        }
+    }
+
+    if (decision != ADMITTED) {
+        rejected[decision].fetch_add(1, std::memory_order_relaxed);
+        rejectedConnections(decision).add();
+    }
+    return decision;
+}
+
+void AdmissionController::completeHandshake(uint64_t key) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(key);
+    if (it != entries.end() && it->second.pending) {
+        it->second.pending = false;
+        --pendingCount;
+        pendingHandshakes().set(static_cast<int64_t>(pendingCount));
+    }
+}
+
+void AdmissionController::release(uint64_t key) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return;
+    }
+    if (it->second.pending) {
+        --pendingCount;
+        pendingHandshakes().set(static_cast<int64_t>(pendingCount));
+    }
+    auto count = addressCounts.find(it->second.addressKey);
+    if (count != addressCounts.end() && --count->second == 0) {
+        addressCounts.erase(count);
+    }
+    entries.erase(it);
+}
+
+std::vector<uint64_t> AdmissionController::expiredHandshakes() const {
+    std::vector<uint64_t> expired;
+    int64_t deadline = nowMs() - getLimits().handshakeTimeoutMs;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (pendingCount == 0) {
+        return expired;
+    }
+    for (const auto& entry : entries) {
+        if (entry.second.pending && entry.second.admittedAtMs < deadline) {
+            expired.push_back(entry.first);
+        }
+    }
+    return expired;
+}
+
+bool AdmissionController::isSaturated() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return entries.size() >= limits.maxConnections || pendingCount >= limits.maxPendingHandshakes;
+}
+
+size_t AdmissionController::getConnectionCount() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return entries.size();
+}
+
+size_t AdmissionController::getPendingHandshakeCount() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return pendingCount;
+}
+
+uint64_t AdmissionController::getRejectedCount(Decision decision) const {
+    return rejected[decision].load(std::memory_order_relaxed);
+}
+
+const char* AdmissionController::decisionName(Decision decision) {
+    switch (decision) {
+    case ADMITTED:
+        return "admitted";
+    case REJECTED_CAPACITY:
+        return "capacity";
+    case REJECTED_ADDRESS:
+        return "address";
+    case REJECTED_HANDSHAKES:
+        return "handshakes";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "config.h"
+#include "BanList.h"
+
+// Admission control for new connections. Every accepted socket takes a
+// slot; a connection stays "pending" until it logs in. The listener stops
+// accepting while the server is saturated, so a reconnect wave waits in the
+// kernel backlog instead of spawning threads and sockets all at once.
+class AdmissionController {
+public:
+    enum Decision {
+        ADMITTED,
+        REJECTED_CAPACITY,      // Too many connections in total
+        REJECTED_ADDRESS,       // Too many connections from one address
+        REJECTED_HANDSHAKES,    // Too many connections that have not logged in
+        DECISION_COUNT
+    };
+
+    struct Limits {
+        size_t maxConnections;
+        size_t maxPerAddress;
+        size_t maxPendingHandshakes;
+        size_t acceptBatch;         // Accepts per listener wake-up
+        int64_t handshakeTimeoutMs; // Pending connections older than this are dropped
+    };
+
+private:
+    struct Entry {
+        std::string addressKey;
+        bool pending;
+        int64_t admittedAtMs;
+    };
+
+    mutable std::mutex mtx;
+    Limits limits;
+    std::unordered_map<uint64_t, Entry> entries;            // Caller key -> connection
+    std::unordered_map<std::string, size_t> addressCounts;  // Connections per address
+    size_t pendingCount;
+    std::atomic<uint64_t> rejected[DECISION_COUNT];
+
+    static int64_t nowMs();
+    static std::string addressKey(const BanList::Address& address);
+
+public:
+    AdmissionController();
+
+    void setLimits(const Limits& newLimits);
+    Limits getLimits() const;
+
+    // Reserving a slot for the connection identified by key
+    Decision admit(uint64_t key, const BanList::Address& address);
+
+    // Login finished, the connection no longer counts as pending
+    void completeHandshake(uint64_t key);
+
+    // Connection closed; unknown keys are ignored
+    void release(uint64_t key);
+
+    // Keys of connections that did not log in within the handshake timeout
+    std::vector<uint64_t> expiredHandshakes() const;
+
+    // True while new connections should stay in the backlog
+    bool isSaturated() const;
+
+    size_t getConnectionCount() const;
+    size_t getPendingHandshakeCount() const;
+    uint64_t getRejectedCount(Decision decision) const;
+
+    static const char* decisionName(Decision decision);
+};
@@ -0,0 +1,355 @@
+#include "BanList.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+#ifdef _WIN32
+#include <WS2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+namespace {
+
+const int IPV4_MAPPED_PREFIX = 96;
+
+int nibbleAt(const uint8_t* bytes, int level) {
+    return (level % 2 == 0) ? bytes[level / 2] >> 4 : bytes[level / 2] & 0x0F;
+}
+
+// Zeroing host bits so that equal subnets get one canonical key
+void maskAddress(BanList::Address& address, int prefixLength) {
+    for (int bit = prefixLength; bit < 128; ++bit) {
+        address[bit / 8] &= static_cast<uint8_t>(~(1u << (7 - bit % 8)));
+    }
+}
+
+void mapIPv4(const void* ipv4, BanList::Address& address) {
+    address.fill(0);
+    address[10] = 0xFF;
+    address[11] = 0xFF;
+    std::memcpy(address.data() + 12, ipv4, 4);
+}
+
+bool isIPv4Mapped(const BanList::Address& address) {
+    static const uint8_t prefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+    return std::memcmp(address.data(), prefix, sizeof(prefix)) == 0;
+}
+
+} // namespace
+
+BanList::PrefixTree::PrefixTree() {
+    clear();
+}
+
+void BanList::PrefixTree::clear() {
+    nodes.assign(1, Node());
+    bannedAll = false;
+}
+
+void BanList::PrefixTree::insert(const uint8_t* bytes, int prefixLength) {
+    if (prefixLength == 0) {
+        bannedAll = true;
+        return;
+    }
+
+    // Descending through the whole nibbles of the prefix
+    int lastLevel = (prefixLength - 1) / 4;
+    uint32_t node = 0;
+    for (int level = 0; level < lastLevel; ++level) {
+        int slot = nibbleAt(bytes, level);
+        if (nodes[node].child[slot] == 0) {
+            nodes[node].child[slot] = static_cast<uint32_t>(nodes.size());
+            nodes.emplace_back();
+        }
+        node = nodes[node].child[slot];
+    }
+
+    // The remaining 1..4 bits cover a run of slots in the last node
+    int freeBits = 4 - (prefixLength - lastLevel * 4);
+    int first = nibbleAt(bytes, lastLevel) & ~((1 << freeBits) - 1);
+    for (int slot = first; slot < first + (1 << freeBits); ++slot) {
+        nodes[node].bannedMask |= static_cast<uint16_t>(1u << slot);
+    }
+}
+
+bool BanList::PrefixTree::contains(const uint8_t* bytes, int bitCount) const {
+    if (bannedAll) {
+        return true;
+    }
+
+    uint32_t node = 0;
+    for (int level = 0; level < bitCount / 4; ++level) {
+        int slot = nibbleAt(bytes, level);
+        if (nodes[node].bannedMask & (1u << slot)) {
+            return true;
+        }
+        node = nodes[node].child[slot];
+        if (node == 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+BanList::BanList(const std::string& path) : fileName(path), ipv6CoversIPv4(false) {
+}
+
+bool BanList::parseAddress(const std::string& text, Address& address) {
+    in_addr ipv4;
+    if (inet_pton(AF_INET, text.c_str(), &ipv4) == 1) {
+        mapIPv4(&ipv4, address);
+        return true;
+    }
+    in6_addr ipv6;
+    if (inet_pton(AF_INET6, text.c_str(), &ipv6) == 1) {
+        std::memcpy(address.data(), &ipv6, address.size());
+        return true;
+    }
+    return false;
+}
+
+bool BanList::parseSubnet(const std::string& cidr, Address& address, int& prefixLength) {
+    size_t slash = cidr.find('/');
+    std::string host = cidr.substr(0, slash);
+    if (!parseAddress(host, address)) {
+        return false;
+    }
+
+    bool ipv4 = host.find(':') == std::string::npos;
+    int maxLength = ipv4 ? 32 : 128;
+    int length = maxLength;
+    if (slash != std::string::npos) {
+        const std::string suffix = cidr.substr(slash + 1);
+        if (suffix.empty() || suffix.size() > 3 ||
+            suffix.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+        length = std::stoi(suffix);
+        if (length > maxLength) {
+            return false;
+        }
+    }
+
+    prefixLength = ipv4 ? length + IPV4_MAPPED_PREFIX : length;
+    maskAddress(address, prefixLength);
+    return true;
+}
+
+bool BanList::fromSockaddr(const sockaddr* address, Address& result) {
+    if (!address) {
+        return false;
+    }
+    if (address->sa_family == AF_INET) {
+        mapIPv4(&reinterpret_cast<const sockaddr_in*>(address)->sin_addr, result);
+        return true;
+    }
+    if (address->sa_family == AF_INET6) {
+        std::memcpy(result.data(), &reinterpret_cast<const sockaddr_in6*>(address)->sin6_addr, result.size());
+        return true;
+    }
+    return false;
+}
+
+std::string BanList::formatSubnet(const Address& address, int prefixLength) {
+    char text[INET6_ADDRSTRLEN] = {};
+    if (isIPv4Mapped(address) && prefixLength >= IPV4_MAPPED_PREFIX) {
+        inet_ntop(AF_INET, address.data() + 12, text, sizeof(text));
+        return std::string(text) + "/" + std::to_string(prefixLength - IPV4_MAPPED_PREFIX);
+    }
+    inet_ntop(AF_INET6, address.data(), text, sizeof(text));
+    return std::string(text) + "/" + std::to_string(prefixLength);
+}
+
+void BanList::insertPrefix(const Address& address, int prefixLength) {
+    if (isIPv4Mapped(address) && prefixLength >= IPV4_MAPPED_PREFIX) {
+        ipv4Tree.insert(address.data() + 12, prefixLength - IPV4_MAPPED_PREFIX);
+        return;
+    }
+
+    ipv6Tree.insert(address.data(), prefixLength);
+
+    // A short IPv6 prefix such as ::/0 or ::ffff:0:0/96 bans every IPv4 client
+    Address mappedBase;
+    mappedBase.fill(0);
+    mappedBase[10] = 0xFF;
+    mappedBase[11] = 0xFF;
+    maskAddress(mappedBase, prefixLength);
+    if (prefixLength <= IPV4_MAPPED_PREFIX && mappedBase == address) {
+        ipv6CoversIPv4 = true;
+    }
+}
+
+void BanList::rebuildTrie() {
+    ipv4Tree.clear();
+    ipv6Tree.clear();
+    ipv6CoversIPv4 = false;
+    for (const auto& subnet : subnets) {
+        insertPrefix(subnet.second.first, subnet.second.second);
+    }
+}
+
+bool BanList::isAddressBanned(const Address& address) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    if (isIPv4Mapped(address)) {
+        return ipv6CoversIPv4 || ipv4Tree.contains(address.data() + 12, 32);
+    }
+    return ipv6Tree.contains(address.data(), 128);
+}
+
+bool BanList::isAddressBanned(const std::string& address) const {
+    Address parsed;
+    return parseAddress(address, parsed) && isAddressBanned(parsed);
+}
+
+bool BanList::isAddressBanned(const sockaddr* address) const {
+    Address parsed;
+    return fromSockaddr(address, parsed) && isAddressBanned(parsed);
+}
+
+bool BanList::banUser(const std::string& username) {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    if (!usernames.insert(username).second) {
+        return false;
+    }
+    saveLocked();
+    return true;
+}
+
+bool BanList::unbanUser(const std::string& username) {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    if (usernames.erase(username) == 0) {
+        return false;
+    }
+    saveLocked();
+    return true;
+}
+
+bool BanList::isUserBanned(const std::string& username) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return usernames.count(username) != 0;
+}
+
+bool BanList::banSubnet(const std::string& cidr) {
+    Address address;
+    int prefixLength = 0;
+    if (!parseSubnet(cidr, address, prefixLength)) {
+        return false;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    std::string key = formatSubnet(address, prefixLength);
+    if (!subnets.emplace(key, std::make_pair(address, prefixLength)).second) {
+        return false;
+    }
+    insertPrefix(address, prefixLength);
+    saveLocked();
+    return true;
+}
+
+bool BanList::unbanSubnet(const std::string& cidr) {
+    Address address;
+    int prefixLength = 0;
+    if (!parseSubnet(cidr, address, prefixLength)) {
+        return false;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    if (subnets.erase(formatSubnet(address, prefixLength)) == 0) {
+        return false;
+    }
+
+    // Unbans are rare, rebuilding keeps the tree free of dead branches
+    rebuildTrie();
+    saveLocked();
+    return true;
+}
+
+std::vector<std::string> BanList::getBannedUsers() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return std::vector<std::string>(usernames.begin(), usernames.end());
+}
+
+std::vector<std::string> BanList::getBannedSubnets() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    std::vector<std::string> result;
+    result.reserve(subnets.size());
+    for (const auto& subnet : subnets) {
+        result.push_back(subnet.first);
+    }
+    return result;
+}
+
+size_t BanList::getBanCount() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return usernames.size() + subnets.size();
+}
+
+// File format: one ban per line, "user <name>" or "net <cidr>"
+bool BanList::load() {
+    std::ifstream file(fileName);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::unordered_set<std::string> loadedUsers;
+    std::map<std::string, std::pair<Address, int>> loadedSubnets;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.compare(0, 5, "user ") == 0 && line.size() > 5) {
+            loadedUsers.insert(line.substr(5));
+        }
+        else if (line.compare(0, 4, "net ") == 0) {
+            Address address;
+            int prefixLength = 0;
+            if (parseSubnet(line.substr(4), address, prefixLength)) {
+                loadedSubnets.emplace(formatSubnet(address, prefixLength), std::make_pair(address, prefixLength));
+            }
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    usernames.swap(loadedUsers);
+    subnets.swap(loadedSubnets);
+    rebuildTrie();
+    return true;
+}
+
+bool BanList::save() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return saveLocked();
+}
+
+bool BanList::saveLocked() const {
+    if (fileName.empty()) {
+        return true;
+    }
+
+    // Writing to a temporary file first so a crash never leaves a truncated list
+    const std::string tempName = fileName + ".tmp";
+    {
+        std::ofstream file(tempName, std::ios::out | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        for (const std::string& username : usernames) {
+            file << "user " << username << '\n';
+        }
+        for (const auto& subnet : subnets) {
+            file << "net " << subnet.first << '\n';
+        }
+        if (!file) {
+            return false;
+        }
+    }
+#ifdef _WIN32
+    std::remove(fileName.c_str());
+#endif
+    return std::rename(tempName.c_str(), fileName.c_str()) == 0;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "config.h"
+
+struct sockaddr;
+
+// Persistent ban list: exact usernames in a hash set and CIDR ranges in
+// prefix trees with a 4-bit stride (separate trees for IPv4 and IPv6).
+// A lookup visits at most 8 (IPv4) or 32 (IPv6) nodes no matter how many
+// bans are stored, so it is cheap enough to run on every accept.
+// Addresses are passed as IPv6; IPv4 is IPv4-mapped (::ffff:a.b.c.d).
+class BanList {
+public:
+    using Address = std::array<uint8_t, 16>;
+
+private:
+    // Multibit trie: a prefix that ends inside a nibble is expanded
+    // into the banned bits of all child slots it covers
+    class PrefixTree {
+    private:
+        struct Node {
+            uint32_t child[16] = {};    // 0 - no child (root is never a child)
+            uint16_t bannedMask = 0;    // Slots fully covered by a ban
+        };
+        std::vector<Node> nodes;
+        bool bannedAll = false;         // "/0" ban
+
+    public:
+        PrefixTree();
+        void clear();
+        void insert(const uint8_t* bytes, int prefixLength);
+        bool contains(const uint8_t* bytes, int bitCount) const;
+    };
+
+    mutable std::shared_mutex mtx;
+    std::string fileName;
+    std::unordered_set<std::string> usernames;
+    std::map<std::string, std::pair<Address, int>> subnets;  // Canonical CIDR -> prefix
+    PrefixTree ipv4Tree;
+    PrefixTree ipv6Tree;
+    bool ipv6CoversIPv4;        // An IPv6 ban covers all of ::ffff:0:0/96
+
+    void insertPrefix(const Address& address, int prefixLength);
+    void rebuildTrie();
+    bool saveLocked() const;
+
+public:
+    explicit BanList(const std::string& path = BAN_LIST_FILE);
+
+    // Loading bans from file, replacing the current list
+    bool load();
+    bool save() const;
+
+    // Username bans
+    bool banUser(const std::string& username);
+    bool unbanUser(const std::string& username);
+    bool isUserBanned(const std::string& username) const;
+
+    // Subnet bans: "10.0.0.0/8", "2001:db8::/32" or a single address
+    bool banSubnet(const std::string& cidr);
+    bool unbanSubnet(const std::string& cidr);
+
+    // Address checks used on accept
+    bool isAddressBanned(const Address& address) const;
+    bool isAddressBanned(const std::string& address) const;
+    bool isAddressBanned(const sockaddr* address) const;
+
+    std::vector<std::string> getBannedUsers() const;
+    std::vector<std::string> getBannedSubnets() const;
+    size_t getBanCount() const;
+
+    // Address helpers
+    static bool parseAddress(const std::string& text, Address& address);
+    static bool parseSubnet(const std::string& cidr, Address& address, int& prefixLength);
+    static bool fromSockaddr(const sockaddr* address, Address& result);
+    static std::string formatSubnet(const Address& address, int prefixLength);
+};
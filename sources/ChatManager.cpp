@@ -2,6 +2,9 @@
 #include <QDebug>
 #include <QDateTime>
 #include <QCoreApplication>
+#include "config.h"
+#include "ChatProtocol.h"
+#include "RoomIndex.h"
 
 ChatManager::ChatManager(QObject* parent) : QObject(parent), isConnected(false) {
     // Initsializatsiya komponentov
@@ -9,6 +12,11 @@ ChatManager::ChatManager(QObject* parent) : QObject(parent), isConnected(false)
     network = nullptr;
     security = nullptr;
     mainWindow = nullptr;
+    journal = nullptr;
+
+    // Potok kommita zhurnala tol'ko stavit zavershenie v ochered'
+    connect(this, &ChatManager::outgoingCommitted, this, &ChatManager::completeOutgoing, Qt::QueuedConnection);
+    connect(this, &ChatManager::incomingCommitted, this, &ChatManager::completeIncoming, Qt::QueuedConnection);
 }
 
 ChatManager::~ChatManager() {
@@ -31,25 +39,80 @@ void ChatManager::setMainWindow(MainWindow* window) {
     mainWindow = window;
 }
 
+void ChatManager::setJournal(MessageJournal* messageJournal) {
+    journal = messageJournal;
+}
+
+void ChatManager::restoreFromJournal() {
+    if (!journal) {
+        return;
+    }
+
+    QMutexLocker locker(&chatMutex);
+    quint64 restored = journal->replay([this](quint64, const QByteArray& record) {
+        QString line = QString::fromUtf8(record);
+        int separatorPos = line.indexOf(" -> ");
+        if (separatorPos > 0) {
+            messageHistory[line.left(separatorPos)].append(line);
+        }
+    });
+    logger->log("Vosstanovleno soobsheniy iz zhurnala: " + QString::number(restored));
+}
+
 bool ChatManager::connectToServer(const QString& username, const QString& password) {
     if (!security || !network) {
         logger->log("Ne nastroyeny komponenty bezopasnosti ili seti");
         return false;
     }
 
-    if (!security->authenticateUser(username, password)) {
+    // Parol' i token proveryaet server: on zhe vydaet token ("/token"),
+    // a na nevernye dannye otvechaet "/denied" i razryvaet soedinenie.
+    // Perepodklyuchenie bez parolya - po tokenu: odin MAC na servere
+    // vmesto kheshirovaniya parolya
+    bool useToken = password.isEmpty() && username == currentUser && !sessionToken.isEmpty();
+    if (!security->isValidUsername(username) || (!useToken && password.isEmpty())) {
         logger->log("Oshibka autentifikatsii polzovatelya");
         emit connectionStatusChanged(false);
         return false;
     }
 
+    QString credentials = useToken
+        ? QString(RESUME_COMMAND) + username + ' ' + sessionToken
+        : QString(LOGIN_COMMAND) + username + ' ' + password;
+    return openConnection(username, credentials);
+}
+
+bool ChatManager::reconnectToServer() {
+    if (currentUser.isEmpty() || sessionToken.isEmpty()) {
+        return false;
+    }
+    if (isConnected) {
+        return true;
+    }
+    return connectToServer(currentUser, QString());
+}
+
+void ChatManager::logout() {
+    if (isConnected) {
+        network->sendMessage(LOGOUT_COMMAND);
+    }
+    disconnectFromServer();
+    sessionToken.clear();
+    currentUser.clear();
+}
+
+bool ChatManager::openConnection(const QString& username, const QString& credentials) {
     currentUser = username;
     isConnected = network->init();
 
     if (isConnected) {
+        // Server ne chitaet sleduyushchie komandy, poka ne proverit vkhod
+        network->sendMessage(credentials.toStdString());
         logger->log("Uspe podklyuchenie polzovatelya " + username);
         emit connectionStatusChanged(true);
         updateUserList();
+        // Dokachka propushchennogo za vremya otklyucheniya
+        requestHistorySync();
         return true;
     }
 
@@ -63,6 +126,12 @@ void ChatManager::disconnectFromServer() {
         network->stop();
         isConnected = false;
         connectedUsers.clear();
+        joinedRooms.clear();
+        {
+            // Do sleduyushchego "done" zhivye nomera ne dvigayut pozitsiyu
+            QMutexLocker locker(&chatMutex);
+            syncCursor.interrupt();
+        }
         emit connectionStatusChanged(false);
         logger->log("Otkluchenie ot servera");
     }
@@ -74,12 +143,36 @@ bool ChatManager::sendMessage(const QString& recipient, const QString& message)
         return false;
     }
 
-    QString formattedMessage = QString("%1 -> %2: %3")
-        .arg(currentUser)
-        .arg(recipient)
-        .arg(message);
+    QString formattedMessage = formatChatLine(currentUser, recipient, message);
+    if (!journal) {
+        return deliverOutgoing(recipient, formattedMessage);
+    }
 
-    if (!network->sendMessage(formattedMessage)) {
+    // Soobshenie uhodit v set' tol'ko posle zapisi v zhurnal, no interfeys
+    // ne zhdet kommita: otpravka - v completeOutgoing
+    journal->appendAsync(formattedMessage.toUtf8(), [this, recipient, formattedMessage](bool durable) {
+        emit outgoingCommitted(recipient, formattedMessage, durable);
+    });
+    return true;
+}
+
+void ChatManager::completeOutgoing(const QString& recipient, const QString& formattedMessage, bool durable) {
+    if (!durable) {
+        logger->log("Oshibka zapisi soobsheniya v zhurnal");
+        return;
+    }
+    if (isConnected) {
+        deliverOutgoing(recipient, formattedMessage);
+    }
+}
+
+bool ChatManager::deliverOutgoing(const QString& recipient, const QString& formattedMessage) {
+    // Privatnye soobsheniya idut tol'ko na soedineniya poluchatelya
+    bool isPrivate = recipient != "all" && !recipient.startsWith(ROOM_PREFIX);
+    bool sent = isPrivate
+        ? network->sendPrivateMessage(recipient.toStdString(), formattedMessage.toStdString()) > 0
+        : network->sendMessage(formattedMessage.toStdString());
+    if (!sent) {
         logger->log("Oshibka pri otpravke soobsheniya");
         return false;
     }
@@ -103,28 +196,165 @@ QStringList ChatManager::getMessageHistory() const {
     return history;
 }
 
-void ChatManager::processIncomingMessage(const QString& message) {
+bool ChatManager::joinRoom(const QString& room) {
+    if (!isConnected || !RoomIndex::isValidName(room.toStdString())) {
+        return false;
+    }
+
+    if (!network->sendMessage((QString(ROOM_JOIN_COMMAND) + room).toStdString())) {
+        logger->log("Oshibka podklyucheniya k komnate " + room);
+        return false;
+    }
+
+    requestHistorySync(QStringList(room));
+
+    QMutexLocker locker(&chatMutex);
+    joinedRooms.insert(room);
+    return true;
+}
+
+void ChatManager::requestHistorySync(const QStringList& conversations) {
+    // "/sync <beseda>=<posledniy nomer> ...", otvet - propushchennye
+    // soobsheniya s nomerami i "/synced" po kazhdoy besede
+    QString request = SYNC_COMMAND;
+    {
+        QMutexLocker locker(&chatMutex);
+        QStringList names = conversations;
+        if (names.isEmpty()) {
+            for (const std::string& name : syncCursor.conversations()) {
+                names.append(QString::fromStdString(name));
+            }
+            if (!names.contains("all")) {
+                names.prepend("all");
+            }
+        }
+        // Zapros idet ot podtverzhdennoy pozitsii, a ne ot poslednego
+        // zhivogo nomera: nizhe nego mozhet byt' eshche ne prislannoe
+        for (const QString& name : names) {
+            std::string key = name.toStdString();
+            syncCursor.beginSync(key);
+            request += name + '=' + QString::number(syncCursor.position(key)) + ' ';
+        }
+    }
+    network->sendMessage(request.trimmed().toStdString());
+}
+
+void ChatManager::handleSynced(const QString& reply) {
+    // "<beseda> <nomer> more|done"
+    QStringList parts = reply.split(' ', QString::SkipEmptyParts);
+    if (parts.size() < 3) {
+        return;
+    }
+
+    bool more;
+    {
+        QMutexLocker locker(&chatMutex);
+        more = syncCursor.finishPage(parts.at(0).toStdString(), parts.at(1).toULongLong(), parts.at(2) == "more");
+    }
+    if (more) {
+        requestHistorySync(QStringList(parts.at(0)));
+    }
+}
+
+bool ChatManager::leaveRoom(const QString& room) {
+    if (!isConnected) {
+        return false;
+    }
+
+    network->sendMessage((QString(ROOM_LEAVE_COMMAND) + room).toStdString());
+
     QMutexLocker locker(&chatMutex);
+    joinedRooms.remove(room);
+    return true;
+}
+
+void ChatManager::processIncomingMessage(const QString& message) {
+    static const QString syncedCommand = SYNCED_COMMAND;
+    static const QString idCommand = MESSAGE_ID_COMMAND;
+    static const QString tokenCommand = SESSION_TOKEN_COMMAND;
+
+    // Otvet servera na vkhod: token dlya perepodklyucheniya ili otkaz
+    if (message.startsWith(tokenCommand)) {
+        sessionToken = message.mid(tokenCommand.size());
+        return;
+    }
+    if (message == LOGIN_DENIED_COMMAND) {
+        sessionToken.clear();   // Istek, otozvan ili nevernyy parol'
+        logger->log("Oshibka autentifikatsii polzovatelya");
+        // Setevoy potok ne ostanavlivaet sam sebya
+        QMetaObject::invokeMethod(this, [this]() { disconnectFromServer(); }, Qt::QueuedConnection);
+        return;
+    }
+
+    if (message.startsWith(syncedCommand)) {
+        handleSynced(message.mid(syncedCommand.size()));
+        return;
+    }
+
+    // Posle zaprosa sinkhronizatsii soobsheniya prihodyat kak "/id <nomer> <stroka>"
+    QString text = message;
+    quint64 messageId = 0;
+    if (text.startsWith(idCommand)) {
+        int space = text.indexOf(' ', idCommand.size());
+        if (space < 0) {
+            return;
+        }
+        messageId = text.midRef(idCommand.size(), space - idCommand.size()).toULongLong();
+        text = text.mid(space + 1);
+    }
 
     // Parsim soobshenie
-    int separatorPos = message.indexOf(" -> ");
-    if (separatorPos > 0) {
-        QString sender = message.left(separatorPos);
-        QString rest = message.mid(separatorPos + 4);
-        int colonPos = rest.indexOf(':');
-        if (colonPos > 0) {
-            QString recipient = rest.left(colonPos);
-            QString msgText = rest.mid(colonPos + 2);
-
-            // Obnovlyaem istoriyu soobsheniy
-            messageHistory[sender].append(message);
-
-            // Proveryaem, dlya tekushchego li polzovatelya soobshenie
-            if (recipient == currentUser || recipient == "all") {
-                emit newMessageReceived(message);
-                logger->log("Polucheno novoe soobshenie: " + message);
+    ChatLine line;
+    if (parseChatLine(text, line)) {
+        // Privatnaya beseda nazyvaetsya po sobesedniku
+        QString conversation = line.recipient == "all" || line.recipient.startsWith(ROOM_PREFIX)
+            ? line.recipient
+            : (line.sender == currentUser ? line.recipient : line.sender);
+        if (messageId != 0) {
+            QMutexLocker locker(&chatMutex);
+            if (!syncCursor.accept(conversation.toStdString(), messageId)) {
+                return;     // Uzhe polucheno vzhivuyu ili do perepodklyucheniya
+            }
+            if (line.sender == currentUser) {
+                return;     // Svoi soobsheniya uzhe v zhurnale i istorii posle otpravki
             }
         }
+
+        // Soobshenie prinyato tol'ko posle zapisi v zhurnal; setevoy potok
+        // ne zhdet kommita, poryadok sokhranyaetsya poryadkom nomerov zhurnala
+        if (!journal) {
+            acceptIncoming(text);
+            return;
+        }
+        journal->appendAsync(text.toUtf8(), [this, text](bool durable) {
+            emit incomingCommitted(text, durable);
+        });
+    }
+}
+
+void ChatManager::completeIncoming(const QString& message, bool durable) {
+    if (!durable) {
+        logger->log("Oshibka zapisi vkhodyashchego soobsheniya v zhurnal");
+        return;
+    }
+    acceptIncoming(message);
+}
+
+void ChatManager::acceptIncoming(const QString& message) {
+    ChatLine line;
+    if (!parseChatLine(message, line)) {
+        return;
+    }
+
+    QMutexLocker locker(&chatMutex);
+
+    // Obnovlyaem istoriyu soobsheniy
+    messageHistory[line.sender].append(message);
+
+    // Proveryaem, dlya tekushchego li polzovatelya soobshenie
+    if (line.recipient == currentUser || line.recipient == "all" || joinedRooms.contains(line.recipient)) {
+        emit newMessageReceived(message);
+        logger->log("Polucheno novoe soobshenie: " + message);
     }
 }
 
@@ -199,13 +429,11 @@ void ChatManager::broadcastMessage(const QString& message) {
 }
 
 void ChatManager::handlePrivateMessage(const QString& sender, const QString& recipient, const QString& message) {
-    QString formattedMessage = QString("%1 -> %2: %3")
-        .arg(sender)
-        .arg(recipient)
-        .arg(message);
+    QString formattedMessage = formatChatLine(sender, recipient, message);
 
     if (isConnected) {
-        network->sendMessage(formattedMessage);
+        // Dostavka tol'ko na soedineniya poluchatelya
+        network->sendPrivateMessage(recipient.toStdString(), formattedMessage.toStdString());
         logger->log("Privatnoe soobshenie otpravleno");
     }
 }
@@ -4,10 +4,13 @@
 #include <QVector>
 #include <QMutex>
 #include <QMap>
+#include <QSet>
 #include "Logger.h"
 #include "NetworkManager.h"
 #include "SecurityManager.h"
 #include "MainWindow.h"
+#include "MessageJournal.h"
+#include "SyncCursor.h"
 
 class ChatManager : public QObject {
     Q_OBJECT
@@ -17,14 +20,29 @@ private:
     NetworkManager* network;
     SecurityManager* security;
     MainWindow* mainWindow;
+    MessageJournal* journal;               // Zhurnal prinyatykh soobsheniy
 
     QMutex chatMutex;
     QMap<QString, QString> messageHistory;  // Istoriya soobsheniy
     QVector<QString> connectedUsers;        // Spisok podklyuchennyh polzovateley
+    QSet<QString> joinedRooms;              // Komnaty, na kotorye podpisan polzovatel
+    SyncCursor syncCursor;                  // Pozitsii sinkhronizatsii istorii po besedam
 
     QString currentUser;                   // Tekushchiy avtorizovannyy polzovatel
+    QString sessionToken;                  // Token dlya perepodklyucheniya bez parolya
     bool isConnected;                     // Status podklyucheniya
 
+    // Podklyuchenie i otpravka dannykh vkhoda ("/login" ili "/resume") serveru
+    bool openConnection(const QString& username, const QString& credentials);
+
+    // Otpravka v set' i istoriyu uzhe zapisannogo v zhurnal soobsheniya
+    bool deliverOutgoing(const QString& recipient, const QString& formattedMessage);
+    void acceptIncoming(const QString& message);
+
+    // Zapros propushchennyh soobsheniy; pustoy spisok - vse izvestnye besedy
+    void requestHistorySync(const QStringList& conversations = QStringList());
+    void handleSynced(const QString& reply);
+
 public:
     explicit ChatManager(QObject* parent = nullptr);
     ~ChatManager();
@@ -34,15 +52,29 @@ public:
     void setNetwork(NetworkManager* net);
     void setSecurity(SecurityManager* sec);
     void setMainWindow(MainWindow* window);
+    void setJournal(MessageJournal* messageJournal);
+
+    // Vosstanovlenie istorii iz zhurnala posle sboya
+    void restoreFromJournal();
 
     // Upravlenie podklyucheniem
     bool connectToServer(const QString& username, const QString& password);
     void disconnectFromServer();
 
+    // Perepodklyuchenie po tokenu sessii; false - nuzhen vvod parolya
+    bool reconnectToServer();
+
+    // Vykhod s otzyvom tokenov sessii
+    void logout();
+
     // Rabota s soobsheniyami
     bool sendMessage(const QString& recipient, const QString& message);
     QStringList getMessageHistory() const;
 
+    // Gruppovye komnaty ("#imya")
+    bool joinRoom(const QString& room);
+    bool leaveRoom(const QString& room);
+
     // Upravlenie polzovatelyami
     QStringList getConnectedUsers() const;
     bool isUserConnected(const QString& username) const;
@@ -51,10 +83,19 @@ public slots:
     void processIncomingMessage(const QString& message);
     void updateUserList();
 
+private slots:
+    // Zavershenie zapisi v zhurnal, v potoke ChatManager
+    void completeOutgoing(const QString& recipient, const QString& formattedMessage, bool durable);
+    void completeIncoming(const QString& message, bool durable);
+
 signals:
     void newMessageReceived(const QString& message);
     void userListUpdated(const QStringList& users);
     void connectionStatusChanged(bool status);
+
+    // Podtverzhdeniya zhurnala iz potoka kommita (tol'ko dlya ocheredi sobytiy)
+    void outgoingCommitted(const QString& recipient, const QString& formattedMessage, bool durable);
+    void incomingCommitted(const QString& message, bool durable);
 };
 
 // Realizatsiya metodov
@@ -0,0 +1,34 @@
+#include "ChatProtocol.h"
+#include "TraceRecorder.h"
+
+namespace {
+const QString SEPARATOR = QStringLiteral(" -> ");
+const QString TEXT_SEPARATOR = QStringLiteral(": ");
+}
+
+bool parseChatLine(const QString& line, ChatLine& parsed) {
+    CHAT_TRACE_SCOPE("parseChatLine");
+    int separatorPos = line.indexOf(SEPARATOR);
+    if (separatorPos <= 0) {
+        return false;
+    }
+
+    int recipientPos = separatorPos + SEPARATOR.size();
+    int colonPos = line.indexOf(QLatin1Char(':'), recipientPos);
+    if (colonPos <= recipientPos) {
+        return false;
+    }
+
+    parsed.sender = line.left(separatorPos);
+    parsed.recipient = line.mid(recipientPos, colonPos - recipientPos);
+    parsed.text = line.mid(colonPos + TEXT_SEPARATOR.size());
+    return true;
+}
+
+QString formatChatLine(const QString& sender, const QString& recipient, const QString& text) {
+    // Odna alokatsiya vmesto tsepochki QString::arg()
+    QString line;
+    line.reserve(sender.size() + SEPARATOR.size() + recipient.size() + TEXT_SEPARATOR.size() + text.size());
+    line.append(sender).append(SEPARATOR).append(recipient).append(TEXT_SEPARATOR).append(text);
+    return line;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QString>
+
+// Stroka chata vida "otpravitel -> poluchatel: tekst"
+struct ChatLine {
+    QString sender;
+    QString recipient;
+    QString text;
+};
+
+// Razbor stroki chata, vozvrashchaet false dlya nevernogo formata
+bool parseChatLine(const QString& line, ChatLine& parsed);
+
+// Formirovanie stroki chata
+QString formatChatLine(const QString& sender, const QString& recipient, const QString& text);
@@ -0,0 +1,396 @@
+#include "FrameCodec.h"
+#include <fstream>
+#include <iterator>
+
+#ifdef CHAT_HAVE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+#endif
+
+namespace {
+
+// Input per frame: even incompressible data then stays within COMPRESSION_MAX_FRAME
+const size_t MAX_FRAME_INPUT = COMPRESSION_MAX_FRAME / 2;
+
+void appendVarint(std::string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+// Returns the number of bytes read, 0 if more input is needed, -1 if malformed
+int readVarint(const char* data, size_t size, uint32_t& value) {
+    value = 0;
+    for (size_t i = 0; i < size && i < 5; ++i) {
+        uint8_t byte = static_cast<uint8_t>(data[i]);
+        value |= static_cast<uint32_t>(byte & 0x7F) << (7 * i);
+        if (!(byte & 0x80)) {
+            return static_cast<int>(i + 1);
+        }
+    }
+    return size >= 5 ? -1 : 0;
+}
+
+void appendFrame(std::string& out, FrameType type, const char* data, size_t size) {
+    out.push_back(static_cast<char>(type));
+    appendVarint(out, static_cast<uint32_t>(size));
+    out.append(data, size);
+}
+
+#ifdef CHAT_HAVE_ZSTD
+
+// Blocks are encoded and decoded on whatever thread delivers the frame
+ZSTD_CCtx* blockCompressor() {
+    thread_local std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> context(ZSTD_createCCtx(), ZSTD_freeCCtx);
+    return context.get();
+}
+
+ZSTD_DCtx* blockDecompressor() {
+    thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)> context(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    return context.get();
+}
+
+// FNV-1a, identifies raw-content dictionaries that carry no zstd dictionary ID
+uint32_t contentId(const std::string& content) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : content) {
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash ? hash : 1;
+}
+
+#endif
+
+} // namespace
+
+// CompressionDictionary
+
+struct CompressionDictionary::Impl {
+    uint32_t id = 0;
+#ifdef CHAT_HAVE_ZSTD
+    ZSTD_CDict* cdict = nullptr;
+    ZSTD_DDict* ddict = nullptr;
+
+    ~Impl() {
+        ZSTD_freeCDict(cdict);
+        ZSTD_freeDDict(ddict);
+    }
+#endif
+};
+
+CompressionDictionary::CompressionDictionary() : impl(new Impl) {
+}
+
+CompressionDictionary::~CompressionDictionary() = default;
+
+bool CompressionDictionary::load(const std::string& content, int level) {
+#ifdef CHAT_HAVE_ZSTD
+    if (content.empty()) {
+        return false;
+    }
+
+    std::unique_ptr<Impl> loaded(new Impl);
+    loaded->cdict = ZSTD_createCDict(content.data(), content.size(), level);
+    loaded->ddict = ZSTD_createDDict(content.data(), content.size());
+    if (!loaded->cdict || !loaded->ddict) {
+        return false;
+    }
+    loaded->id = ZSTD_getDictID_fromDict(content.data(), content.size());
+    if (loaded->id == 0) {
+        loaded->id = contentId(content);
+    }
+    impl = std::move(loaded);
+    return true;
+#else
+    (void)content;
+    (void)level;
+    return false;
+#endif
+}
+
+bool CompressionDictionary::loadFile(const std::string& path, int level) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return load(content, level);
+}
+
+uint32_t CompressionDictionary::id() const {
+    return impl->id;
+}
+
+std::string CompressionDictionary::train(const std::vector<std::string>& samples, size_t capacity) {
+#ifdef CHAT_HAVE_ZSTD
+    std::string buffer;
+    std::vector<size_t> sizes;
+    sizes.reserve(samples.size());
+    for (const auto& sample : samples) {
+        buffer += sample;
+        sizes.push_back(sample.size());
+    }
+
+    std::string dictionary(capacity, '\0');
+    size_t size = ZDICT_trainFromBuffer(&dictionary[0], capacity, buffer.data(), sizes.data(),
+        static_cast<unsigned>(sizes.size()));
+    if (ZDICT_isError(size)) {
+        return std::string();
+    }
+    dictionary.resize(size);
+    return dictionary;
+#else
+    (void)samples;
+    (void)capacity;
+    return std::string();
+#endif
+}
+
+// FrameEncoder
+
+struct FrameEncoder::Stream {
+#ifdef CHAT_HAVE_ZSTD
+    ZSTD_CCtx* context = nullptr;
+
+    ~Stream() {
+        ZSTD_freeCCtx(context);
+    }
+#endif
+};
+
+FrameEncoder::FrameEncoder(DictionaryPtr dict, size_t minimumSize)
+    : dictionary(std::move(dict)), minSize(minimumSize) {
+}
+
+FrameEncoder::~FrameEncoder() = default;
+
+void FrameEncoder::encodeBlock(const CompressionDictionary* dict, size_t minimumSize,
+    const char* data, size_t size, std::string& out) {
+    // The decoder rejects frames above COMPRESSION_MAX_FRAME
+    while (size > MAX_FRAME_INPUT) {
+        encodeBlock(dict, minimumSize, data, MAX_FRAME_INPUT, out);
+        data += MAX_FRAME_INPUT;
+        size -= MAX_FRAME_INPUT;
+    }
+
+#ifdef CHAT_HAVE_ZSTD
+    if (size >= minimumSize) {
+        ZSTD_CCtx* context = blockCompressor();
+        ZSTD_CCtx_reset(context, ZSTD_reset_session_and_parameters);
+        ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, COMPRESSION_LEVEL);
+        // Both sides already agreed on the dictionary, its ID would only cost bytes
+        ZSTD_CCtx_setParameter(context, ZSTD_c_dictIDFlag, 0);
+        if (dict && dict->impl->cdict) {
+            ZSTD_CCtx_refCDict(context, dict->impl->cdict);
+        }
+
+        size_t header = out.size();
+        size_t bound = ZSTD_compressBound(size);
+        out.resize(header + 1 + 5 + bound);
+        char* body = &out[header + 1 + 5];
+        size_t compressed = ZSTD_compress2(context, body, bound, data, size);
+
+        // Worth a frame only if it saves more than the varint it may grow
+        if (!ZSTD_isError(compressed) && compressed + 4 < size) {
+            std::string prefix;
+            prefix.push_back(static_cast<char>(FrameType::BLOCK));
+            appendVarint(prefix, static_cast<uint32_t>(compressed));
+            out.replace(header, 1 + 5, prefix);
+            out.resize(header + prefix.size() + compressed);
+            return;
+        }
+        out.resize(header);
+    }
+#else
+    (void)dict;
+    (void)minimumSize;
+#endif
+    appendFrame(out, FrameType::RAW, data, size);
+}
+
+void FrameEncoder::encodeBlock(const char* data, size_t size, std::string& out) const {
+    encodeBlock(dictionary.get(), minSize, data, size, out);
+}
+
+void FrameEncoder::encodeStream(const char* data, size_t size, std::string& out) {
+    while (size > MAX_FRAME_INPUT) {
+        encodeStream(data, MAX_FRAME_INPUT, out);
+        data += MAX_FRAME_INPUT;
+        size -= MAX_FRAME_INPUT;
+    }
+
+#ifdef CHAT_HAVE_ZSTD
+    if (!stream) {
+        stream.reset(new Stream);
+        stream->context = ZSTD_createCCtx();
+        if (stream->context) {
+            ZSTD_CCtx_setParameter(stream->context, ZSTD_c_compressionLevel, COMPRESSION_LEVEL);
+            ZSTD_CCtx_setParameter(stream->context, ZSTD_c_windowLog, COMPRESSION_WINDOW_LOG);
+            ZSTD_CCtx_setParameter(stream->context, ZSTD_c_dictIDFlag, 0);
+            if (dictionary && dictionary->impl->cdict) {
+                ZSTD_CCtx_refCDict(stream->context, dictionary->impl->cdict);
+            }
+        }
+    }
+
+    // A new stream would not match the peer's decoder state, so after a
+    // failure the connection's bursts go out as standalone blocks
+    if (!stream->context) {
+        encodeBlock(data, size, out);
+        return;
+    }
+
+    std::string compressed;
+    compressed.resize(ZSTD_compressBound(size) + ZSTD_CStreamOutSize());
+    ZSTD_inBuffer input = { data, size, 0 };
+    ZSTD_outBuffer output = { &compressed[0], compressed.size(), 0 };
+    size_t remaining;
+    do {
+        if (output.pos == output.size) {
+            compressed.resize(compressed.size() * 2);
+            output.dst = &compressed[0];
+            output.size = compressed.size();
+        }
+        remaining = ZSTD_compressStream2(stream->context, &output, &input, ZSTD_e_flush);
+        if (ZSTD_isError(remaining)) {
+            ZSTD_freeCCtx(stream->context);
+            stream->context = nullptr;
+            encodeBlock(data, size, out);
+            return;
+        }
+    } while (remaining != 0);
+
+    appendFrame(out, FrameType::STREAM, compressed.data(), output.pos);
+#else
+    appendFrame(out, FrameType::RAW, data, size);
+#endif
+}
+
+const DictionaryPtr& FrameEncoder::getDictionary() const {
+    return dictionary;
+}
+
+// FrameDecoder
+
+struct FrameDecoder::Stream {
+#ifdef CHAT_HAVE_ZSTD
+    ZSTD_DCtx* context = nullptr;
+
+    ~Stream() {
+        ZSTD_freeDCtx(context);
+    }
+#endif
+};
+
+FrameDecoder::FrameDecoder(DictionaryPtr dict) : dictionary(std::move(dict)) {
+}
+
+FrameDecoder::~FrameDecoder() = default;
+
+bool FrameDecoder::feed(const char* data, size_t size, std::string& out) {
+    pending.append(data, size);
+
+    size_t offset = 0;
+    while (pending.size() - offset >= 2) {
+        uint32_t length = 0;
+        int lengthSize = readVarint(pending.data() + offset + 1, pending.size() - offset - 1, length);
+        if (lengthSize < 0 || length > COMPRESSION_MAX_FRAME) {
+            return false;
+        }
+        if (lengthSize == 0 || pending.size() - offset - 1 - lengthSize < length) {
+            break;
+        }
+
+        FrameType type = static_cast<FrameType>(pending[offset]);
+        if (!decodeFrame(type, pending.data() + offset + 1 + lengthSize, length, out)) {
+            return false;
+        }
+        offset += 1 + lengthSize + length;
+    }
+    pending.erase(0, offset);
+    return true;
+}
+
+bool FrameDecoder::decodeFrame(FrameType type, const char* data, size_t size, std::string& out) {
+    if (type == FrameType::RAW) {
+        out.append(data, size);
+        return true;
+    }
+
+#ifdef CHAT_HAVE_ZSTD
+    if (type == FrameType::BLOCK) {
+        unsigned long long content = ZSTD_getFrameContentSize(data, size);
+        if (content == ZSTD_CONTENTSIZE_ERROR || content == ZSTD_CONTENTSIZE_UNKNOWN
+            || content > COMPRESSION_MAX_FRAME) {
+            return false;
+        }
+
+        size_t start = out.size();
+        out.resize(start + content);
+        ZSTD_DCtx* context = blockDecompressor();
+        size_t decoded = dictionary && dictionary->impl->ddict
+            ? ZSTD_decompress_usingDDict(context, &out[start], content, data, size, dictionary->impl->ddict)
+            : ZSTD_decompressDCtx(context, &out[start], content, data, size);
+        if (ZSTD_isError(decoded) || decoded != content) {
+            out.resize(start);
+            return false;
+        }
+        return true;
+    }
+
+    if (type == FrameType::STREAM) {
+        if (!stream) {
+            std::unique_ptr<Stream> created(new Stream);
+            created->context = ZSTD_createDCtx();
+            if (!created->context) {
+                return false;
+            }
+            // The window bounds the memory a peer can make us allocate
+            ZSTD_DCtx_setParameter(created->context, ZSTD_d_windowLogMax, COMPRESSION_WINDOW_LOG);
+            if (dictionary && dictionary->impl->ddict) {
+                ZSTD_DCtx_refDDict(created->context, dictionary->impl->ddict);
+            }
+            stream = std::move(created);
+        }
+
+        char buffer[16384];
+        ZSTD_inBuffer input = { data, size, 0 };
+        size_t produced = 0;
+        while (true) {
+            ZSTD_outBuffer output = { buffer, sizeof(buffer), 0 };
+            size_t result = ZSTD_decompressStream(stream->context, &output, &input);
+            if (ZSTD_isError(result)) {
+                return false;
+            }
+            out.append(buffer, output.pos);
+            produced += output.pos;
+            if (produced > COMPRESSION_MAX_FRAME) {
+                return false;
+            }
+            // Flushed chunk fully consumed and no more buffered output
+            if (input.pos == input.size && output.pos < output.size) {
+                return true;
+            }
+        }
+    }
+#endif
+    return false;
+}
+
+namespace FrameCodec {
+
+bool isAvailable() {
+#ifdef CHAT_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+const char* algorithm() {
+    return isAvailable() ? "zstd" : "none";
+}
+
+} // namespace FrameCodec
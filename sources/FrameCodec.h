@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "config.h"
+
+// Server-to-client wire format after COMPRESS_COMMAND is negotiated.
+// Every frame is a type byte, a LEB128 payload length and the payload;
+// decoded payloads concatenate back into the plain '\n'-separated stream,
+// so the client keeps its line parser and only feeds it decoded bytes.
+enum class FrameType : uint8_t {
+    RAW = 0,        // Stored as is: below the size threshold or incompressible
+    BLOCK = 1,      // Standalone zstd frame, using the shared dictionary if any
+    STREAM = 2      // Flushed chunk of the per-connection zstd stream
+};
+
+// Trained zstd dictionary shared by all connections. A single chat line
+// has too little context to compress on its own; the dictionary supplies
+// the usual prefixes, user names and command words. Immutable once loaded,
+// so encoders and decoders on any thread may use it concurrently.
+class CompressionDictionary {
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+
+    friend class FrameEncoder;
+    friend class FrameDecoder;
+
+public:
+    CompressionDictionary();
+    ~CompressionDictionary();
+
+    CompressionDictionary(const CompressionDictionary&) = delete;
+    CompressionDictionary& operator=(const CompressionDictionary&) = delete;
+
+    bool load(const std::string& content, int level = COMPRESSION_LEVEL);
+    bool loadFile(const std::string& path, int level = COMPRESSION_LEVEL);
+
+    // Identifier both sides compare during negotiation, 0 if not loaded
+    uint32_t id() const;
+
+    // Training from sample messages; empty result when zstd is unavailable
+    // or there are too few samples
+    static std::string train(const std::vector<std::string>& samples, size_t capacity = COMPRESSION_DICTIONARY_SIZE);
+};
+
+using DictionaryPtr = std::shared_ptr<const CompressionDictionary>;
+
+// Per-connection encoder. Blocks are independent of the connection and can
+// be encoded once for a whole fan-out; the stream context keeps a window of
+// everything sent in bursts, so consecutive history lines compress against
+// each other. The stream context is allocated on first use only.
+class FrameEncoder {
+private:
+    struct Stream;
+
+    DictionaryPtr dictionary;
+    size_t minSize;
+    std::unique_ptr<Stream> stream;
+
+public:
+    explicit FrameEncoder(DictionaryPtr dict = nullptr, size_t minimumSize = COMPRESSION_MIN_SIZE);
+    ~FrameEncoder();
+
+    // Standalone frame appended to out: RAW below minimumSize or when
+    // compression does not pay off, BLOCK otherwise
+    static void encodeBlock(const CompressionDictionary* dict, size_t minimumSize,
+        const char* data, size_t size, std::string& out);
+    void encodeBlock(const char* data, size_t size, std::string& out) const;
+
+    // Burst through the connection's stream, flushed so the peer can decode
+    // everything written so far
+    void encodeStream(const char* data, size_t size, std::string& out);
+
+    const DictionaryPtr& getDictionary() const;
+};
+
+// Per-connection decoder: buffers partial frames and appends decoded bytes
+// to out. Returns false on malformed or oversized input; the connection
+// must then be closed, its stream state is unusable.
+class FrameDecoder {
+private:
+    struct Stream;
+
+    DictionaryPtr dictionary;
+    std::string pending;
+    std::unique_ptr<Stream> stream;
+
+    bool decodeFrame(FrameType type, const char* data, size_t size, std::string& out);
+
+public:
+    explicit FrameDecoder(DictionaryPtr dict = nullptr);
+    ~FrameDecoder();
+
+    bool feed(const char* data, size_t size, std::string& out);
+};
+
+namespace FrameCodec {
+
+// True when built with zstd; otherwise compression is never negotiated
+bool isAvailable();
+
+// Name sent in the negotiation line
+const char* algorithm();
+
+} // namespace FrameCodec
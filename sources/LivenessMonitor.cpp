@@ -0,0 +1,138 @@
+#include "LivenessMonitor.h"
+#include <vector>
+
+// Constructor
+LivenessMonitor::LivenessMonitor(uint64_t heartbeatIntervalMs, uint64_t connectionTimeoutMs, uint32_t tickMs)
+    : wheel(tickMs)
+    , heartbeatMs(heartbeatIntervalMs)
+    , timeoutMs(connectionTimeoutMs)
+    , originMs(nowMs())
+    , advancedTicks(0)
+    , pingedCount(0)
+    , reapedTotal(0)
+{
+}
+
+uint64_t LivenessMonitor::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LivenessMonitor::setPingHandler(Handler handler) {
+    std::lock_guard<std::mutex> lock(mtx);
+    pingHandler = std::move(handler);
+}
+
+void LivenessMonitor::setReapHandler(Handler handler) {
+    std::lock_guard<std::mutex> lock(mtx);
+    reapHandler = std::move(handler);
+}
+
+// Starting tracking of a new connection
+void LivenessMonitor::add(ConnectionId id) {
+    std::lock_guard<std::mutex> lock(mtx);
+    peers[id] = { nowMs(), false };
+    wheel.schedule(id, heartbeatMs);
+}
+
+// Recording activity, the wheel entry is not touched
+void LivenessMonitor::touch(ConnectionId id) {
+    uint64_t now = nowMs();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = peers.find(id);
+    if (it == peers.end()) {
+        return;
+    }
+    it->second.lastSeenMs = now;
+    if (it->second.pinged) {
+        it->second.pinged = false;
+        pingedCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+// Stopping tracking of a connection
+void LivenessMonitor::remove(ConnectionId id) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = peers.find(id);
+    if (it == peers.end()) {
+        return;
+    }
+    if (it->second.pinged) {
+        pingedCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+    peers.erase(it);
+    wheel.cancel(id);
+}
+
+// Advancing the wheel
+void LivenessMonitor::tick() {
+    std::vector<ConnectionId> toPing;
+    std::vector<ConnectionId> toReap;
+    Handler ping;
+    Handler reap;
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        uint64_t now = nowMs();
+        uint64_t targetTicks = (now - originMs) / wheel.getTickDuration();
+
+        wheel.advance(targetTicks - advancedTicks, [&](ConnectionId id) {
+            auto it = peers.find(id);
+            if (it == peers.end()) {
+                return;
+            }
+
+            Peer& peer = it->second;
+            uint64_t idle = now - peer.lastSeenMs;
+            if (idle >= timeoutMs) {
+                if (peer.pinged) {
+                    pingedCount.fetch_sub(1, std::memory_order_relaxed);
+                }
+                peers.erase(it);
+                toReap.push_back(id);
+            }
+            else if (idle >= heartbeatMs) {
+                if (!peer.pinged) {
+                    peer.pinged = true;
+                    pingedCount.fetch_add(1, std::memory_order_relaxed);
+                    toPing.push_back(id);
+                }
+                wheel.schedule(id, timeoutMs - idle);
+            }
+            else {
+                // Activity since arming, sleep until the heartbeat is due again
+                wheel.schedule(id, heartbeatMs - idle);
+            }
+        });
+        advancedTicks = targetTicks;
+
+        ping = pingHandler;
+        reap = reapHandler;
+    }
+
+    reapedTotal.fetch_add(toReap.size(), std::memory_order_relaxed);
+    for (ConnectionId id : toPing) {
+        if (ping) {
+            ping(id);
+        }
+    }
+    for (ConnectionId id : toReap) {
+        if (reap) {
+            reap(id);
+        }
+    }
+}
+
+size_t LivenessMonitor::getTrackedCount() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return peers.size();
+}
+
+size_t LivenessMonitor::getPingedCount() const {
+    return pingedCount.load(std::memory_order_relaxed);
+}
+
+uint64_t LivenessMonitor::getReapedTotal() const {
+    return reapedTotal.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include "config.h"
+#include "TimerWheel.h"
+
+// Connection liveness tracking on top of a single timer wheel.
+// Activity only stamps the last-seen time; the wheel entry is re-armed lazily
+// when it fires, so a busy connection costs one hash lookup per message.
+// A peer silent for the heartbeat interval is pinged, one silent for the
+// timeout is reaped.
+class LivenessMonitor {
+public:
+    using Handler = std::function<void(ConnectionId)>;
+
+private:
+    struct Peer {
+        uint64_t lastSeenMs;
+        bool pinged;
+    };
+
+    mutable std::mutex mtx;
+    TimerWheel wheel;
+    std::unordered_map<ConnectionId, Peer> peers;
+    uint64_t heartbeatMs;
+    uint64_t timeoutMs;
+    uint64_t originMs;          // Clock value at wheel tick 0
+    uint64_t advancedTicks;     // Ticks already applied to the wheel
+
+    Handler pingHandler;
+    Handler reapHandler;
+
+    std::atomic<size_t> pingedCount;
+    std::atomic<uint64_t> reapedTotal;
+
+    static uint64_t nowMs();
+
+public:
+    LivenessMonitor(uint64_t heartbeatIntervalMs = HEARTBEAT_INTERVAL,
+        uint64_t connectionTimeoutMs = MESSAGE_TIMEOUT,
+        uint32_t tickMs = LIVENESS_TICK);
+
+    // Handlers are called from tick() without the internal lock held
+    void setPingHandler(Handler handler);
+    void setReapHandler(Handler handler);
+
+    // Starting, refreshing and stopping tracking of a connection
+    void add(ConnectionId id);
+    void touch(ConnectionId id);
+    void remove(ConnectionId id);
+
+    // Advancing the wheel to the current time, sending pings and reaping peers
+    void tick();
+
+    size_t getTrackedCount() const;
+    size_t getPingedCount() const;
+    uint64_t getReapedTotal() const;
+};
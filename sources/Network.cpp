@@ -5,14 +5,26 @@
 #include <vector>
 #include <mutex>
 #include <queue>
+#include <chrono>
+#include <algorithm>
 #include <WS2tcpip.h>
 #include "Logger.h"
+#include "MetricsRegistry.h"
+#include "TraceRecorder.h"
 
 // Konstruktor
-NetworkManager::NetworkManager(Logger* log) : logger(log) {
+NetworkManager::NetworkManager(Logger* log) : logger(log), security(log) {
     isRunning = false;
     incomingMessages = std::queue<std::string>();
-    clients = std::vector<Client>();
+    nextClientId = 1;
+
+    liveness.setPingHandler([this](ConnectionId clientId) {
+        sendToConnection(clientId, PING_COMMAND);
+    });
+    liveness.setReapHandler([this](ConnectionId clientId) {
+        logger->log("Reaping silent client " + std::to_string(clientId));
+        removeClient(clientId);
+    });
 }
 
 // Destruktor
@@ -30,15 +42,36 @@ void NetworkManager::init() {
             return;
         }
 
+        bans.load();
         isRunning = true;
         networkThread = std::thread(&NetworkManager::startListening, this);
         networkThread.detach();
+        livenessThread = std::thread(&NetworkManager::checkLiveness, this);
+        livenessThread.detach();
+        writerThread = std::thread(&NetworkManager::flushWrites, this);
+        writerThread.detach();
+    }
+}
+
+// One thread drives the timer wheel for all connections
+void NetworkManager::checkLiveness() {
+    while (isRunning) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(LIVENESS_TICK));
+        liveness.tick();
+        rateLimiter.prune();
+
+        // Connections that never logged in do not keep their slot
+        for (uint64_t clientId : admission.expiredHandshakes()) {
+            logger->log("Handshake timeout for client " + std::to_string(clientId));
+            removeClient(static_cast<ConnectionId>(clientId));
+        }
     }
 }
 
 // Ostanovka setevogo soedineniya
 void NetworkManager::stop() {
     isRunning = false;
+    writeReady.notify_all();
 
     if (listenSocket != INVALID_SOCKET) {
         closesocket(listenSocket);
@@ -46,27 +79,26 @@ void NetworkManager::stop() {
     }
 
     // Closing all client connections
-    for (auto& client : clients) {
-        if (client.socket != INVALID_SOCKET) {
-            closesocket(client.socket);
-        }
+    std::vector<ClientPtr> closed = sessions.clear();
+    Metrics::connectionsActive().sub(static_cast<int64_t>(closed.size()));
+    for (const ClientPtr& client : closed) {
+        rateLimiter.removeConnection(client->id);
+        admission.release(client->id);
+        std::lock_guard<std::mutex> lock(client->clientMutex);
+        shutdownClient(*client);
     }
-    clients.clear();
 }
 
 // Sending message
 bool NetworkManager::sendMessage(const std::string& message) {
-    std::lock_guard<std::mutex> lock(mtx);
+    bool success = true;
 
-    for (auto& client : clients) {
-        if (client.socket != INVALID_SOCKET) {
-            if (send(client.socket, message.c_str(), message.length(), 0) == SOCKET_ERROR) {
-                logger->log("Sending error to client");
-                return false;
-            }
+    sessions.forEach([&](const ClientPtr& client) {
+        if (!writeToClient(client, message)) {
+            success = false;
         }
-    }
-    return true;
+    });
+    return success;
 }
 
 // Receiving message
@@ -83,14 +115,7 @@ std::string NetworkManager::receiveMessage() {
 
 // Getting connected users list
 std::vector<std::string> NetworkManager::getConnectedUsers() {
-    std::vector<std::string> userList;
-
-    for (const auto& client : clients) {
-        if (!client.username.empty()) {
-            userList.push_back(client.username);
-        }
-    }
-    return userList;
+    return routes.getUsers();
 }
 
 // Processing incoming messages
@@ -108,28 +133,66 @@ void NetworkManager::processIncomingMessages() {
 
 // Function for broadcast
 void NetworkManager::broadcastMessage(const std::string& message, SOCKET excludeSocket) {
-    std::lock_guard<std::mutex> lock(mtx);
-
-    for (auto& client : clients) {
-        if (client.socket != excludeSocket) {
-            if (send(client.socket, message.c_str(), message.length(), 0) == SOCKET_ERROR) {
-                logger->log("Broadcast error");
-            }
+    CHAT_TRACE_SCOPE("NetworkManager::broadcastMessage");
+    sessions.forEach([&](const ClientPtr& client) {
+        if (client->socket != excludeSocket && !writeToClient(client, message)) {
+            logger->log("Broadcast error");
         }
-    }
+    });
 }
 
 // Handling client connection
-void NetworkManager::handleClient(SOCKET clientSocket) {
+void NetworkManager::handleClient(ClientPtr client) {
+    const SOCKET clientSocket = client->socket;
+    const ConnectionId clientId = client->id;
     char buffer[1024];
     int bytesReceived;
 
     while (isRunning) {
-        bytesReceived = recv(clientSocket, buffer, 1024, 0);
+        // The socket is non-blocking for the writer, so the reader waits here;
+        // the timeout lets the thread notice stop()
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(clientSocket, &readable);
+        timeval timeout = { LIVENESS_TICK / 1000, (LIVENESS_TICK % 1000) * 1000 };
+        int ready = select(0, &readable, nullptr, nullptr, &timeout);
+        if (ready == 0) {
+            continue;
+        }
+
+        bytesReceived = ready == SOCKET_ERROR ? SOCKET_ERROR : recv(clientSocket, buffer, 1024, 0);
+        if (bytesReceived == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK) {
+            continue;
+        }
 
         if (bytesReceived > 0) {
+            CHAT_TRACE_SCOPE("NetworkManager::handleClient");
             std::string message(buffer, bytesReceived);
-            logger->log("Received message from client: " + message);
+            Metrics::bytesReceived().add(bytesReceived);
+            liveness.touch(clientId);
+            if (message == PONG_COMMAND) {
+                continue;
+            }
+
+            // Over-limit traffic is dropped before it is logged or parsed
+            if (!rateLimiter.allow(clientId)) {
+                continue;
+            }
+
+            // Commands, group and private messages are delivered to their targets only
+            bool routed;
+            {
+                ScopedLatency latency(Metrics::sendLatency());
+                // Passwords and tokens stay out of the log
+                bool credentials = message.compare(0, sizeof(LOGIN_COMMAND) - 1, LOGIN_COMMAND) == 0 ||
+                    message.compare(0, sizeof(RESUME_COMMAND) - 1, RESUME_COMMAND) == 0;
+                logger->log(credentials ? std::string("Received login request from client")
+                    : "Received message from client: " + message);
+                routed = routeMessage(clientId, message);
+            }
+            if (routed) {
+                continue;
+            }
 
             // Adding message to queue
             std::lock_guard<std::mutex> lock(mtx);
@@ -138,31 +201,53 @@ void NetworkManager::handleClient(SOCKET clientSocket) {
         else if (bytesReceived == 0) {
             // Client disconnected
             logger->log("Client disconnected");
-            removeClient(clientSocket);
-            closesocket(clientSocket);
+            removeClient(clientId);
             break;
         }
         else {
             // Error receiving data
             logger->log("Error receiving data from client");
-            removeClient(clientSocket);
-            closesocket(clientSocket);
+            removeClient(clientId);
             break;
         }
     }
+
+    // Only this thread closes the handle, once the writer is not using it
+    std::unique_lock<std::mutex> lock(client->clientMutex);
+    client->closed = true;
+    client->sendDone.wait(lock, [&client] { return !client->sending; });
+    closesocket(client->socket);
+    client->socket = INVALID_SOCKET;
 }
 
-// Removing client from list
-void NetworkManager::removeClient(SOCKET clientSocket) {
-    std::lock_guard<std::mutex> lock(mtx);
+// Removing client from registry and closing its socket
+void NetworkManager::removeClient(ConnectionId clientId) {
+    ClientPtr client;
+    if (!sessions.remove(clientId, &client)) {
+        return;
+    }
+    rooms.removeConnection(clientId);
+    routes.unbind(clientId);
+    liveness.remove(clientId);
+    rateLimiter.removeConnection(clientId);
+    admission.release(clientId);
+    Metrics::connectionsActive().sub(1);
+
+    std::lock_guard<std::mutex> lock(client->clientMutex);
+    logger->log("Removing client " + client->username);
+    shutdownClient(*client);
+}
 
-    for (auto it = clients.begin(); it != clients.end(); ++it) {
-        if (it->socket == clientSocket) {
-            logger->log("Removing client " + it->username);
-            clients.erase(it);
-            break;
-        }
+// Called with clientMutex held, from any thread. shutdown() wakes the
+// reader's select/recv and fails the writer's next send, but the handle
+// stays valid until the reader closes it, so it cannot be handed to a new
+// connection while another thread still uses the old value.
+void NetworkManager::shutdownClient(Client& client) {
+    if (client.closed) {
+        return;
     }
+    client.closed = true;
+    shutdown(client.socket, SD_BOTH);
 }
 
 // Handling new client connection
@@ -205,30 +290,455 @@ void NetworkManager::startListening() {
 
     logger->log("Server started on port " + std::to_string(PORT));
 
+    // Non-blocking listener: each wake-up drains at most one accept batch
+    // and the loop notices stop() without a pending connection
+    u_long nonBlocking = 1;
+    ioctlsocket(listenSocket, FIONBIO, &nonBlocking);
+
     while (isRunning) {
-        SOCKET clientSocket = accept(listenSocket, nullptr, nullptr);
-        if (clientSocket != INVALID_SOCKET) {
-            logger->log("New client connection");
+        // While saturated, new connections wait in the backlog instead of
+        // being accepted and dropped; clients retry with their own backoff
+        if (admission.isSaturated()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(ACCEPT_PAUSE));
+            continue;
+        }
 
-            // Creating new client
-            Client newClient = { clientSocket, "" };
-            clients.push_back(newClient);
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(listenSocket, &readSet);
+        timeval timeout = { 0, ACCEPT_PAUSE * 1000 };
+        if (select(0, &readSet, nullptr, nullptr, &timeout) <= 0) {
+            continue;
+        }
 
-            // Starting client handling in separate thread
-            std::thread clientHandler(&NetworkManager::handleClient, this, clientSocket).detach();
+        size_t batch = admission.getLimits().acceptBatch;
+        for (size_t accepted = 0; accepted < batch && isRunning; ++accepted) {
+            sockaddr_storage clientAddr;
+            int clientAddrLen = sizeof(clientAddr);
+            SOCKET clientSocket = accept(listenSocket, reinterpret_cast<sockaddr*>(&clientAddr), &clientAddrLen);
+            if (clientSocket == INVALID_SOCKET) {
+                break;      // WSAEWOULDBLOCK: backlog drained
+            }
+            acceptClient(clientSocket, clientAddr);
         }
     }
 }
 
-// Function for broadcast
-void NetworkManager::broadcastMessage(const std::string& message, SOCKET excludeSocket) {
-    std::lock_guard<std::mutex> lock(mtx);
+// Admitting a single accepted socket
+void NetworkManager::acceptClient(SOCKET clientSocket, const sockaddr_storage& clientAddr) {
+    // Banned subnets are rejected before any per-client state exists
+    const sockaddr* peer = reinterpret_cast<const sockaddr*>(&clientAddr);
+    if (bans.isAddressBanned(peer)) {
+        closesocket(clientSocket);
+        MetricsRegistry::instance().counter("chat_connections_banned_total").add();
+        return;
+    }
+
+    BanList::Address address;
+    if (!BanList::fromSockaddr(peer, address)) {
+        closesocket(clientSocket);
+        return;
+    }
+
+    ConnectionId clientId = nextClientId.fetch_add(1);
+    AdmissionController::Decision decision = admission.admit(clientId, address);
+    if (decision != AdmissionController::ADMITTED) {
+        closesocket(clientSocket);
+        logger->log(std::string("Connection rejected: ") + AdmissionController::decisionName(decision));
+        return;
+    }
+    logger->log("New client connection");
+
+    // Accepted sockets inherit the listener's non-blocking mode; it is kept
+    // so a client that stops reading cannot stall the shared writer thread
+    u_long nonBlocking = 1;
+    ioctlsocket(clientSocket, FIONBIO, &nonBlocking);
+
+    // Creating new client
+    ClientPtr newClient = std::make_shared<Client>();
+    newClient->socket = clientSocket;
+    newClient->id = clientId;
+    sessions.insert(clientId, newClient);
+    liveness.add(clientId);
+    rateLimiter.addConnection(clientId, address);
+    Metrics::connectionsAccepted().add();
+    Metrics::connectionsActive().add(1);
+
+    // Starting client handling in separate thread; it owns the socket handle
+    std::thread(&NetworkManager::handleClient, this, newClient).detach();
+}
+
+// Subscribing client to room
+bool NetworkManager::joinRoom(const std::string& room, ConnectionId clientId) {
+    if (routes.getUsername(clientId).empty() || !RoomIndex::isValidName(room)) {
+        logger->log("Rejected room join: " + room);
+        return false;
+    }
+    if (!rooms.join(room, clientId)) {
+        logger->log("Room limit reached, cannot create " + room);
+        return false;
+    }
+    return true;
+}
 
-    for (auto& client : clients) {
-        if (client.socket != excludeSocket) {
-            if (send(client.socket, message.c_str(), message.length(), 0) == SOCKET_ERROR) {
-                logger->log("Broadcast error");
+// Unsubscribing client from room
+bool NetworkManager::leaveRoom(const std::string& room, ConnectionId clientId) {
+    return rooms.leave(room, clientId);
+}
+
+// Sending message to room members only
+size_t NetworkManager::sendToRoom(const std::string& room, const std::string& message, ConnectionId excludeId) {
+    size_t delivered = 0;
+    rooms.forEachMember(room, [&](ConnectionId memberId) {
+        if (memberId != excludeId && sendToConnection(memberId, message)) {
+            ++delivered;
+        }
+    });
+    return delivered;
+}
+
+// Binding connection to user after the password or session token is verified.
+// Runs in the client's reader thread, so a slow hash holds up only this client
+void NetworkManager::loginClient(ConnectionId clientId, const std::string& request, bool resume) {
+    // "<name> <password or token>": the secret is the rest of the line
+    std::string line = request;
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+        line.pop_back();
+    }
+    size_t separator = line.find(' ');
+    std::string username = line.substr(0, separator);
+    std::string secret = separator == std::string::npos ? std::string() : line.substr(separator + 1);
+    if (username.empty() || username.size() > USERNAME_MAX_LENGTH || secret.empty()) {
+        logger->log("Invalid login request from client " + std::to_string(clientId));
+        removeClient(clientId);
+        return;
+    }
+    if (bans.isUserBanned(username)) {
+        logger->log("Rejected login of banned user " + username);
+        removeClient(clientId);
+        return;
+    }
+
+    ClientPtr client;
+    if (!sessions.find(clientId, client)) {
+        return;
+    }
+    if (!routes.getUsername(clientId).empty()) {
+        logger->log("Repeated login ignored for client " + std::to_string(clientId));
+        return;
+    }
+
+    QString name = QString::fromStdString(username);
+    QString credential = QString::fromStdString(secret);
+    bool verified = resume ? security.authenticateToken(name, credential)
+        : security.authenticateUser(name, credential);
+    if (!verified) {
+        // The answer is written before the connection is dropped
+        logger->log("Rejected login of user " + username);
+        client->closeWhenFlushed = true;
+        if (!sendToConnection(clientId, LOGIN_DENIED_COMMAND)) {
+            removeClient(clientId);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(client->clientMutex);
+        client->username = username;
+    }
+    routes.bind(username, clientId);
+    rateLimiter.bindUser(clientId, username);
+    admission.completeHandshake(clientId);
+    std::string token = resume ? secret : security.issueSessionToken(name).toStdString();
+    sendToConnection(clientId, SESSION_TOKEN_COMMAND + token);
+    logger->log("Client logged in as " + username);
+}
+
+// Sending message only to the recipient's own connections
+size_t NetworkManager::sendPrivateMessage(const std::string& username, const std::string& message) {
+    size_t delivered = 0;
+    routes.forEachConnection(username, [&](ConnectionId clientId) {
+        if (sendToConnection(clientId, message)) {
+            ++delivered;
+        }
+    });
+    if (delivered == 0) {
+        logger->log("Private message recipient is offline: " + username);
+    }
+    return delivered;
+}
+
+// Sending to a single connection
+bool NetworkManager::sendToConnection(ConnectionId clientId, const std::string& message) {
+    ClientPtr client;
+    if (!sessions.find(clientId, client)) {
+        return false;
+    }
+    return writeToClient(client, message);
+}
+
+// Queueing a frame for the writer thread; a fan-out only copies into outboxes
+bool NetworkManager::writeToClient(const ClientPtr& client, const std::string& message) {
+    CHAT_TRACE_SCOPE("NetworkManager::writeToClient");
+    {
+        std::lock_guard<std::mutex> lock(client->clientMutex);
+        if (client->closed) {
+            return false;
+        }
+        // Bytes still waiting in the writer count too, so a stalled peer hits the limit
+        if (client->outboxBytes + client->pendingBytes + message.length() > WRITE_QUEUE_LIMIT) {
+            logger->log("Send queue overflow for client " + std::to_string(client->id));
+            return false;
+        }
+        client->outbox.push_back(message);
+        client->outboxBytes += message.length();
+        Metrics::framesQueued().add();
+        if (client->flushQueued) {
+            return true;
+        }
+        client->flushQueued = true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        dirtyClients.push_back(client);
+    }
+    writeReady.notify_one();
+    return true;
+}
+
+// Frames queued while the previous pass was writing go out together
+// in the next one, so the busier the server the fewer calls per frame.
+// Clients whose socket buffer is full are retried every WRITE_RETRY_INTERVAL
+// and dropped once they make no progress for WRITE_TIMEOUT.
+void NetworkManager::flushWrites() {
+    std::vector<ClientPtr> batch;
+    std::vector<ClientPtr> blocked;
+    uint64_t pass = 0;
+    while (isRunning) {
+        {
+            std::unique_lock<std::mutex> lock(writeMutex);
+            int wait = blocked.empty() ? LIVENESS_TICK : WRITE_RETRY_INTERVAL;
+            writeReady.wait_for(lock, std::chrono::milliseconds(wait), [this] {
+                return !dirtyClients.empty() || !isRunning;
+            });
+            batch.swap(dirtyClients);
+        }
+        batch.insert(batch.end(), blocked.begin(), blocked.end());
+        blocked.clear();
+
+        ++pass;
+        auto now = std::chrono::steady_clock::now();
+        for (const ClientPtr& client : batch) {
+            // A blocked client may also have been marked dirty again
+            if (client->writerPass == pass) {
+                continue;
+            }
+            client->writerPass = pass;
+
+            switch (flushClient(*client)) {
+            case SEND_DONE:
+                client->blockedSince = {};
+                if (client->closeWhenFlushed) {
+                    removeClient(client->id);
+                }
+                break;
+            case SEND_BLOCKED:
+                if (client->blockedSince == std::chrono::steady_clock::time_point{}) {
+                    client->blockedSince = now;
+                }
+                if (now - client->blockedSince > std::chrono::milliseconds(WRITE_TIMEOUT)) {
+                    logger->log("Write timeout for client " + std::to_string(client->id));
+                    removeClient(client->id);
+                }
+                else {
+                    blocked.push_back(client);
+                }
+                break;
+            case SEND_FAILED:
+                removeClient(client->id);
+                break;
             }
         }
+        batch.clear();
+    }
+}
+
+// Gather write of the client's pending frames: WRITE_BATCH_BUFFERS frames
+// per WSASend without copying them into one buffer. clientMutex is held only
+// to take the outbox and the socket handle, never across the call, so the
+// reader and the senders of this client are not held up by a slow peer.
+// Whatever the socket does not accept stays in client.pending.
+NetworkManager::SendResult NetworkManager::flushClient(Client& client) {
+    CHAT_TRACE_SCOPE("NetworkManager::flushClient");
+    SOCKET socket;
+    {
+        std::lock_guard<std::mutex> lock(client.clientMutex);
+        for (std::string& frame : client.outbox) {
+            client.pending.push_back(std::move(frame));
+        }
+        client.outbox.clear();
+        client.pendingBytes += client.outboxBytes;
+        client.outboxBytes = 0;
+        client.flushQueued = false;
+        if (client.closed) {
+            client.pending.clear();
+            client.pendingOffset = 0;
+            client.pendingBytes = 0;
+            return SEND_DONE;
+        }
+        socket = client.socket;
+        client.sending = true;
     }
+
+    SendResult result = SEND_DONE;
+    size_t sentTotal = 0;
+    WSABUF buffers[WRITE_BATCH_BUFFERS];
+    while (!client.pending.empty()) {
+        DWORD count = static_cast<DWORD>(std::min<size_t>(WRITE_BATCH_BUFFERS, client.pending.size()));
+        ULONG requested = 0;
+        for (DWORD i = 0; i < count; ++i) {
+            size_t offset = i == 0 ? client.pendingOffset : 0;
+            buffers[i].buf = const_cast<char*>(client.pending[i].data()) + offset;
+            buffers[i].len = static_cast<ULONG>(client.pending[i].length() - offset);
+            requested += buffers[i].len;
+        }
+
+        DWORD sent = 0;
+        if (WSASend(socket, buffers, count, &sent, 0, nullptr, nullptr) == SOCKET_ERROR) {
+            if (WSAGetLastError() == WSAEWOULDBLOCK) {
+                result = SEND_BLOCKED;
+            }
+            else {
+                logger->log("Sending error to client");
+                result = SEND_FAILED;
+            }
+            break;
+        }
+        Metrics::socketWrites().add();
+        Metrics::bytesSent().add(sent);
+        sentTotal += sent;
+
+        // Dropping what went out; a partial write leaves the tail for the next pass
+        size_t left = sent;
+        while (left > 0) {
+            size_t rest = client.pending.front().length() - client.pendingOffset;
+            if (left < rest) {
+                client.pendingOffset += left;
+                break;
+            }
+            left -= rest;
+            client.pending.pop_front();
+            client.pendingOffset = 0;
+        }
+        if (sent < requested) {
+            result = SEND_BLOCKED;
+            break;
+        }
+    }
+    if (result == SEND_BLOCKED && sentTotal > 0) {
+        // Progress restarts the stall timer
+        client.blockedSince = {};
+    }
+
+    std::lock_guard<std::mutex> lock(client.clientMutex);
+    client.sending = false;
+    client.sendDone.notify_all();
+    client.pendingBytes -= std::min(client.pendingBytes, sentTotal);
+    if (client.closed) {
+        // Removed during the call: the reader closes the handle
+        client.pending.clear();
+        client.pendingOffset = 0;
+        client.pendingBytes = 0;
+        return SEND_DONE;
+    }
+    return result;
+}
+
+// Handling "/login name password", "/resume name token", "/logout",
+// "/join #room", "/leave #room", "sender -> #room: text" and "sender -> user: text"
+bool NetworkManager::routeMessage(ConnectionId clientId, const std::string& message) {
+    CHAT_TRACE_SCOPE("NetworkManager::routeMessage");
+    static const std::string loginCommand = LOGIN_COMMAND;
+    static const std::string resumeCommand = RESUME_COMMAND;
+    static const std::string logoutCommand = LOGOUT_COMMAND;
+    static const std::string joinCommand = ROOM_JOIN_COMMAND;
+    static const std::string leaveCommand = ROOM_LEAVE_COMMAND;
+
+    if (message.compare(0, loginCommand.size(), loginCommand) == 0) {
+        loginClient(clientId, message.substr(loginCommand.size()), false);
+        return true;
+    }
+    if (message.compare(0, resumeCommand.size(), resumeCommand) == 0) {
+        loginClient(clientId, message.substr(resumeCommand.size()), true);
+        return true;
+    }
+    if (message.compare(0, logoutCommand.size(), logoutCommand) == 0) {
+        std::string username = routes.getUsername(clientId);
+        if (!username.empty()) {
+            security.revokeSessionTokens(QString::fromStdString(username));
+        }
+        return true;
+    }
+    if (message.compare(0, joinCommand.size(), joinCommand) == 0) {
+        joinRoom(message.substr(joinCommand.size()), clientId);
+        return true;
+    }
+    if (message.compare(0, leaveCommand.size(), leaveCommand) == 0) {
+        leaveRoom(message.substr(leaveCommand.size()), clientId);
+        return true;
+    }
+
+    size_t separatorPos = message.find(" -> ");
+    if (separatorPos == std::string::npos || separatorPos == 0) {
+        return false;
+    }
+
+    // Chat lines only after login and only in the name of the bound user
+    std::string username = routes.getUsername(clientId);
+    if (username.empty() || message.compare(0, separatorPos, username) != 0 || separatorPos != username.size()) {
+        logger->log("Dropped message without login or with a foreign sender: " + message);
+        return true;
+    }
+    size_t recipientPos = separatorPos + 4;
+    size_t colonPos = message.find(':', recipientPos);
+    if (colonPos == std::string::npos || colonPos == recipientPos) {
+        return false;
+    }
+
+    std::string recipient = message.substr(recipientPos, colonPos - recipientPos);
+    if (recipient[0] == ROOM_PREFIX) {
+        sendToRoom(recipient, message, clientId);
+        return true;
+    }
+    if (recipient != "all") {
+        sendPrivateMessage(recipient, message);
+        return true;
+    }
+    return false;
+}
+
+BanList& NetworkManager::getBanList() {
+    return bans;
+}
+
+RateLimiter& NetworkManager::getRateLimiter() {
+    return rateLimiter;
+}
+
+AdmissionController& NetworkManager::getAdmissionController() {
+    return admission;
+}
+
+// Liveness counters
+size_t NetworkManager::getLiveConnectionCount() const {
+    return liveness.getTrackedCount();
+}
+
+size_t NetworkManager::getPingedConnectionCount() const {
+    return liveness.getPingedCount();
+}
+
+uint64_t NetworkManager::getReapedConnectionCount() const {
+    return liveness.getReapedTotal();
 }
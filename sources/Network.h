@@ -6,13 +6,28 @@
 #include <mutex>
 #include <thread>
 #include <queue>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <deque>
+#include <chrono>
 #include "Logger.h"
+#include "RoomIndex.h"
+#include "RoutingTable.h"
+#include "SessionRegistry.h"
+#include "LivenessMonitor.h"
+#include "BanList.h"
+#include "RateLimiter.h"
+#include "AdmissionController.h"
+#include "Security.h"
 
 class NetworkManager {
 private:
     WSADATA wsaData;
     SOCKET listenSocket;
     std::thread networkThread;
+    std::thread livenessThread;
+    std::thread writerThread;
     std::mutex mtx;
     std::queue<std::string> incomingMessages;
     bool isRunning;
@@ -22,18 +37,86 @@ private:
     const int PORT = 5000;
     const std::string IP_ADDRESS = "127.0.0.1";
 
-    // Structure for storing connections
+    // Structure for storing connections. The socket handle is closed only by
+    // the client's reader thread after its loop exits; other threads shut it
+    // down, so a handle is never reused while the reader still polls it
     struct Client {
         SOCKET socket;
         std::string username;
+        ConnectionId id;
+        std::mutex clientMutex;     // Guards socket handle, close, username, outbox and byte counts
+        std::condition_variable sendDone;   // Signalled when the writer leaves WSASend
+        std::vector<std::string> outbox;    // Frames queued since the last flush
+        size_t outboxBytes = 0;
+        size_t pendingBytes = 0;    // Taken by the writer but not yet sent
+        bool flushQueued = false;   // Already listed in dirtyClients
+        bool sending = false;       // Writer is inside WSASend without the lock
+        bool closed = false;        // Removed and shut down; the reader closes the handle
+        std::atomic<bool> closeWhenFlushed{ false };    // Denied login: removed once /denied is sent
+
+        // Writer thread only: frames being sent, offset into the first one
+        std::deque<std::string> pending;
+        size_t pendingOffset = 0;
+        std::chrono::steady_clock::time_point blockedSince;    // Zero while sends progress
+        uint64_t writerPass = 0;    // Last writer pass that flushed this client
     };
-    std::vector<Client> clients;
+    using ClientPtr = std::shared_ptr<Client>;
+
+    enum SendResult {
+        SEND_DONE,                  // Everything queued has been sent (or dropped on close)
+        SEND_BLOCKED,               // Socket buffer full, the rest waits for the next pass
+        SEND_FAILED                 // Connection broken
+    };
+
+    // Clients with queued frames; the writer thread takes the whole list per
+    // wake-up and sends each client's frames with one gather write
+    std::mutex writeMutex;
+    std::condition_variable writeReady;
+    std::vector<ClientPtr> dirtyClients;
+
+    // Sharded session registry: accept, disconnect and broadcast do not share a lock
+    SessionRegistry<ClientPtr> sessions;
+    std::atomic<ConnectionId> nextClientId;
+
+    // Room subscriptions and user routes for targeted fan-out
+    RoomIndex rooms;
+    RoutingTable routes;
+
+    // Heartbeats and reaping of silent peers
+    LivenessMonitor liveness;
+
+    // Banned usernames and subnets, checked before a client is allocated
+    BanList bans;
+
+    // Token buckets per connection, user and subnet, checked before parsing
+    RateLimiter rateLimiter;
+
+    // Connection caps and accept throttling during reconnect storms
+    AdmissionController admission;
+
+    // Accounts and session tokens checked on /login and /resume
+    SecurityManager security;
 
     // Function for handling connections
     void startListening();
-    void handleClient(SOCKET clientSocket);
+    void acceptClient(SOCKET clientSocket, const sockaddr_storage& clientAddr);
+    void checkLiveness();
+    void handleClient(ClientPtr client);
+    void removeClient(ConnectionId clientId);
+    void shutdownClient(Client& client);
     void broadcastMessage(const std::string& message, SOCKET excludeSocket = INVALID_SOCKET);
 
+    // Handling login/room commands, group and private messages, returns true if consumed
+    bool routeMessage(ConnectionId clientId, const std::string& message);
+
+    // Sending to a single connection
+    bool sendToConnection(ConnectionId clientId, const std::string& message);
+    bool writeToClient(const ClientPtr& client, const std::string& message);
+
+    // Writer thread: flushes the outboxes of all dirty clients per pass
+    void flushWrites();
+    SendResult flushClient(Client& client);
+
 public:
     NetworkManager(Logger* log);
     ~NetworkManager();
@@ -47,77 +130,28 @@ public:
     // Getting connected users list
     std::vector<std::string> getConnectedUsers();
 
+    // Room management and targeted fan-out
+    bool joinRoom(const std::string& room, ConnectionId clientId);
+    bool leaveRoom(const std::string& room, ConnectionId clientId);
+    size_t sendToRoom(const std::string& room, const std::string& message, ConnectionId excludeId = 0);
+
+    // Verifying "/login name password" or "/resume name token" (in the client's
+    // reader thread), binding the connection to the user; direct delivery to the user's devices
+    void loginClient(ConnectionId clientId, const std::string& request, bool resume);
+    size_t sendPrivateMessage(const std::string& username, const std::string& message);
+
+    // Ban list management
+    BanList& getBanList();
+
+    // Receive rate limits
+    RateLimiter& getRateLimiter();
+    AdmissionController& getAdmissionController();
+
+    // Liveness counters
+    size_t getLiveConnectionCount() const;
+    size_t getPingedConnectionCount() const;
+    uint64_t getReapedConnectionCount() const;
+
     // Processing incoming messages
     void processIncomingMessages();
 };
-
-// Method prototypes
-
-void NetworkManager::startListening() {
-    // Winsock initialization
-    WSADATA wsaData;
-    WSAStartup(MAKEWORD(2, 2), &wsaData);
-
-    // Creating socket
-    listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (listenSocket == INVALID_SOCKET) {
-        logger->log("Socket creation error");
-        return;
-    }
-
-    // Setting socket parameters
-    sockaddr_in serverAddr;
-    serverAddr.sin_family = AF_INET;
-    serverAddr.sin_addr.s_addr = inet_addr(IP_ADDRESS.c_str());
-    serverAddr.sin_port = htons(PORT);
-
-    // Binding socket
-    if (bind(listenSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-        logger->log("Socket binding error");
-        return;
-    }
-
-    // Starting listening
-    listen(listenSocket, SOMAXCONN);
-    logger->log("Server started on port " + std::to_string(PORT));
-
-    while (isRunning) {
-        SOCKET clientSocket = accept(listenSocket, nullptr, nullptr);
-        if (clientSocket != INVALID_SOCKET) {
-            logger->log("New client connection");
-            clients.push_back({ clientSocket, "" });
-            std::thread(&NetworkManager::handleClient, this, clientSocket).detach();
-        }
-    }
-}
-
-void NetworkManager::handleClient(SOCKET clientSocket) {
-    char buffer[1024];
-    int bytesReceived;
-
-    while (isRunning) {
-        bytesReceived = recv(clientSocket, buffer, 1024, 0);
-        if (bytesReceived > 0) {
-            std::string message(buffer, bytesReceived);
-            logger->log("Message received: " + message);
-            incomingMessages.push(message);
-        }
-        else {
-            // Handling client disconnection
-            logger->log("Client disconnected");
-            closesocket(clientSocket);
-            break;
-        }
-    }
-}
-
-bool NetworkManager::sendMessage(const std::string& message) {
-    std::lock_guard<std::mutex> lock(mtx);
-    for (auto& client : clients) {
-        if (send(client.socket, message.c_str(), message.length(), 0) == SOCKET_ERROR) {
-            logger->log("Message sending error");
-            return false;
-        }
-    }
-    return true;
-}
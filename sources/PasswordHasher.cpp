@@ -0,0 +1,401 @@
+#include "PasswordHasher.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <random>
+#include <vector>
+#include "Sha256.h"
+#include "Sha256MultiBuffer.h"
+
+namespace {
+
+// Upper bounds for parameters read from users.dat, so a damaged or
+// tampered record cannot make a login allocate gigabytes or run for minutes.
+// The per-field limits only reject absurd numbers; the real bounds are the
+// scrypt memory 128*N*r and the total work p*128*N*r checked together
+const uint32_t MAX_ITERATIONS = 5000000;
+const uint32_t MAX_SCRYPT_N = 1u << 24;
+const uint32_t MAX_SCRYPT_R = 64;
+const uint32_t MAX_SCRYPT_P = 16;
+const uint64_t MAX_SCRYPT_MEMORY = 256ull << 20;
+const uint64_t MAX_SCRYPT_WORK = 1ull << 30;
+
+bool scryptWithinLimits(uint32_t n, uint32_t r, uint32_t p) {
+    if (n < 2 || (n & (n - 1)) != 0 || r == 0 || p == 0 ||
+        n > MAX_SCRYPT_N || r > MAX_SCRYPT_R || p > MAX_SCRYPT_P) {
+        return false;
+    }
+    uint64_t memory = 128ull * n * r;
+    return memory <= MAX_SCRYPT_MEMORY && memory * p <= MAX_SCRYPT_WORK;
+}
+
+const char* const SCRYPT_PREFIX = "scrypt";
+const char* const PBKDF2_PREFIX = "pbkdf2-sha256";
+
+std::string toHex(const uint8_t* data, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(size * 2, '0');
+    for (size_t i = 0; i < size; ++i) {
+        hex[2 * i] = digits[data[i] >> 4];
+        hex[2 * i + 1] = digits[data[i] & 0x0F];
+    }
+    return hex;
+}
+
+bool fromHex(const std::string& hex, std::string& bytes) {
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    bytes.resize(hex.size() / 2);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        int value = 0;
+        for (size_t k = 0; k < 2; ++k) {
+            char c = hex[2 * i + k];
+            int digit = c >= '0' && c <= '9' ? c - '0'
+                : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+            if (digit < 0) {
+                return false;
+            }
+            value = value * 16 + digit;
+        }
+        bytes[i] = static_cast<char>(value);
+    }
+    return true;
+}
+
+bool parseNumber(const std::string& text, uint32_t maxValue, uint32_t& value) {
+    if (text.empty() || text.size() > 10) {
+        return false;
+    }
+    uint64_t result = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        result = result * 10 + (c - '0');
+    }
+    if (result == 0 || result > maxValue) {
+        return false;
+    }
+    value = static_cast<uint32_t>(result);
+    return true;
+}
+
+std::vector<std::string> splitFields(const std::string& record) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        size_t end = record.find('$', start);
+        fields.push_back(record.substr(start, end - start));
+        if (end == std::string::npos) {
+            return fields;
+        }
+        start = end + 1;
+    }
+}
+
+// Comparison time does not depend on where the digests differ
+bool constantTimeEquals(const std::string& a, const std::string& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    unsigned char diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        diff |= static_cast<unsigned char>(a[i] ^ b[i]);
+    }
+    return diff == 0;
+}
+
+std::string randomSalt() {
+    static thread_local std::random_device device;
+    std::string salt(PasswordHasher::SALT_SIZE, '\0');
+    for (size_t i = 0; i < salt.size(); i += 4) {
+        uint32_t word = device();
+        std::memcpy(&salt[i], &word, std::min<size_t>(4, salt.size() - i));
+    }
+    return salt;
+}
+
+// Hash of the records written before per-user salts existed
+std::string legacyHash(const std::string& password) {
+    Sha256::Digest salt = Sha256::hash(std::string("salt"));
+    Sha256 context;
+    context.update(password.data(), password.size());
+    context.update(salt.data(), salt.size());
+    Sha256::Digest digest = context.finish();
+    return toHex(digest.data(), digest.size());
+}
+
+// scrypt core (RFC 7914): Salsa20/8, BlockMix and ROMix on little-endian words
+inline uint32_t rotl(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+void salsa20_8(uint32_t block[16]) {
+    uint32_t x[16];
+    std::memcpy(x, block, sizeof(x));
+    for (int i = 0; i < 8; i += 2) {
+        x[4] ^= rotl(x[0] + x[12], 7);   x[8] ^= rotl(x[4] + x[0], 9);
+        x[12] ^= rotl(x[8] + x[4], 13);  x[0] ^= rotl(x[12] + x[8], 18);
+        x[9] ^= rotl(x[5] + x[1], 7);    x[13] ^= rotl(x[9] + x[5], 9);
+        x[1] ^= rotl(x[13] + x[9], 13);  x[5] ^= rotl(x[1] + x[13], 18);
+        x[14] ^= rotl(x[10] + x[6], 7);  x[2] ^= rotl(x[14] + x[10], 9);
+        x[6] ^= rotl(x[2] + x[14], 13);  x[10] ^= rotl(x[6] + x[2], 18);
+        x[3] ^= rotl(x[15] + x[11], 7);  x[7] ^= rotl(x[3] + x[15], 9);
+        x[11] ^= rotl(x[7] + x[3], 13);  x[15] ^= rotl(x[11] + x[7], 18);
+
+        x[1] ^= rotl(x[0] + x[3], 7);    x[2] ^= rotl(x[1] + x[0], 9);
+        x[3] ^= rotl(x[2] + x[1], 13);   x[0] ^= rotl(x[3] + x[2], 18);
+        x[6] ^= rotl(x[5] + x[4], 7);    x[7] ^= rotl(x[6] + x[5], 9);
+        x[4] ^= rotl(x[7] + x[6], 13);   x[5] ^= rotl(x[4] + x[7], 18);
+        x[11] ^= rotl(x[10] + x[9], 7);  x[8] ^= rotl(x[11] + x[10], 9);
+        x[9] ^= rotl(x[8] + x[11], 13);  x[10] ^= rotl(x[9] + x[8], 18);
+        x[12] ^= rotl(x[15] + x[14], 7); x[13] ^= rotl(x[12] + x[15], 9);
+        x[14] ^= rotl(x[13] + x[12], 13); x[15] ^= rotl(x[14] + x[13], 18);
+    }
+    for (int i = 0; i < 16; ++i) {
+        block[i] += x[i];
+    }
+}
+
+void blockMix(const uint32_t* input, uint32_t* output, uint32_t r) {
+    uint32_t x[16];
+    std::memcpy(x, input + (2 * r - 1) * 16, sizeof(x));
+    for (uint32_t i = 0; i < 2 * r; ++i) {
+        for (int k = 0; k < 16; ++k) {
+            x[k] ^= input[i * 16 + k];
+        }
+        salsa20_8(x);
+        // Even blocks go to the first half of the output, odd ones to the second
+        std::memcpy(output + ((i & 1) * r + i / 2) * 16, x, sizeof(x));
+    }
+}
+
+void roMix(uint8_t* bytes, uint32_t r, uint32_t n, std::vector<uint32_t>& v) {
+    const size_t words = 32 * static_cast<size_t>(r);
+    std::vector<uint32_t> x(words);
+    std::vector<uint32_t> y(words);
+
+    for (size_t i = 0; i < words; ++i) {
+        const uint8_t* p = bytes + 4 * i;
+        x[i] = uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+    }
+
+    for (uint32_t i = 0; i < n; ++i) {
+        std::memcpy(&v[i * words], x.data(), words * sizeof(uint32_t));
+        blockMix(x.data(), y.data(), r);
+        x.swap(y);
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t j = x[(2 * r - 1) * 16] & (n - 1);
+        const uint32_t* row = &v[j * words];
+        for (size_t k = 0; k < words; ++k) {
+            x[k] ^= row[k];
+        }
+        blockMix(x.data(), y.data(), r);
+        x.swap(y);
+    }
+
+    for (size_t i = 0; i < words; ++i) {
+        uint8_t* p = bytes + 4 * i;
+        p[0] = uint8_t(x[i]);
+        p[1] = uint8_t(x[i] >> 8);
+        p[2] = uint8_t(x[i] >> 16);
+        p[3] = uint8_t(x[i] >> 24);
+    }
+}
+
+} // namespace
+
+PasswordHasher::PasswordHasher(const Params& params) : defaults(params) {
+}
+
+PasswordHasher::Params PasswordHasher::defaultParams() {
+    return Params{ PASSWORD_USE_SCRYPT ? SCRYPT : PBKDF2_SHA256, PASSWORD_PBKDF2_ITERATIONS, PASSWORD_SCRYPT_N, PASSWORD_SCRYPT_R, PASSWORD_SCRYPT_P };
+}
+
+void PasswordHasher::setDefaults(const Params& params) {
+    defaults = params;
+}
+
+PasswordHasher::Params PasswordHasher::getDefaults() const {
+    return defaults;
+}
+
+void PasswordHasher::pbkdf2Sha256(const std::string& password, const std::string& salt,
+    uint32_t iterations, uint8_t* output, size_t outputSize) {
+    HmacSha256 hmac(password.data(), password.size());
+    std::string firstInput = salt + std::string(4, '\0');
+
+    for (uint32_t blockIndex = 1; outputSize > 0; ++blockIndex) {
+        firstInput[salt.size()] = static_cast<char>(blockIndex >> 24);
+        firstInput[salt.size() + 1] = static_cast<char>(blockIndex >> 16);
+        firstInput[salt.size() + 2] = static_cast<char>(blockIndex >> 8);
+        firstInput[salt.size() + 3] = static_cast<char>(blockIndex);
+
+        Sha256::Digest u = hmac.mac(firstInput.data(), firstInput.size());
+        Sha256::Digest t = u;
+        for (uint32_t i = 1; i < iterations; ++i) {
+            hmac.macDigest(u.data(), u.data());
+            for (size_t k = 0; k < t.size(); ++k) {
+                t[k] ^= u[k];
+            }
+        }
+
+        size_t take = std::min(outputSize, t.size());
+        std::memcpy(output, t.data(), take);
+        output += take;
+        outputSize -= take;
+    }
+}
+
+bool PasswordHasher::scrypt(const std::string& password, const std::string& salt,
+    uint32_t n, uint32_t r, uint32_t p, uint8_t* output, size_t outputSize) {
+    if (!scryptWithinLimits(n, r, p)) {
+        return false;
+    }
+
+    const size_t blockSize = 128 * static_cast<size_t>(r);
+    std::string b(blockSize * p, '\0');
+    pbkdf2Sha256(password, salt, 1, reinterpret_cast<uint8_t*>(&b[0]), b.size());
+
+    std::vector<uint32_t> v(static_cast<size_t>(n) * 32 * r);
+    for (uint32_t i = 0; i < p; ++i) {
+        roMix(reinterpret_cast<uint8_t*>(&b[i * blockSize]), r, n, v);
+    }
+
+    pbkdf2Sha256(password, b, 1, output, outputSize);
+    return true;
+}
+
+std::string PasswordHasher::hash(const std::string& password) const {
+    return hash(password, randomSalt(), defaults);
+}
+
+std::string PasswordHasher::hash(const std::string& password, const std::string& salt, const Params& params) const {
+    uint8_t digest[HASH_SIZE];
+    std::string saltHex = toHex(reinterpret_cast<const uint8_t*>(salt.data()), salt.size());
+
+    switch (params.algorithm) {
+    case SCRYPT:
+        if (!scrypt(password, salt, params.scryptN, params.scryptR, params.scryptP, digest, sizeof(digest))) {
+            return std::string();
+        }
+        return std::string(SCRYPT_PREFIX) + "$" + std::to_string(params.scryptN) + "$" +
+            std::to_string(params.scryptR) + "$" + std::to_string(params.scryptP) + "$" +
+            saltHex + "$" + toHex(digest, sizeof(digest));
+    case PBKDF2_SHA256:
+        pbkdf2Sha256(password, salt, params.iterations, digest, sizeof(digest));
+        return std::string(PBKDF2_PREFIX) + "$" + std::to_string(params.iterations) + "$" +
+            saltHex + "$" + toHex(digest, sizeof(digest));
+    case LEGACY_SHA256:
+    default:
+        return legacyHash(password);
+    }
+}
+
+bool PasswordHasher::parse(const std::string& record, Params& params, std::string& salt, std::string& digest) {
+    params = Params{ LEGACY_SHA256, 0, 0, 0, 0 };
+    std::vector<std::string> fields = splitFields(record);
+
+    if (fields.size() == 1) {
+        salt.clear();
+        return record.size() == 2 * Sha256::DIGEST_SIZE && fromHex(record, digest);
+    }
+    if (fields.size() == 6 && fields[0] == SCRYPT_PREFIX) {
+        params.algorithm = SCRYPT;
+        return parseNumber(fields[1], MAX_SCRYPT_N, params.scryptN) &&
+            parseNumber(fields[2], MAX_SCRYPT_R, params.scryptR) &&
+            parseNumber(fields[3], MAX_SCRYPT_P, params.scryptP) &&
+            scryptWithinLimits(params.scryptN, params.scryptR, params.scryptP) &&
+            fromHex(fields[4], salt) && fromHex(fields[5], digest) && digest.size() == HASH_SIZE;
+    }
+    if (fields.size() == 4 && fields[0] == PBKDF2_PREFIX) {
+        params.algorithm = PBKDF2_SHA256;
+        return parseNumber(fields[1], MAX_ITERATIONS, params.iterations) &&
+            fromHex(fields[2], salt) && fromHex(fields[3], digest) && digest.size() == HASH_SIZE;
+    }
+    return false;
+}
+
+bool PasswordHasher::verify(const std::string& record, const std::string& password) const {
+    Params params;
+    std::string salt;
+    std::string expected;
+    if (!parse(record, params, salt, expected)) {
+        return false;
+    }
+
+    std::string computed;
+    if (params.algorithm == LEGACY_SHA256) {
+        fromHex(legacyHash(password), computed);
+    }
+    else {
+        fromHex(splitFields(hash(password, salt, params)).back(), computed);
+    }
+    return constantTimeEquals(computed, expected);
+}
+
+std::vector<bool> PasswordHasher::verifyBatch(const std::vector<std::string>& records,
+    const std::vector<std::string>& passwords) const {
+    std::vector<bool> results(records.size(), false);
+
+    // PBKDF2 records grouped by iteration count, everything else verified one by one
+    std::map<uint32_t, std::vector<size_t>> pbkdf2Groups;
+    std::vector<std::string> salts(records.size());
+    std::vector<std::string> expected(records.size());
+    for (size_t i = 0; i < records.size() && i < passwords.size(); ++i) {
+        Params params;
+        if (!parse(records[i], params, salts[i], expected[i])) {
+            continue;
+        }
+        if (params.algorithm == PBKDF2_SHA256) {
+            pbkdf2Groups[params.iterations].push_back(i);
+        }
+        else {
+            results[i] = verify(records[i], passwords[i]);
+        }
+    }
+
+    const size_t lanes = Sha256MultiBuffer::LANES;
+    std::string lanePasswords[lanes];
+    std::string laneSalts[lanes];
+    uint8_t digests[lanes * HASH_SIZE];
+    for (const auto& group : pbkdf2Groups) {
+        const std::vector<size_t>& members = group.second;
+        for (size_t start = 0; start < members.size(); start += lanes) {
+            size_t count = std::min(lanes, members.size() - start);
+            for (size_t lane = 0; lane < count; ++lane) {
+                lanePasswords[lane] = passwords[members[start + lane]];
+                laneSalts[lane] = salts[members[start + lane]];
+            }
+            Sha256MultiBuffer::pbkdf2Sha256(lanePasswords, laneSalts, count, group.first, digests);
+
+            for (size_t lane = 0; lane < count; ++lane) {
+                size_t index = members[start + lane];
+                std::string computed(reinterpret_cast<const char*>(digests + lane * HASH_SIZE), HASH_SIZE);
+                results[index] = constantTimeEquals(computed, expected[index]);
+            }
+        }
+    }
+    return results;
+}
+
+bool PasswordHasher::needsRehash(const std::string& record) const {
+    Params params;
+    std::string salt;
+    std::string digest;
+    if (!parse(record, params, salt, digest) || params.algorithm != defaults.algorithm) {
+        return true;
+    }
+    switch (params.algorithm) {
+    case SCRYPT:
+        return params.scryptN != defaults.scryptN || params.scryptR != defaults.scryptR ||
+            params.scryptP != defaults.scryptP;
+    case PBKDF2_SHA256:
+        return params.iterations != defaults.iterations;
+    default:
+        return true;
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "config.h"
+
+// Password hashing engine. Every stored record carries its own algorithm,
+// cost parameters and salt, so costs can be raised without invalidating
+// existing passwords: a record with weaker parameters than the current
+// defaults still verifies and is rehashed on the next successful login.
+//
+// Record formats (no ':' so they fit the "user:record" lines of users.dat):
+//   scrypt$N$r$p$<salt hex>$<hash hex>
+//   pbkdf2-sha256$<iterations>$<salt hex>$<hash hex>
+//   <64 hex digits>                       legacy SHA-256 with a constant salt
+class PasswordHasher {
+public:
+    enum Algorithm {
+        LEGACY_SHA256,
+        PBKDF2_SHA256,
+        SCRYPT
+    };
+
+    struct Params {
+        Algorithm algorithm;
+        uint32_t iterations;    // PBKDF2
+        uint32_t scryptN;       // scrypt CPU/memory cost, power of two
+        uint32_t scryptR;       // scrypt block size
+        uint32_t scryptP;       // scrypt parallelism
+    };
+
+    static const size_t SALT_SIZE = 16;
+    static const size_t HASH_SIZE = 32;
+
+private:
+    Params defaults;
+
+public:
+    explicit PasswordHasher(const Params& params = defaultParams());
+
+    static Params defaultParams();
+
+    void setDefaults(const Params& params);
+    Params getDefaults() const;
+
+    // New record with a random salt and the default parameters
+    std::string hash(const std::string& password) const;
+    std::string hash(const std::string& password, const std::string& salt, const Params& params) const;
+
+    // Checking a password against a record of any supported format
+    bool verify(const std::string& record, const std::string& password) const;
+
+    // Verifying many logins at once: PBKDF2 records that share an iteration
+    // count are derived eight at a time by the multi-buffer SHA-256 kernel.
+    // scrypt records (the default) are verified one by one: their PBKDF2
+    // stages run a single iteration and nearly all the time goes to ROMix,
+    // which the SHA-256 kernel does not cover, so batching them gains nothing
+    std::vector<bool> verifyBatch(const std::vector<std::string>& records,
+        const std::vector<std::string>& passwords) const;
+
+    // True when the record should be replaced after a successful login
+    bool needsRehash(const std::string& record) const;
+
+    static bool parse(const std::string& record, Params& params, std::string& salt, std::string& digest);
+
+    // Key derivation primitives
+    static void pbkdf2Sha256(const std::string& password, const std::string& salt,
+        uint32_t iterations, uint8_t* output, size_t outputSize);
+    static bool scrypt(const std::string& password, const std::string& salt,
+        uint32_t n, uint32_t r, uint32_t p, uint8_t* output, size_t outputSize);
+};
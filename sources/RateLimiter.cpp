@@ -0,0 +1,219 @@
+#include "RateLimiter.h"
+#include <algorithm>
+#include <chrono>
+#include "MetricsRegistry.h"
+
+namespace {
+
+const uint64_t TOKEN_SCALE = 1000;      // Milli-tokens
+
+uint64_t pack(uint32_t timeMs, uint32_t milliTokens) {
+    return (static_cast<uint64_t>(timeMs) << 32) | milliTokens;
+}
+
+uint32_t refilled(uint64_t state, uint32_t ratePerSecond, uint32_t burst, uint32_t nowMs) {
+    uint32_t lastMs = static_cast<uint32_t>(state >> 32);
+    uint64_t tokens = static_cast<uint32_t>(state);
+    uint64_t elapsed = static_cast<uint32_t>(nowMs - lastMs);   // Wraps correctly
+    uint64_t capacity = static_cast<uint64_t>(burst) * TOKEN_SCALE;
+    return static_cast<uint32_t>(std::min(capacity, tokens + elapsed * ratePerSecond));
+}
+
+Counter& droppedMessages(RateLimiter::Scope scope) {
+    static Counter* metrics[RateLimiter::SCOPE_COUNT] = {
+        &MetricsRegistry::instance().counter("chat_rate_limited_connection_total", "Soobshcheniya, otbroshennye limitom soedineniya"),
+        &MetricsRegistry::instance().counter("chat_rate_limited_user_total", "Soobshcheniya, otbroshennye limitom pol'zovatelya"),
+        &MetricsRegistry::instance().counter("chat_rate_limited_address_total", "Soobshcheniya, otbroshennye limitom podseti"),
+    };
+    return *metrics[scope];
+}
+
+} // namespace
+
+TokenBucket::TokenBucket(uint32_t burst, uint32_t nowMs)
+    : state(pack(nowMs, static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(burst) * TOKEN_SCALE, UINT32_MAX)))) {
+}
+
+bool TokenBucket::tryConsume(uint32_t cost, uint32_t ratePerSecond, uint32_t burst, uint32_t nowMs) {
+    uint64_t need = static_cast<uint64_t>(cost) * TOKEN_SCALE;
+    uint64_t current = state.load(std::memory_order_relaxed);
+    while (true) {
+        uint32_t tokens = refilled(current, ratePerSecond, burst, nowMs);
+        if (tokens < need) {
+            // Nothing is written on rejection: the refill is recomputed next time
+            return false;
+        }
+        if (state.compare_exchange_weak(current, pack(nowMs, static_cast<uint32_t>(tokens - need)),
+                std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+void TokenBucket::refund(uint32_t cost, uint32_t ratePerSecond, uint32_t burst, uint32_t nowMs) {
+    uint64_t capacity = static_cast<uint64_t>(burst) * TOKEN_SCALE;
+    uint64_t current = state.load(std::memory_order_relaxed);
+    while (true) {
+        uint64_t tokens = std::min(capacity, refilled(current, ratePerSecond, burst, nowMs) +
+            static_cast<uint64_t>(cost) * TOKEN_SCALE);
+        if (state.compare_exchange_weak(current, pack(nowMs, static_cast<uint32_t>(tokens)),
+                std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+bool TokenBucket::isFull(uint32_t ratePerSecond, uint32_t burst, uint32_t nowMs) const {
+    return refilled(state.load(std::memory_order_relaxed), ratePerSecond, burst, nowMs) >=
+        static_cast<uint64_t>(burst) * TOKEN_SCALE;
+}
+
+RateLimiter::RateLimiter()
+    : ipv4PrefixLength(RATE_LIMIT_IPV4_PREFIX)
+    , ipv6PrefixLength(RATE_LIMIT_IPV6_PREFIX)
+    , epochMs(std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count()) {
+    policies[CONNECTION_SCOPE] = { RATE_LIMIT_CONNECTION_RATE, RATE_LIMIT_CONNECTION_BURST };
+    policies[USER_SCOPE] = { RATE_LIMIT_USER_RATE, RATE_LIMIT_USER_BURST };
+    policies[ADDRESS_SCOPE] = { RATE_LIMIT_ADDRESS_RATE, RATE_LIMIT_ADDRESS_BURST };
+    for (auto& counter : dropped) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint32_t RateLimiter::nowMs() const {
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return static_cast<uint32_t>(now - epochMs);
+}
+
+void RateLimiter::setPolicy(Scope scope, const RatePolicy& policy) {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    policies[scope] = policy;
+}
+
+RatePolicy RateLimiter::getPolicy(Scope scope) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return policies[scope];
+}
+
+void RateLimiter::setAddressPrefixLengths(int ipv4Prefix, int ipv6Prefix) {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    ipv4PrefixLength = std::max(0, std::min(32, ipv4Prefix));
+    ipv6PrefixLength = std::max(0, std::min(128, ipv6Prefix));
+}
+
+// Address buckets are shared by the whole prefix (/24 and /64 by default)
+std::string RateLimiter::addressKey(const BanList::Address& address) const {
+    static const uint8_t mappedPrefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+    bool ipv4 = std::equal(mappedPrefix, mappedPrefix + 12, address.begin());
+    int prefixLength = ipv4 ? 96 + ipv4PrefixLength : ipv6PrefixLength;
+
+    std::string key(reinterpret_cast<const char*>(address.data()), address.size());
+    for (int bit = prefixLength; bit < 128; ++bit) {
+        key[bit / 8] = static_cast<char>(key[bit / 8] & ~(1 << (7 - bit % 8)));
+    }
+    return key;
+}
+
+RateLimiter::BucketPtr RateLimiter::sharedBucket(std::unordered_map<std::string, BucketPtr>& buckets,
+    const std::string& key, const RatePolicy& policy, uint32_t now) {
+    BucketPtr& bucket = buckets[key];
+    if (!bucket) {
+        bucket = std::make_shared<TokenBucket>(policy.burst, now);
+    }
+    return bucket;
+}
+
+void RateLimiter::addConnection(ConnectionId id, const BanList::Address& address) {
+    uint32_t now = nowMs();
+    std::unique_lock<std::shared_mutex> lock(mtx);
+
+    std::unique_ptr<Connection> connection(new Connection{
+        TokenBucket(policies[CONNECTION_SCOPE].burst, now), nullptr, nullptr });
+    connection->address = sharedBucket(addressBuckets, addressKey(address), policies[ADDRESS_SCOPE], now);
+    connections[id] = std::move(connection);
+}
+
+void RateLimiter::bindUser(ConnectionId id, const std::string& username) {
+    uint32_t now = nowMs();
+    std::unique_lock<std::shared_mutex> lock(mtx);
+
+    auto it = connections.find(id);
+    if (it != connections.end()) {
+        it->second->user = sharedBucket(userBuckets, username, policies[USER_SCOPE], now);
+    }
+}
+
+void RateLimiter::removeConnection(ConnectionId id) {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    connections.erase(id);
+}
+
+bool RateLimiter::allow(ConnectionId id, uint32_t cost) {
+    uint32_t now = nowMs();
+    std::shared_lock<std::shared_mutex> lock(mtx);
+
+    auto it = connections.find(id);
+    if (it == connections.end()) {
+        return true;
+    }
+    Connection& connection = *it->second;
+
+    // Narrowest scope first: a flooding connection does not drain its user or subnet
+    Scope rejected = SCOPE_COUNT;
+    const RatePolicy& own = policies[CONNECTION_SCOPE];
+    const RatePolicy& user = policies[USER_SCOPE];
+    const RatePolicy& address = policies[ADDRESS_SCOPE];
+    if (!connection.own.tryConsume(cost, own.ratePerSecond, own.burst, now)) {
+        rejected = CONNECTION_SCOPE;
+    }
+    else if (connection.user && !connection.user->tryConsume(cost, user.ratePerSecond, user.burst, now)) {
+        rejected = USER_SCOPE;
+    }
+    else if (connection.address && !connection.address->tryConsume(cost, address.ratePerSecond, address.burst, now)) {
+        rejected = ADDRESS_SCOPE;
+    }
+
+    // A dropped message costs nothing: narrower buckets charged before the
+    // rejecting scope get their tokens back
+    if (rejected == ADDRESS_SCOPE && connection.user) {
+        connection.user->refund(cost, user.ratePerSecond, user.burst, now);
+    }
+    if (rejected == USER_SCOPE || rejected == ADDRESS_SCOPE) {
+        connection.own.refund(cost, own.ratePerSecond, own.burst, now);
+    }
+
+    if (rejected == SCOPE_COUNT) {
+        return true;
+    }
+    dropped[rejected].fetch_add(1, std::memory_order_relaxed);
+    droppedMessages(rejected).add();
+    return false;
+}
+
+size_t RateLimiter::prune() {
+    uint32_t now = nowMs();
+    std::unique_lock<std::shared_mutex> lock(mtx);
+
+    // An idle bucket is full again, forgetting it loses nothing
+    size_t removed = 0;
+    auto pruneMap = [&](std::unordered_map<std::string, BucketPtr>& buckets, const RatePolicy& policy) {
+        for (auto it = buckets.begin(); it != buckets.end();) {
+            if (it->second.use_count() == 1 && it->second->isFull(policy.ratePerSecond, policy.burst, now)) {
+                it = buckets.erase(it);
+                ++removed;
+            }
+            else {
+                ++it;
+            }
+        }
+    };
+    pruneMap(userBuckets, policies[USER_SCOPE]);
+    pruneMap(addressBuckets, policies[ADDRESS_SCOPE]);
+    return removed;
+}
+
+uint64_t RateLimiter::getDroppedCount(Scope scope) const {
+    return dropped[scope].load(std::memory_order_relaxed);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include "config.h"
+#include "BanList.h"
+#include "RoomIndex.h"
+
+// Token bucket packed into one 64-bit atomic: refill timestamp (ms) in the
+// high half and milli-tokens in the low half. Refill is lazy: tokens are
+// added from the elapsed time when the bucket is consumed, no timer thread.
+class TokenBucket {
+private:
+    std::atomic<uint64_t> state;
+
+public:
+    explicit TokenBucket(uint32_t burst = 0, uint32_t nowMs = 0);
+
+    // Taking cost tokens; ratePerSecond also equals milli-tokens per ms
+    bool tryConsume(uint32_t cost, uint32_t ratePerSecond, uint32_t burst, uint32_t nowMs);
+
+    // Returning tokens taken for a message that a wider scope then rejected
+    void refund(uint32_t cost, uint32_t ratePerSecond, uint32_t burst, uint32_t nowMs);
+
+    // True when the bucket has refilled completely (idle)
+    bool isFull(uint32_t ratePerSecond, uint32_t burst, uint32_t nowMs) const;
+};
+
+// Sustained rate and burst size of one limiter scope
+struct RatePolicy {
+    uint32_t ratePerSecond;
+    uint32_t burst;
+};
+
+// Receive-path limiter with buckets per connection, per user and per IP
+// prefix. A message passes only if all three buckets have a token, so one
+// client cannot flood through many connections or many accounts.
+class RateLimiter {
+public:
+    enum Scope {
+        CONNECTION_SCOPE,
+        USER_SCOPE,
+        ADDRESS_SCOPE,
+        SCOPE_COUNT
+    };
+
+private:
+    using BucketPtr = std::shared_ptr<TokenBucket>;
+
+    struct Connection {
+        TokenBucket own;
+        BucketPtr user;
+        BucketPtr address;
+    };
+
+    mutable std::shared_mutex mtx;
+    std::unordered_map<ConnectionId, std::unique_ptr<Connection>> connections;
+    std::unordered_map<std::string, BucketPtr> userBuckets;
+    std::unordered_map<std::string, BucketPtr> addressBuckets;
+
+    RatePolicy policies[SCOPE_COUNT];
+    std::atomic<uint64_t> dropped[SCOPE_COUNT];
+    int ipv4PrefixLength;
+    int ipv6PrefixLength;
+    int64_t epochMs;
+
+    uint32_t nowMs() const;
+    std::string addressKey(const BanList::Address& address) const;
+    BucketPtr sharedBucket(std::unordered_map<std::string, BucketPtr>& buckets,
+        const std::string& key, const RatePolicy& policy, uint32_t now);
+
+public:
+    RateLimiter();
+
+    // Policies can be changed at runtime; buckets keep their tokens
+    void setPolicy(Scope scope, const RatePolicy& policy);
+    RatePolicy getPolicy(Scope scope) const;
+    void setAddressPrefixLengths(int ipv4Prefix, int ipv6Prefix);
+
+    // Connection lifecycle
+    void addConnection(ConnectionId id, const BanList::Address& address);
+    void bindUser(ConnectionId id, const std::string& username);
+    void removeConnection(ConnectionId id);
+
+    // Checking one message of the connection; unknown connections pass
+    bool allow(ConnectionId id, uint32_t cost = 1);
+
+    // Dropping idle user/address buckets that no connection references
+    size_t prune();
+
+    uint64_t getDroppedCount(Scope scope) const;
+};
@@ -0,0 +1,143 @@
+#include "RoomIndex.h"
+#include <algorithm>
+#include <mutex>
+
+// Constructor
+RoomIndex::RoomIndex(size_t maxRoomCount) : maxRooms(maxRoomCount) {
+}
+
+// Subscribing connection to room
+bool RoomIndex::join(const std::string& room, ConnectionId id) {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+
+    uint32_t slot;
+    auto it = roomSlots.find(room);
+    if (it != roomSlots.end()) {
+        slot = it->second;
+    }
+    else {
+        if (roomSlots.size() >= maxRooms) {
+            return false;
+        }
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else {
+            slot = static_cast<uint32_t>(rooms.size());
+            rooms.emplace_back();
+        }
+        rooms[slot].name = room;
+        roomSlots.emplace(room, slot);
+    }
+
+    Room& target = rooms[slot];
+    if (target.positions.count(id)) {
+        return true;
+    }
+    target.positions.emplace(id, target.members.size());
+    target.members.push_back(id);
+    memberships[id].push_back(slot);
+    return true;
+}
+
+// Unsubscribing connection from room
+bool RoomIndex::leave(const std::string& room, ConnectionId id) {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+
+    auto it = roomSlots.find(room);
+    if (it == roomSlots.end()) {
+        return false;
+    }
+    uint32_t slot = it->second;
+    if (!rooms[slot].positions.count(id)) {
+        return false;
+    }
+
+    auto membership = memberships.find(id);
+    std::vector<uint32_t>& slots = membership->second;
+    slots.erase(std::find(slots.begin(), slots.end(), slot));
+    if (slots.empty()) {
+        memberships.erase(membership);
+    }
+
+    removeMember(slot, id);
+    return true;
+}
+
+// Removing connection from all its rooms
+void RoomIndex::removeConnection(ConnectionId id) {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+
+    auto membership = memberships.find(id);
+    if (membership == memberships.end()) {
+        return;
+    }
+    for (uint32_t slot : membership->second) {
+        removeMember(slot, id);
+    }
+    memberships.erase(membership);
+}
+
+// Swap-remove from the compact member vector
+void RoomIndex::removeMember(uint32_t slot, ConnectionId id) {
+    Room& room = rooms[slot];
+    auto position = room.positions.find(id);
+    size_t index = position->second;
+    ConnectionId last = room.members.back();
+
+    room.members[index] = last;
+    room.positions[last] = index;
+    room.members.pop_back();
+    room.positions.erase(id);
+
+    if (room.members.empty()) {
+        roomSlots.erase(room.name);
+        room.name.clear();
+        room.positions.clear();
+        freeSlots.push_back(slot);
+    }
+}
+
+// Copy of room members
+std::vector<ConnectionId> RoomIndex::getMembers(const std::string& room) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    auto it = roomSlots.find(room);
+    if (it == roomSlots.end()) {
+        return std::vector<ConnectionId>();
+    }
+    return rooms[it->second].members;
+}
+
+// Rooms the connection is subscribed to
+std::vector<std::string> RoomIndex::getRooms(ConnectionId id) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    std::vector<std::string> result;
+    auto membership = memberships.find(id);
+    if (membership != memberships.end()) {
+        for (uint32_t slot : membership->second) {
+            result.push_back(rooms[slot].name);
+        }
+    }
+    return result;
+}
+
+bool RoomIndex::isMember(const std::string& room, ConnectionId id) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    auto it = roomSlots.find(room);
+    return it != roomSlots.end() && rooms[it->second].positions.count(id) > 0;
+}
+
+size_t RoomIndex::getRoomCount() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return roomSlots.size();
+}
+
+bool RoomIndex::isValidName(const std::string& room) {
+    if (room.size() < 2 || room.size() > ROOM_NAME_MAX_LENGTH || room[0] != ROOM_PREFIX) {
+        return false;
+    }
+    return std::none_of(room.begin() + 1, room.end(), [](char c) {
+        return static_cast<unsigned char>(c) < 0x20 || c == ' ' || c == ':' || c == ROOM_PREFIX;
+    });
+}
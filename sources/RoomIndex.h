@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "config.h"
+
+// Connection identifier assigned by NetworkManager on accept
+using ConnectionId = uint32_t;
+
+// Subscription index: room name -> compact vector of member connections.
+// Join/leave are O(1) (swap-remove), fan-out touches only room members.
+class RoomIndex {
+private:
+    struct Room {
+        std::string name;
+        std::vector<ConnectionId> members;
+        std::unordered_map<ConnectionId, size_t> positions;  // Index in members
+    };
+
+    mutable std::shared_mutex mtx;
+    size_t maxRooms;
+    std::vector<Room> rooms;
+    std::vector<uint32_t> freeSlots;                          // Reusable room slots
+    std::unordered_map<std::string, uint32_t> roomSlots;      // Name -> slot
+    std::unordered_map<ConnectionId, std::vector<uint32_t>> memberships;
+
+    // Removing member from room slot, dropping the room when it becomes empty
+    void removeMember(uint32_t slot, ConnectionId id);
+
+public:
+    explicit RoomIndex(size_t maxRoomCount = MAX_GROUPS);
+
+    // Subscribing connection to room (room is created on first join)
+    bool join(const std::string& room, ConnectionId id);
+
+    // Unsubscribing connection from room
+    bool leave(const std::string& room, ConnectionId id);
+
+    // Removing connection from all its rooms (on disconnect)
+    void removeConnection(ConnectionId id);
+
+    // Calling handler for every member of the room under a shared lock
+    template <typename Handler>
+    size_t forEachMember(const std::string& room, Handler&& handler) const {
+        std::shared_lock<std::shared_mutex> lock(mtx);
+        auto it = roomSlots.find(room);
+        if (it == roomSlots.end()) {
+            return 0;
+        }
+        const std::vector<ConnectionId>& members = rooms[it->second].members;
+        for (ConnectionId id : members) {
+            handler(id);
+        }
+        return members.size();
+    }
+
+    // Copy of room members
+    std::vector<ConnectionId> getMembers(const std::string& room) const;
+
+    // Rooms the connection is subscribed to
+    std::vector<std::string> getRooms(ConnectionId id) const;
+
+    bool isMember(const std::string& room, ConnectionId id) const;
+    size_t getRoomCount() const;
+
+    // "#name" up to ROOM_NAME_MAX_LENGTH without spaces, ':' or control
+    // characters, which would break "sender -> #room: text" parsing
+    static bool isValidName(const std::string& room);
+};
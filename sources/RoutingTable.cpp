@@ -0,0 +1,63 @@
+#include "RoutingTable.h"
+#include <algorithm>
+#include <mutex>
+
+// Binding connection to user
+void RoutingTable::bind(const std::string& username, ConnectionId id) {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+
+    // Re-login on the same connection replaces the previous binding
+    unbindLocked(id);
+    routes[username].push_back(id);
+    owners.emplace(id, username);
+}
+
+// Unbinding connection
+void RoutingTable::unbind(ConnectionId id) {
+    std::unique_lock<std::shared_mutex> lock(mtx);
+    unbindLocked(id);
+}
+
+void RoutingTable::unbindLocked(ConnectionId id) {
+    auto owner = owners.find(id);
+    if (owner == owners.end()) {
+        return;
+    }
+
+    // A user has only a handful of devices, so the scan is bounded
+    auto route = routes.find(owner->second);
+    std::vector<ConnectionId>& connections = route->second;
+    auto it = std::find(connections.begin(), connections.end(), id);
+    *it = connections.back();
+    connections.pop_back();
+    if (connections.empty()) {
+        routes.erase(route);
+    }
+    owners.erase(owner);
+}
+
+std::string RoutingTable::getUsername(ConnectionId id) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    auto owner = owners.find(id);
+    return owner != owners.end() ? owner->second : std::string();
+}
+
+bool RoutingTable::isOnline(const std::string& username) const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return routes.count(username) > 0;
+}
+
+std::vector<std::string> RoutingTable::getUsers() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    std::vector<std::string> users;
+    users.reserve(routes.size());
+    for (const auto& route : routes) {
+        users.push_back(route.first);
+    }
+    return users;
+}
+
+size_t RoutingTable::getUserCount() const {
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    return routes.size();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "RoomIndex.h"
+
+// Routing table: username -> live connections of that user (one per device).
+// Lookup by username and unbinding by connection id are O(1) on average.
+class RoutingTable {
+private:
+    mutable std::shared_mutex mtx;
+    std::unordered_map<std::string, std::vector<ConnectionId>> routes;
+    std::unordered_map<ConnectionId, std::string> owners;   // Connection -> username
+
+    // Removing connection from its user's route without locking
+    void unbindLocked(ConnectionId id);
+
+public:
+    // Binding connection to user after successful login
+    void bind(const std::string& username, ConnectionId id);
+
+    // Unbinding connection on logout or disconnect
+    void unbind(ConnectionId id);
+
+    // Calling handler for every live connection of the user under a shared lock
+    template <typename Handler>
+    size_t forEachConnection(const std::string& username, Handler&& handler) const {
+        std::shared_lock<std::shared_mutex> lock(mtx);
+        auto it = routes.find(username);
+        if (it == routes.end()) {
+            return 0;
+        }
+        for (ConnectionId id : it->second) {
+            handler(id);
+        }
+        return it->second.size();
+    }
+
+    // Username bound to connection (empty if not logged in)
+    std::string getUsername(ConnectionId id) const;
+
+    bool isOnline(const std::string& username) const;
+    std::vector<std::string> getUsers() const;
+    size_t getUserCount() const;
+};
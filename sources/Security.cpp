@@ -1,13 +1,19 @@
 #include "Security.h"
+#include "MetricsRegistry.h"
+#include "TraceRecorder.h"
 #include <QDebug>
 #include <QFile>
+#include <QDir>
 #include <QDateTime>
 #include <QCoreApplication>
+#include <QRandomGenerator>
 
 // Constructor
-SecurityManager::SecurityManager(Logger* log) : logger(log) {
+SecurityManager::SecurityManager(Logger* log) : logger(log), sessionTokens(loadSessionKey(log)) {
     // Loading the list of registered users at startup
     loadRegisteredUsers();
+    dummyRecord = passwordHasher.hash(std::string(), std::string(PasswordHasher::SALT_SIZE, '\0'),
+        passwordHasher.getDefaults());
 }
 
 // Destructor
@@ -17,24 +23,24 @@ SecurityManager::~SecurityManager() {
 
 // Registering a new user
 bool SecurityManager::registerUser(const QString& username, const QString& password) {
-    std::lock_guard<std::mutex> lock(mtx);
-
     if (!isValidUsername(username)) {
         logger->log("Registration error: invalid username");
         return false;
     }
 
-    if (userExists(username)) {
-        logger->log("Registration error: user already exists");
-        return false;
-    }
-
     if (password.isEmpty() || password.length() < 6) {
         logger->log("Registration error: weak password");
         return false;
     }
 
+    // The slow hash is computed outside the lock
     QString hashedPassword = hashPassword(password);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (findUserLocked(username) >= 0) {
+        logger->log("Registration error: user already exists");
+        return false;
+    }
     registeredUsers.push_back(username.toStdString() + ":" + hashedPassword.toStdString());
 
     // Saving changes
@@ -44,43 +50,179 @@ bool SecurityManager::registerUser(const QString& username, const QString& passw
     return true;
 }
 
+// Provisioning accounts in bulk
+int SecurityManager::registerUsers(const QStringList& usernames, const QString& password) {
+    if (password.length() < 6) {
+        logger->log("Registration error: weak password");
+        return 0;
+    }
+
+    std::vector<std::string> records;
+    for (const QString& username : usernames) {
+        if (!isValidUsername(username) || userExists(username)) {
+            logger->log("Registration skipped for " + username);
+            continue;
+        }
+        records.push_back(username.toStdString() + ":" + hashPassword(password).toStdString());
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    int added = 0;
+    for (const std::string& record : records) {
+        if (findUserLocked(QString::fromStdString(record.substr(0, record.find(':')))) < 0) {
+            registeredUsers.push_back(record);
+            ++added;
+        }
+    }
+    saveRegisteredUsers();
+    logger->log(QString::number(added) + " users registered");
+    return added;
+}
+
 // User authentication
 bool SecurityManager::authenticateUser(const QString& username, const QString& password) {
-    std::lock_guard<std::mutex> lock(mtx);
+    CHAT_TRACE_SCOPE("SecurityManager::authenticateUser");
+    ScopedLatency latency(Metrics::authLatency());
+
+    // Only the lookup holds the lock, so concurrent logins verify in parallel
+    std::string record;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        int index = findUserLocked(username);
+        if (index >= 0) {
+            record = registeredUsers[index];
+        }
+    }
+    if (record.empty()) {
+        passwordHasher.verify(dummyRecord, password.toStdString());
+        logger->log("Authentication error: user not found");
+        return false;
+    }
+    QString storedHash = QString::fromStdString(record.substr(record.find(':') + 1));
 
-    for (const auto& user : registeredUsers) {
-        QStringList parts = QString::fromStdString(user).split(':');
-        if (parts.size() == 2 && parts[0] == username) {
-            if (verifyPassword(parts[1], password)) {
-                logger->log("Successful authentication of user " + username);
-                return true;
-            }
-            else {
-                logger->log("Authentication error: incorrect password for user " + username);
-            }
+    if (!verifyPassword(storedHash, password)) {
+        logger->log("Authentication error: incorrect password for user " + username);
+        return false;
+    }
+
+    upgradeRecord(username, password, record);
+    logger->log("Successful authentication of user " + username);
+    return true;
+}
+
+// Batch authentication
+QVector<bool> SecurityManager::authenticateUsers(const QVector<QPair<QString, QString>>& credentials) {
+    CHAT_TRACE_SCOPE("SecurityManager::authenticateUsers");
+    QVector<bool> results(credentials.size(), false);
+
+    std::vector<std::string> records;
+    std::vector<std::string> passwords;
+    std::vector<int> positions;
+    {
+        // Unknown users are verified against the dummy record and never accepted
+        std::lock_guard<std::mutex> lock(mtx);
+        for (int i = 0; i < credentials.size(); ++i) {
+            int index = findUserLocked(credentials[i].first);
+            records.push_back(index >= 0 ? registeredUsers[index] : ":" + dummyRecord);
+            passwords.push_back(credentials[i].second.toStdString());
+            positions.push_back(index >= 0 ? i : -1);
+        }
+    }
+
+    std::vector<std::string> hashes;
+    hashes.reserve(records.size());
+    for (const std::string& record : records) {
+        hashes.push_back(record.substr(record.find(':') + 1));
+    }
+    std::vector<bool> verified = passwordHasher.verifyBatch(hashes, passwords);
+
+    int accepted = 0;
+    for (size_t i = 0; i < verified.size(); ++i) {
+        if (verified[i] && positions[i] >= 0) {
+            const QPair<QString, QString>& credential = credentials[positions[i]];
+            upgradeRecord(credential.first, credential.second, records[i]);
+            results[positions[i]] = true;
+            ++accepted;
         }
     }
+    logger->log("Batch authentication: " + QString::number(accepted) + " of " +
+        QString::number(credentials.size()) + " accepted");
+    return results;
+}
+
+// Records with an old algorithm or cost are upgraded while the password is known
+void SecurityManager::upgradeRecord(const QString& username, const QString& password, const std::string& record) {
+    if (!passwordHasher.needsRehash(record.substr(record.find(':') + 1))) {
+        return;
+    }
+    std::string upgraded = username.toStdString() + ":" + hashPassword(password).toStdString();
 
-    logger->log("Authentication error: user not found");
-    return false;
+    std::lock_guard<std::mutex> lock(mtx);
+    int index = findUserLocked(username);
+    if (index >= 0 && registeredUsers[index] == record) {
+        registeredUsers[index] = upgraded;
+        saveRegisteredUsers();
+        logger->log("Password hash of user " + username + " upgraded");
+    }
+}
+
+// Issuing a session token for an authenticated user
+QString SecurityManager::issueSessionToken(const QString& username) {
+    sessionTokens.purgeExpired();
+    return sessionTokens.issue(username);
+}
+
+// Token authentication: MAC, expiry and revocation checks only
+bool SecurityManager::authenticateToken(const QString& username, const QString& token) {
+    CHAT_TRACE_SCOPE("SecurityManager::authenticateToken");
+    ScopedLatency latency(Metrics::authLatency());
+
+    QString owner = sessionTokens.validate(token);
+    if (owner.isEmpty() || owner != username) {
+        logger->log("Token authentication error for user " + username);
+        return false;
+    }
+    logger->log("Successful token authentication of user " + username);
+    return true;
+}
+
+// Revoking every token issued to the user
+void SecurityManager::revokeSessionTokens(const QString& username) {
+    sessionTokens.revokeUser(username);
+    logger->log("Session tokens revoked for user " + username);
 }
 
 // Checking user existence
 bool SecurityManager::userExists(const QString& username) const {
     std::lock_guard<std::mutex> lock(mtx);
+    return findUserLocked(username) >= 0;
+}
 
-    for (const auto& user : registeredUsers) {
-        QStringList parts = QString::fromStdString(user).split(':');
-        if (parts.size() == 2 && parts[0] == username) {
-            return true;
+// Usernames only, the password records stay inside the manager
+std::vector<std::string> SecurityManager::getRegisteredUsers() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<std::string> users;
+    users.reserve(registeredUsers.size());
+    for (const std::string& record : registeredUsers) {
+        users.push_back(record.substr(0, record.find(':')));
+    }
+    return users;
+}
+
+int SecurityManager::findUserLocked(const QString& username) const {
+    std::string prefix = username.toStdString() + ":";
+    for (size_t i = 0; i < registeredUsers.size(); ++i) {
+        if (registeredUsers[i].compare(0, prefix.size(), prefix) == 0) {
+            return static_cast<int>(i);
         }
     }
-    return false;
+    return -1;
 }
 
 // Saving the list of users to a file
 void SecurityManager::saveRegisteredUsers() const {
-    QFile file("users.dat");
+    QDir().mkpath(DATA_DIR);
+    QFile file(USERS_FILE);
     if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
         logger->log("Error saving user list");
         return;
@@ -95,7 +237,12 @@ void SecurityManager::saveRegisteredUsers() const {
 
 // Loading the list of users from a file
 void SecurityManager::loadRegisteredUsers() {
-    QFile file("users.dat");
+    QFile file(USERS_FILE);
+    if (!file.exists()) {
+        // Older versions kept users.dat in the working directory;
+        // it is read once and written back to USERS_FILE on the next save
+        file.setFileName("users.dat");
+    }
     if (!file.exists()) {
         logger->log("User file not found, creating a new one");
         return;
@@ -117,6 +264,30 @@ void SecurityManager::loadRegisteredUsers() {
     file.close();
 }
 
+// The key is kept next to the user list so tokens stay valid across restarts;
+// if it cannot be stored, tokens only live as long as the process
+QByteArray SecurityManager::loadSessionKey(Logger* logger) {
+    const int keySize = 32;
+    QFile file(SESSION_KEY_FILE);
+    if (file.open(QIODevice::ReadOnly)) {
+        QByteArray key = file.readAll();
+        if (key.size() >= keySize) {
+            return key;
+        }
+        file.close();
+    }
+
+    QByteArray key(keySize, Qt::Uninitialized);
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32*>(key.data()), keySize / 4);
+    QDir().mkpath(DATA_DIR);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(key) != key.size()) {
+        logger->log("Error saving session key, tokens will not survive a restart");
+        return key;
+    }
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    return key;
+}
+
 // Username validation
 bool SecurityManager::isValidUsername(const QString& username) const {
     // Checking length and allowed characters
@@ -124,103 +295,12 @@ bool SecurityManager::isValidUsername(const QString& username) const {
         username.matches(QRegularExpression("[a-zA-Z0-9_]+"));
 }
 
-// Password hashing with salt
+// Password hashing with a random per-user salt and the configured cost
 QString SecurityManager::hashPassword(const QString& password) const {
-    // Creating a unique salt for each password
-    QByteArray salt = QCryptographicHash::hash(QByteArray("salt"), QCryptographicHash::Sha256);
-    QByteArray hash = QCryptographicHash::hash(password.toUtf8() + salt, QCryptographicHash::Sha256);
-    return hash.toHex();
-}
-
-// Improved version with dynamic salt
-QString SecurityManager::hashPasswordWithDynamicSalt(const QString& password) const {
-    // Generating a unique salt for each password
-    QByteArray salt = QCryptographicHash::hash(QByteArray::fromHex(QString::number(QRandomGenerator::global()->generate64()).toLatin1()), QCryptographicHash::Sha256);
-
-    // Saving salt along with hash
-    QByteArray data = salt + password.toUtf8();
-    QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha256);
-
-    // Returning salt and hash in "salt:hash" format
-    return salt.toHex() + ":" + hash.toHex();
-}
-
-// Method for password verification with salt
-bool SecurityManager::verifyPasswordWithSalt(const QString& storedHash, const QString& providedPassword) const {
-    // Splitting stored hash into salt and actual hash
-    QStringList parts = storedHash.split(':');
-    if (parts.size() != 2) {
-        return false;
-    }
-
-    QByteArray salt = QByteArray::fromHex(parts[0]);
-    QByteArray storedHashBytes = QByteArray::fromHex(parts[1]);
-
-    // Calculating hash for provided password
-    QByteArray data = salt + providedPassword.toUtf8();
-    QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha256);
-
-    return hash == storedHashBytes;
-}
-
-// Method for generating strong salt
-QByteArray SecurityManager::generateSalt() const {
-    QByteArray salt;
-    QCryptographicHash hash(QCryptographicHash::Sha256);
-    salt.reserve(16);
-    for (int n = 0; n < 16; ++n)
-        salt.append(char(QRandomGenerator::global()->generate() % 256));
-    hash.addData(salt);
-    return hash.result();
-}
-
-// Method for registering user with dynamic salt
-bool SecurityManager::registerUserWithSalt(const QString& username, const QString& password) {
-    std::lock_guard<std::mutex> lock(mtx);
-
-    if (!isValidUsername(username)) {
-        logger->log("Registration error: invalid username");
-        return false;
-    }
-
-    if (userExists(username)) {
-        logger->log("Registration error: user already exists");
-        return false;
-    }
-
-    if (password.isEmpty() || password.length() < 6) {
-        logger->log("Registration error: weak password");
-        return false;
-    }
-
-    // Generating salt and hashing password
-    QString hashedPassword = hashPasswordWithDynamicSalt(password);
-    registeredUsers.push_back(username.toStdString() + ":" + hashedPassword.toStdString());
-
-    // Saving changes
-    saveRegisteredUsers();
-
-    logger->log("User " + username + " successfully registered");
-    return true;
+    return QString::fromStdString(passwordHasher.hash(password.toStdString()));
 }
 
-// Method for authentication with salt
-bool SecurityManager::authenticateUserWithSalt(const QString& username, const QString& password) {
-    std::lock_guard<std::mutex> lock(mtx);
-
-    for (const auto& user : registeredUsers) {
-        QStringList parts = QString::fromStdString(user).split(':');
-        if (parts.size() == 2 && parts[0] == username) {
-            if (verifyPasswordWithSalt(parts[1], password)) {
-                logger->log("Successful authentication of user " + username);
-                return true;
-            }
-            else {
-                logger->log("Authentication error: incorrect password for user " + username);
-            }
-        }
-    }
-
-    logger->log("Authentication error: user not found");
-    return false;
+// Password verification against a record of any supported format
+bool SecurityManager::verifyPassword(const QString& storedHash, const QString& providedPassword) const {
+    return passwordHasher.verify(storedHash.toStdString(), providedPassword.toStdString());
 }
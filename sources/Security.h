@@ -3,24 +3,50 @@
 #include <QString>
 #include <QByteArray>
 #include <QStringList>
+#include <QVector>
+#include <QPair>
 #include <QDebug>
-#include <QCryptographicHash>
 #include <vector>
 #include <mutex>
 #include "Logger.h"
+#include "SessionTokens.h"
+#include "PasswordHasher.h"
 
 class SecurityManager {
 private:
     Logger* logger;
-    std::mutex mtx;
+    mutable std::mutex mtx;
     std::vector<std::string> registeredUsers;
 
+    // Salted, tunable password hashes stored per record
+    PasswordHasher passwordHasher;
+
+    // Signed tokens for reconnects without the password
+    SessionTokenManager sessionTokens;
+
+    // Record with the default cost that unknown usernames are verified
+    // against, so a login takes as long whether or not the user exists
+    std::string dummyRecord;
+
     // Password hashing
     QString hashPassword(const QString& password) const;
 
     // Password verification
     bool verifyPassword(const QString& storedHash, const QString& providedPassword) const;
 
+    // Index of the user's record, -1 if absent; mtx must be held
+    int findUserLocked(const QString& username) const;
+
+    // Replacing a record with a hash at the current cost after a successful login
+    void upgradeRecord(const QString& username, const QString& password, const std::string& record);
+
+    // USERS_FILE persistence; mtx must be held
+    void saveRegisteredUsers() const;
+    void loadRegisteredUsers();
+
+    // Token signing key from SESSION_KEY_FILE, created on first start
+    static QByteArray loadSessionKey(Logger* logger);
+
 public:
     SecurityManager(Logger* log);
     ~SecurityManager();
@@ -28,96 +54,30 @@ public:
     // Registering a new user
     bool registerUser(const QString& username, const QString& password);
 
+    // Provisioning many accounts with one password (chat-server -add-users);
+    // existing users are skipped, the file is written once. Returns the number added
+    int registerUsers(const QStringList& usernames, const QString& password);
+
     // User authentication
     bool authenticateUser(const QString& username, const QString& password);
 
+    // Batch authentication for login storms: one lookup pass under the lock,
+    // then all passwords are verified together outside it. The server passes
+    // every /login that arrived during one event-loop pass through here
+    QVector<bool> authenticateUsers(const QVector<QPair<QString, QString>>& credentials);
+
+    // Session tokens: issued after password authentication, checked by MAC
+    QString issueSessionToken(const QString& username);
+    bool authenticateToken(const QString& username, const QString& token);
+    void revokeSessionTokens(const QString& username);
+
     // Checking user existence
     bool userExists(const QString& username) const;
 
-    // Getting the list of registered users
+    // Getting the list of registered usernames
     std::vector<std::string> getRegisteredUsers() const;
 
-    // Resetting passwords (for debugging)
-    void resetPasswords();
-
     // Username validation
     bool isValidUsername(const QString& username) const;
 };
 
-// Implementation of methods
-
-QString SecurityManager::hashPassword(const QString& password) const {
-    QByteArray salt = QCryptographicHash::hash(QByteArray("salt"), QCryptographicHash::Sha256);
-    QByteArray hash = QCryptographicHash::hash(password.toUtf8() + salt, QCryptographicHash::Sha256);
-    return hash.toHex();
-}
-
-bool SecurityManager::verifyPassword(const QString& storedHash, const QString& providedPassword) const {
-    return storedHash == hashPassword(providedPassword);
-}
-
-SecurityManager::SecurityManager(Logger* log) : logger(log) {
-    registeredUsers = std::vector<std::string>();
-}
-
-SecurityManager::~SecurityManager() {
-    // Data cleaning
-    registeredUsers.clear();
-}
-
-bool SecurityManager::registerUser(const QString& username, const QString& password) {
-    std::lock_guard<std::mutex> lock(mtx);
-
-    if (!isValidUsername(username)) {
-        logger->log("Invalid username during registration");
-        return false;
-    }
-
-    if (userExists(username)) {
-        logger->log("User already exists");
-        return false;
-    }
-
-    QString hashedPassword = hashPassword(password);
-    registeredUsers.push_back(username.toStdString() + ":" + hashedPassword.toStdString());
-
-    logger->log("User successfully registered");
-    return true;
-}
-
-bool SecurityManager::authenticateUser(const QString& username, const QString& password) {
-    std::lock_guard<std::mutex> lock(mtx);
-
-    for (const auto& user : registeredUsers) {
-        QStringList parts = QString::fromStdString(user).split(':');
-        if (parts.size() == 2 && parts[0] == username) {
-            return verifyPassword(parts[1], password);
-        }
-    }
-
-    logger->log("Authentication error");
-    return false;
-}
-
-bool SecurityManager::userExists(const QString& username) const {
-    std::lock_guard<std::mutex> lock(mtx);
-
-    for (const auto& user : registeredUsers) {
-        QStringList parts = QString::fromStdString(user).split(':');
-        if (parts.size() == 2 && parts[0] == username) {
-            return true;
-        }
-    }
-    return false;
-}
-
-std::vector<std::string> SecurityManager::getRegisteredUsers() const {
-    std::lock_guard<std::mutex> lock(mtx);
-    return registeredUsers;
-}
-
-bool SecurityManager::isValidUsername(const QString& username) const {
-    // Simple validation: length 3-20 characters, only letters and numbers
-    return username.size() >= 3 && username.size() <= 20 &&
-        username.matches(QRegularExpression("[a-zA-Z0-9]+"));
-}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "RoomIndex.h"
+
+// Sharded concurrent registry of sessions keyed by connection id.
+// Insert/remove/find lock only one shard; iteration walks per-shard
+// copy-on-read snapshots without holding any lock, so broadcast does not
+// block accept or disconnect.
+template <typename Value>
+class SessionRegistry {
+public:
+    using Snapshot = std::vector<Value>;
+
+private:
+    struct alignas(64) Shard {
+        mutable std::mutex mtx;
+        std::unordered_map<ConnectionId, Value> sessions;
+        mutable std::shared_ptr<const Snapshot> snapshot = std::make_shared<const Snapshot>();
+        mutable std::atomic<bool> dirty{ false };
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    size_t shardMask;
+    std::atomic<size_t> sessionCount{ 0 };
+
+    Shard& shardFor(ConnectionId id) const {
+        return *shards[id & shardMask];
+    }
+
+    // Current snapshot of a shard, rebuilt only after a change
+    std::shared_ptr<const Snapshot> shardSnapshot(const Shard& shard) const {
+        if (!shard.dirty.load(std::memory_order_acquire)) {
+            return std::atomic_load(&shard.snapshot);
+        }
+
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        if (shard.dirty.load(std::memory_order_relaxed)) {
+            auto rebuilt = std::make_shared<Snapshot>();
+            rebuilt->reserve(shard.sessions.size());
+            for (const auto& session : shard.sessions) {
+                rebuilt->push_back(session.second);
+            }
+            std::atomic_store(&shard.snapshot, std::shared_ptr<const Snapshot>(std::move(rebuilt)));
+            shard.dirty.store(false, std::memory_order_release);
+        }
+        return std::atomic_load(&shard.snapshot);
+    }
+
+public:
+    // Shard count is rounded up to a power of two
+    explicit SessionRegistry(size_t shardCount = 16) {
+        size_t count = 1;
+        while (count < shardCount) {
+            count <<= 1;
+        }
+        shardMask = count - 1;
+        for (size_t i = 0; i < count; ++i) {
+            shards.push_back(std::make_unique<Shard>());
+        }
+    }
+
+    // Registering session, replaces an existing one with the same id
+    void insert(ConnectionId id, Value value) {
+        Shard& shard = shardFor(id);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        if (shard.sessions.insert_or_assign(id, std::move(value)).second) {
+            sessionCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        shard.dirty.store(true, std::memory_order_release);
+    }
+
+    // Removing session, optionally returning the removed value
+    bool remove(ConnectionId id, Value* removed = nullptr) {
+        Shard& shard = shardFor(id);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto it = shard.sessions.find(id);
+        if (it == shard.sessions.end()) {
+            return false;
+        }
+        if (removed) {
+            *removed = std::move(it->second);
+        }
+        shard.sessions.erase(it);
+        sessionCount.fetch_sub(1, std::memory_order_relaxed);
+        shard.dirty.store(true, std::memory_order_release);
+        return true;
+    }
+
+    // Looking up session by id
+    bool find(ConnectionId id, Value& out) const {
+        const Shard& shard = shardFor(id);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto it = shard.sessions.find(id);
+        if (it == shard.sessions.end()) {
+            return false;
+        }
+        out = it->second;
+        return true;
+    }
+
+    // Calling handler for every session from lock-free snapshots
+    template <typename Handler>
+    void forEach(Handler&& handler) const {
+        for (const auto& shard : shards) {
+            std::shared_ptr<const Snapshot> snapshot = shardSnapshot(*shard);
+            for (const Value& value : *snapshot) {
+                handler(value);
+            }
+        }
+    }
+
+    // Removing all sessions, returning them to the caller
+    Snapshot clear() {
+        Snapshot removed;
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard->mtx);
+            for (auto& session : shard->sessions) {
+                removed.push_back(std::move(session.second));
+            }
+            shard->sessions.clear();
+            shard->dirty.store(true, std::memory_order_release);
+        }
+        sessionCount.store(0, std::memory_order_relaxed);
+        return removed;
+    }
+
+    size_t size() const {
+        return sessionCount.load(std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,212 @@
+#include "SessionTokens.h"
+#include "MetricsRegistry.h"
+#include <QDateTime>
+#include <QMessageAuthenticationCode>
+#include <QRandomGenerator>
+
+namespace {
+
+const QByteArray::Base64Options TOKEN_ENCODING =
+    QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals;
+
+QByteArray randomBytes(int size) {
+    QByteArray bytes(size, Qt::Uninitialized);
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32*>(bytes.data()), size / 4);
+    return bytes;
+}
+
+// Comparison time does not depend on where the MACs differ
+bool constantTimeEquals(const QByteArray& a, const QByteArray& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    char diff = 0;
+    for (int i = 0; i < a.size(); ++i) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+Counter& tokenCacheHits() {
+    static Counter& metric = MetricsRegistry::instance().counter(
+        "chat_session_token_cache_hits_total", "Tokeny, proverennye po kheshu bez vychisleniya MAC");
+    return metric;
+}
+
+Counter& tokenValidations() {
+    static Counter& metric = MetricsRegistry::instance().counter(
+        "chat_session_token_validations_total", "Proverki tokenov sessii s vychisleniem MAC");
+    return metric;
+}
+
+} // namespace
+
+// Constructor: without a configured secret tokens live as long as the process
+SessionTokenManager::SessionTokenManager(const QByteArray& secret, qint64 lifetime, int capacity)
+    : key(secret.isEmpty() ? randomBytes(32) : secret)
+    , lifetimeSeconds(lifetime)
+    , cacheCapacity(capacity) {
+}
+
+QByteArray SessionTokenManager::sign(const QByteArray& payload) const {
+    return QMessageAuthenticationCode::hash(payload, key, QCryptographicHash::Sha256);
+}
+
+QString SessionTokenManager::issue(const QString& username) {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QByteArray nonce = randomBytes(12).toHex();
+    qint64 expiresAt = now + lifetimeSeconds * 1000;
+    QByteArray payload = username.toUtf8() + ':' + QByteArray::number(now) + ':' +
+        QByteArray::number(expiresAt) + ':' + nonce;
+    QByteArray token = payload.toBase64(TOKEN_ENCODING) + '.' + sign(payload).toBase64(TOKEN_ENCODING);
+
+    QMutexLocker locker(&mtx);
+    remember(token, CachedToken{ username, now, expiresAt, nonce, {} });
+    return QString::fromLatin1(token);
+}
+
+bool SessionTokenManager::parse(const QByteArray& token, CachedToken& parsed) const {
+    int dot = token.indexOf('.');
+    if (dot <= 0) {
+        return false;
+    }
+    QByteArray payload = QByteArray::fromBase64(token.left(dot), TOKEN_ENCODING);
+    QByteArray mac = QByteArray::fromBase64(token.mid(dot + 1), TOKEN_ENCODING);
+    tokenValidations().add();
+    if (!constantTimeEquals(mac, sign(payload))) {
+        return false;
+    }
+
+    QList<QByteArray> fields = payload.split(':');
+    if (fields.size() != 4) {
+        return false;
+    }
+    bool issuedOk = false;
+    bool expiresOk = false;
+    parsed.username = QString::fromUtf8(fields[0]);
+    parsed.issuedAt = fields[1].toLongLong(&issuedOk);
+    parsed.expiresAt = fields[2].toLongLong(&expiresOk);
+    parsed.nonce = fields[3];
+    return issuedOk && expiresOk && !parsed.username.isEmpty();
+}
+
+bool SessionTokenManager::isRevoked(const CachedToken& token, qint64 now) const {
+    if (token.expiresAt <= now || revokedNonces.contains(token.nonce)) {
+        return true;
+    }
+    auto user = revokedBefore.constFind(token.username);
+    return user != revokedBefore.constEnd() && token.issuedAt <= user.value();
+}
+
+void SessionTokenManager::remember(const QByteArray& token, CachedToken parsed) {
+    auto existing = cache.find(token);
+    if (existing != cache.end()) {
+        lruOrder.splice(lruOrder.begin(), lruOrder, existing->position);
+        return;
+    }
+
+    lruOrder.push_front(token);
+    parsed.position = lruOrder.begin();
+    cache.insert(token, parsed);
+
+    while (cache.size() > cacheCapacity) {
+        cache.remove(lruOrder.back());
+        lruOrder.pop_back();
+    }
+}
+
+void SessionTokenManager::forget(const QByteArray& token) {
+    auto it = cache.find(token);
+    if (it != cache.end()) {
+        lruOrder.erase(it->position);
+        cache.erase(it);
+    }
+}
+
+QString SessionTokenManager::validate(const QString& token) {
+    QByteArray bytes = token.toLatin1();
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    QMutexLocker locker(&mtx);
+    auto cached = cache.find(bytes);
+    if (cached != cache.end()) {
+        if (isRevoked(cached.value(), now)) {
+            forget(bytes);
+            return QString();
+        }
+        lruOrder.splice(lruOrder.begin(), lruOrder, cached->position);
+        tokenCacheHits().add();
+        return cached->username;
+    }
+
+    CachedToken parsed;
+    if (!parse(bytes, parsed) || isRevoked(parsed, now)) {
+        return QString();
+    }
+    remember(bytes, parsed);
+    return parsed.username;
+}
+
+void SessionTokenManager::revoke(const QString& token) {
+    QByteArray bytes = token.toLatin1();
+    QMutexLocker locker(&mtx);
+
+    CachedToken parsed;
+    auto cached = cache.constFind(bytes);
+    if (cached != cache.constEnd()) {
+        parsed = cached.value();
+    }
+    else if (!parse(bytes, parsed)) {
+        return;
+    }
+    revokedNonces.insert(parsed.nonce, parsed.expiresAt);
+    forget(bytes);
+}
+
+void SessionTokenManager::revokeUser(const QString& username) {
+    QMutexLocker locker(&mtx);
+    revokedBefore.insert(username, QDateTime::currentMSecsSinceEpoch());
+
+    for (auto it = cache.begin(); it != cache.end();) {
+        if (it->username == username) {
+            lruOrder.erase(it->position);
+            it = cache.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void SessionTokenManager::purgeExpired() {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QMutexLocker locker(&mtx);
+
+    for (auto it = revokedNonces.begin(); it != revokedNonces.end();) {
+        if (it.value() <= now) {
+            it = revokedNonces.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    // Tokens issued before the revocation time have all expired by now
+    for (auto it = revokedBefore.begin(); it != revokedBefore.end();) {
+        if (it.value() + lifetimeSeconds * 1000 <= now) {
+            it = revokedBefore.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+qint64 SessionTokenManager::lifetime() const {
+    return lifetimeSeconds;
+}
+
+int SessionTokenManager::cachedCount() const {
+    QMutexLocker locker(&mtx);
+    return cache.size();
+}
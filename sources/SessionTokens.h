@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <list>
+#include "config.h"
+
+// Signed session tokens: "username:issuedAt:expiresAt:nonce.mac", where mac is
+// HMAC-SHA256 of the payload under the server key (SESSION_KEY_FILE). Validating a token is
+// one MAC over a short string instead of a password hash and user lookup;
+// tokens validated recently are kept in an LRU so even the MAC is skipped.
+class SessionTokenManager {
+private:
+    struct CachedToken {
+        QString username;
+        qint64 issuedAt;        // ms since epoch
+        qint64 expiresAt;
+        QByteArray nonce;
+        std::list<QByteArray>::iterator position;   // Position in lruOrder
+    };
+
+    mutable QMutex mtx;
+    QByteArray key;
+    qint64 lifetimeSeconds;
+    int cacheCapacity;
+
+    // Recently validated tokens, most recent first
+    QHash<QByteArray, CachedToken> cache;
+    std::list<QByteArray> lruOrder;
+
+    // Revoked token nonces (until their expiry) and per-user revocation time
+    QHash<QByteArray, qint64> revokedNonces;
+    QHash<QString, qint64> revokedBefore;
+
+    QByteArray sign(const QByteArray& payload) const;
+    bool parse(const QByteArray& token, CachedToken& parsed) const;
+    bool isRevoked(const CachedToken& token, qint64 now) const;
+    void remember(const QByteArray& token, CachedToken parsed);
+    void forget(const QByteArray& token);
+
+public:
+    explicit SessionTokenManager(const QByteArray& secret = QByteArray(),
+        qint64 lifetime = SESSION_TOKEN_LIFETIME,
+        int capacity = SESSION_TOKEN_CACHE_SIZE);
+
+    // Issuing a token for an authenticated user
+    QString issue(const QString& username);
+
+    // Checking signature, expiry and revocation; returns the token owner or empty string
+    QString validate(const QString& token);
+
+    // Revoking a single token or every token issued to the user so far
+    void revoke(const QString& token);
+    void revokeUser(const QString& username);
+
+    // Dropping expired revocation entries
+    void purgeExpired();
+
+    qint64 lifetime() const;
+    int cachedCount() const;
+};
@@ -0,0 +1,200 @@
+#include "Sha256.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const uint32_t ROUND_CONSTANTS[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+inline uint32_t loadBigEndian(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+inline void storeBigEndian(uint8_t* p, uint32_t x) {
+    p[0] = uint8_t(x >> 24);
+    p[1] = uint8_t(x >> 16);
+    p[2] = uint8_t(x >> 8);
+    p[3] = uint8_t(x);
+}
+
+void storeState(const uint32_t state[8], uint8_t* output) {
+    for (int i = 0; i < 8; ++i) {
+        storeBigEndian(output + 4 * i, state[i]);
+    }
+}
+
+} // namespace
+
+const uint32_t Sha256::INITIAL_STATE[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+Sha256::Sha256() : bufferSize(0), length(0) {
+    std::memcpy(state, INITIAL_STATE, sizeof(state));
+}
+
+void Sha256::compress(uint32_t state[8], const uint8_t block[BLOCK_SIZE]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = loadBigEndian(block + 4 * i);
+    }
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + ROUND_CONSTANTS[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+void Sha256::update(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    length += size;
+
+    if (bufferSize > 0) {
+        size_t take = std::min(size, BLOCK_SIZE - bufferSize);
+        std::memcpy(buffer + bufferSize, bytes, take);
+        bufferSize += take;
+        bytes += take;
+        size -= take;
+        if (bufferSize < BLOCK_SIZE) {
+            return;
+        }
+        compress(state, buffer);
+        bufferSize = 0;
+    }
+
+    for (; size >= BLOCK_SIZE; bytes += BLOCK_SIZE, size -= BLOCK_SIZE) {
+        compress(state, bytes);
+    }
+    std::memcpy(buffer, bytes, size);
+    bufferSize = size;
+}
+
+Sha256::Digest Sha256::finish() {
+    uint64_t bitLength = length * 8;
+
+    buffer[bufferSize++] = 0x80;
+    if (bufferSize > BLOCK_SIZE - 8) {
+        std::memset(buffer + bufferSize, 0, BLOCK_SIZE - bufferSize);
+        compress(state, buffer);
+        bufferSize = 0;
+    }
+    std::memset(buffer + bufferSize, 0, BLOCK_SIZE - 8 - bufferSize);
+    storeBigEndian(buffer + BLOCK_SIZE - 8, uint32_t(bitLength >> 32));
+    storeBigEndian(buffer + BLOCK_SIZE - 4, uint32_t(bitLength));
+    compress(state, buffer);
+
+    Digest digest;
+    storeState(state, digest.data());
+    return digest;
+}
+
+Sha256::Digest Sha256::hash(const void* data, size_t size) {
+    Sha256 context;
+    context.update(data, size);
+    return context.finish();
+}
+
+Sha256::Digest Sha256::hash(const std::string& data) {
+    return hash(data.data(), data.size());
+}
+
+HmacSha256::HmacSha256(const void* key, size_t keySize) {
+    uint8_t block[Sha256::BLOCK_SIZE] = {};
+    if (keySize > Sha256::BLOCK_SIZE) {
+        Sha256::Digest keyDigest = Sha256::hash(key, keySize);
+        std::memcpy(block, keyDigest.data(), keyDigest.size());
+    }
+    else if (keySize > 0) {
+        std::memcpy(block, key, keySize);
+    }
+
+    uint8_t pad[Sha256::BLOCK_SIZE];
+    for (size_t i = 0; i < Sha256::BLOCK_SIZE; ++i) {
+        pad[i] = block[i] ^ 0x36;
+    }
+    std::memcpy(innerState, Sha256::INITIAL_STATE, sizeof(innerState));
+    Sha256::compress(innerState, pad);
+
+    for (size_t i = 0; i < Sha256::BLOCK_SIZE; ++i) {
+        pad[i] = block[i] ^ 0x5c;
+    }
+    std::memcpy(outerState, Sha256::INITIAL_STATE, sizeof(outerState));
+    Sha256::compress(outerState, pad);
+}
+
+void HmacSha256::innerStart(Sha256& context) const {
+    context = Sha256();
+    std::memcpy(context.state, innerState, sizeof(innerState));
+    context.length = Sha256::BLOCK_SIZE;
+}
+
+void HmacSha256::outerStart(Sha256& context) const {
+    context = Sha256();
+    std::memcpy(context.state, outerState, sizeof(outerState));
+    context.length = Sha256::BLOCK_SIZE;
+}
+
+Sha256::Digest HmacSha256::mac(const void* data, size_t size) const {
+    Sha256 context;
+    innerStart(context);
+    context.update(data, size);
+    Sha256::Digest inner = context.finish();
+
+    outerStart(context);
+    context.update(inner.data(), inner.size());
+    return context.finish();
+}
+
+void HmacSha256::macDigest(const uint8_t input[Sha256::DIGEST_SIZE], uint8_t output[Sha256::DIGEST_SIZE]) const {
+    // Both hashes are exactly one padded block after the key pad
+    uint8_t block[Sha256::BLOCK_SIZE] = {};
+    block[Sha256::DIGEST_SIZE] = 0x80;
+    storeBigEndian(block + Sha256::BLOCK_SIZE - 4, (Sha256::BLOCK_SIZE + Sha256::DIGEST_SIZE) * 8);
+
+    uint32_t state[8];
+    std::memcpy(block, input, Sha256::DIGEST_SIZE);
+    std::memcpy(state, innerState, sizeof(state));
+    Sha256::compress(state, block);
+
+    storeState(state, block);
+    std::memcpy(state, outerState, sizeof(state));
+    Sha256::compress(state, block);
+    storeState(state, output);
+}
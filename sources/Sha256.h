@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// SHA-256 (FIPS 180-4). The compression function is public so that
+// HMAC/PBKDF2 can reuse precomputed pad states instead of rehashing the key.
+class Sha256 {
+public:
+    static const size_t DIGEST_SIZE = 32;
+    static const size_t BLOCK_SIZE = 64;
+    using Digest = std::array<uint8_t, DIGEST_SIZE>;
+
+private:
+    uint32_t state[8];
+    uint8_t buffer[BLOCK_SIZE];
+    size_t bufferSize;
+    uint64_t length;
+
+    friend class HmacSha256;
+
+public:
+    Sha256();
+
+    void update(const void* data, size_t size);
+    Digest finish();
+
+    static Digest hash(const void* data, size_t size);
+    static Digest hash(const std::string& data);
+
+    static void compress(uint32_t state[8], const uint8_t block[BLOCK_SIZE]);
+    static const uint32_t INITIAL_STATE[8];
+};
+
+// HMAC-SHA256 with the key pads hashed once
+class HmacSha256 {
+private:
+    uint32_t innerState[8];
+    uint32_t outerState[8];
+
+public:
+    explicit HmacSha256(const void* key, size_t keySize);
+
+    Sha256::Digest mac(const void* data, size_t size) const;
+
+    // PBKDF2 inner loop: U = HMAC(U) for a 32-byte U, two compressions
+    void macDigest(const uint8_t input[Sha256::DIGEST_SIZE], uint8_t output[Sha256::DIGEST_SIZE]) const;
+
+    // Continuing a hash from the precomputed pad states
+    void innerStart(Sha256& context) const;
+    void outerStart(Sha256& context) const;
+    const uint32_t* innerPadState() const { return innerState; }
+    const uint32_t* outerPadState() const { return outerState; }
+};
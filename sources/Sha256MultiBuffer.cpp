@@ -0,0 +1,246 @@
+#include "Sha256MultiBuffer.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CHAT_SHA256_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CHAT_TARGET_AVX2
+#else
+#define CHAT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+const uint32_t ROUND_CONSTANTS[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const size_t LANES = Sha256MultiBuffer::LANES;
+
+inline uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+// Portable kernel: the same rounds with an inner loop over the lanes
+void compressScalar(uint32_t state[8][LANES], const uint32_t block[16][LANES]) {
+    uint32_t w[16][LANES];
+    uint32_t v[8][LANES];
+    std::memcpy(w, block, sizeof(w));
+    std::memcpy(v, state, sizeof(v));
+
+    for (int i = 0; i < 64; ++i) {
+        uint32_t* wi = w[i & 15];
+        if (i >= 16) {
+            const uint32_t* w2 = w[(i - 2) & 15];
+            const uint32_t* w7 = w[(i - 7) & 15];
+            const uint32_t* w15 = w[(i - 15) & 15];
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                uint32_t s0 = rotr(w15[lane], 7) ^ rotr(w15[lane], 18) ^ (w15[lane] >> 3);
+                uint32_t s1 = rotr(w2[lane], 17) ^ rotr(w2[lane], 19) ^ (w2[lane] >> 10);
+                wi[lane] += s0 + w7[lane] + s1;
+            }
+        }
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            uint32_t a = v[0][lane], b = v[1][lane], c = v[2][lane], d = v[3][lane];
+            uint32_t e = v[4][lane], f = v[5][lane], g = v[6][lane], h = v[7][lane];
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + ROUND_CONSTANTS[i] + wi[lane];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            v[7][lane] = g;
+            v[6][lane] = f;
+            v[5][lane] = e;
+            v[4][lane] = d + t1;
+            v[3][lane] = c;
+            v[2][lane] = b;
+            v[1][lane] = a;
+            v[0][lane] = t1 + t2;
+        }
+    }
+
+    for (int k = 0; k < 8; ++k) {
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            state[k][lane] += v[k][lane];
+        }
+    }
+}
+
+#ifdef CHAT_SHA256_X86
+
+#define ROTR8(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+
+CHAT_TARGET_AVX2 void compressAvx2(uint32_t state[8][LANES], const uint32_t block[16][LANES]) {
+    __m256i w[16];
+    for (int t = 0; t < 16; ++t) {
+        w[t] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block[t]));
+    }
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[0]));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[1]));
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[2]));
+    __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[3]));
+    __m256i e = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[4]));
+    __m256i f = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[5]));
+    __m256i g = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[6]));
+    __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[7]));
+    const __m256i a0 = a, b0 = b, c0 = c, d0 = d, e0 = e, f0 = f, g0 = g, h0 = h;
+
+    for (int i = 0; i < 64; ++i) {
+        if (i >= 16) {
+            __m256i w2 = w[(i - 2) & 15];
+            __m256i w15 = w[(i - 15) & 15];
+            __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(ROTR8(w15, 7), ROTR8(w15, 18)), _mm256_srli_epi32(w15, 3));
+            __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(ROTR8(w2, 17), ROTR8(w2, 19)), _mm256_srli_epi32(w2, 10));
+            w[i & 15] = _mm256_add_epi32(_mm256_add_epi32(w[i & 15], s0), _mm256_add_epi32(w[(i - 7) & 15], s1));
+        }
+
+        __m256i sigma1 = _mm256_xor_si256(_mm256_xor_si256(ROTR8(e, 6), ROTR8(e, 11)), ROTR8(e, 25));
+        __m256i choose = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, sigma1),
+            _mm256_add_epi32(_mm256_add_epi32(choose, _mm256_set1_epi32(static_cast<int>(ROUND_CONSTANTS[i]))), w[i & 15]));
+        __m256i sigma0 = _mm256_xor_si256(_mm256_xor_si256(ROTR8(a, 2), ROTR8(a, 13)), ROTR8(a, 22));
+        __m256i majority = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(a, c)), _mm256_and_si256(b, c));
+        __m256i t2 = _mm256_add_epi32(sigma0, majority);
+
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi32(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm256_add_epi32(t1, t2);
+    }
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(state[0]), _mm256_add_epi32(a, a0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(state[1]), _mm256_add_epi32(b, b0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(state[2]), _mm256_add_epi32(c, c0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(state[3]), _mm256_add_epi32(d, d0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(state[4]), _mm256_add_epi32(e, e0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(state[5]), _mm256_add_epi32(f, f0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(state[6]), _mm256_add_epi32(g, g0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(state[7]), _mm256_add_epi32(h, h0));
+}
+
+#undef ROTR8
+
+bool cpuHasAvx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif // CHAT_SHA256_X86
+
+using CompressFunction = void (*)(uint32_t[8][LANES], const uint32_t[16][LANES]);
+
+struct Kernel {
+    CompressFunction compress;
+    const char* name;
+};
+
+const Kernel& selectedKernel() {
+    static const Kernel kernel = [] {
+#ifdef CHAT_SHA256_X86
+        if (cpuHasAvx2()) {
+            return Kernel{ compressAvx2, "avx2" };
+        }
+#endif
+        return Kernel{ compressScalar, "scalar" };
+    }();
+    return kernel;
+}
+
+} // namespace
+
+void Sha256MultiBuffer::compress(uint32_t state[8][LANES], const uint32_t block[16][LANES]) {
+    selectedKernel().compress(state, block);
+}
+
+void Sha256MultiBuffer::compressPortable(uint32_t state[8][LANES], const uint32_t block[16][LANES]) {
+    compressScalar(state, block);
+}
+
+bool Sha256MultiBuffer::isAccelerated() {
+    return selectedKernel().compress != compressScalar;
+}
+
+const char* Sha256MultiBuffer::kernelName() {
+    return selectedKernel().name;
+}
+
+void Sha256MultiBuffer::pbkdf2Sha256(const std::string* passwords, const std::string* salts,
+    size_t count, uint32_t iterations, uint8_t* outputs) {
+    uint32_t innerStates[8][LANES] = {};
+    uint32_t outerStates[8][LANES] = {};
+    uint32_t u[8][LANES] = {};
+    uint32_t t[8][LANES] = {};
+
+    // Key pads and U1 = HMAC(password, salt || INT(1)) per lane
+    for (size_t lane = 0; lane < count && lane < LANES; ++lane) {
+        HmacSha256 hmac(passwords[lane].data(), passwords[lane].size());
+        const uint32_t* inner = hmac.innerPadState();
+        const uint32_t* outer = hmac.outerPadState();
+
+        std::string input = salts[lane] + std::string("\0\0\0\1", 4);
+        Sha256::Digest first = hmac.mac(input.data(), input.size());
+        for (int k = 0; k < 8; ++k) {
+            innerStates[k][lane] = inner[k];
+            outerStates[k][lane] = outer[k];
+            u[k][lane] = (uint32_t(first[4 * k]) << 24) | (uint32_t(first[4 * k + 1]) << 16) |
+                (uint32_t(first[4 * k + 2]) << 8) | uint32_t(first[4 * k + 3]);
+            t[k][lane] = u[k][lane];
+        }
+    }
+
+    // U(j) = HMAC(U(j-1)): both hashes are a single padded block after the key pad
+    uint32_t block[16][LANES] = {};
+    for (size_t lane = 0; lane < LANES; ++lane) {
+        block[8][lane] = 0x80000000u;
+        block[15][lane] = (Sha256::BLOCK_SIZE + DIGEST_SIZE) * 8;
+    }
+    uint32_t state[8][LANES];
+    for (uint32_t i = 1; i < iterations; ++i) {
+        std::memcpy(block, u, sizeof(u));
+        std::memcpy(state, innerStates, sizeof(state));
+        compress(state, block);
+
+        std::memcpy(block, state, sizeof(state));
+        std::memcpy(u, outerStates, sizeof(u));
+        compress(u, block);
+
+        for (int k = 0; k < 8; ++k) {
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                t[k][lane] ^= u[k][lane];
+            }
+        }
+    }
+
+    for (size_t lane = 0; lane < count && lane < LANES; ++lane) {
+        uint8_t* output = outputs + DIGEST_SIZE * lane;
+        for (int k = 0; k < 8; ++k) {
+            output[4 * k] = uint8_t(t[k][lane] >> 24);
+            output[4 * k + 1] = uint8_t(t[k][lane] >> 16);
+            output[4 * k + 2] = uint8_t(t[k][lane] >> 8);
+            output[4 * k + 3] = uint8_t(t[k][lane]);
+        }
+    }
+}
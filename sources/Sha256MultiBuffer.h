@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Sha256.h"
+
+// Multi-buffer SHA-256: eight independent messages are compressed together,
+// one message per 32-bit SIMD lane. Data is kept transposed (word i of every
+// lane side by side), which is the layout the AVX2 kernel loads directly.
+// The kernel is chosen once at runtime; without AVX2 a portable lane loop
+// is used, which compilers still vectorize with SSE2/NEON.
+class Sha256MultiBuffer {
+public:
+    static const size_t LANES = 8;
+    static const size_t DIGEST_SIZE = Sha256::DIGEST_SIZE;
+
+    // state[i][lane] is word i of the lane, block[t][lane] its message word t
+    static void compress(uint32_t state[8][LANES], const uint32_t block[16][LANES]);
+
+    // The portable kernel regardless of the CPU, to check the selected one against
+    static void compressPortable(uint32_t state[8][LANES], const uint32_t block[16][LANES]);
+
+    static bool isAccelerated();
+    static const char* kernelName();
+
+    // PBKDF2-HMAC-SHA256 with a 32-byte key for up to LANES passwords that
+    // share the iteration count; the output of lane i goes to outputs + 32 * i
+    static void pbkdf2Sha256(const std::string* passwords, const std::string* salts,
+        size_t count, uint32_t iterations, uint8_t* outputs);
+};
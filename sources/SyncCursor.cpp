@@ -0,0 +1,66 @@
+#include "SyncCursor.h"
+#include <algorithm>
+
+void SyncCursor::prune(State& state) {
+    state.ahead.erase(state.ahead.begin(), state.ahead.upper_bound(state.synced));
+}
+
+uint64_t SyncCursor::position(const std::string& conversation) const {
+    auto it = states.find(conversation);
+    return it == states.end() ? 0 : it->second.synced;
+}
+
+std::vector<std::string> SyncCursor::conversations() const {
+    std::vector<std::string> names;
+    names.reserve(states.size());
+    for (const auto& entry : states) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+void SyncCursor::beginSync(const std::string& conversation) {
+    states[conversation].syncing = true;
+}
+
+bool SyncCursor::accept(const std::string& conversation, uint64_t id) {
+    State& state = states[conversation];
+    if (id <= state.synced || state.ahead.count(id) != 0) {
+        return false;
+    }
+    state.highest = std::max(state.highest, id);
+
+    // Outside a sync the connection is live since the last "done",
+    // so nothing below the new id can be missing
+    if (!state.syncing) {
+        state.synced = std::max(state.synced, id);
+        prune(state);
+        return true;
+    }
+    state.ahead.insert(id);
+    return true;
+}
+
+bool SyncCursor::finishPage(const std::string& conversation, uint64_t position, bool more) {
+    State& state = states[conversation];
+    state.synced = std::max(state.synced, position);
+    if (!more) {
+        // "done": the server sent everything up to the journal head it saw,
+        // later messages arrived live on this connection
+        state.syncing = false;
+        state.synced = std::max(state.synced, state.highest);
+    }
+    prune(state);
+    return more;
+}
+
+bool SyncCursor::isSyncing(const std::string& conversation) const {
+    auto it = states.find(conversation);
+    return it != states.end() && it->second.syncing;
+}
+
+void SyncCursor::interrupt() {
+    for (auto& entry : states) {
+        entry.second.syncing = true;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// Client-side history sync positions per conversation ("all", "#room" or
+// the other user of a private chat). The sync position only advances over
+// ranges the server has confirmed complete ("/synced ... more|done"); live
+// message ids seen while a sync is running are remembered separately, so a
+// continuation request does not skip the gap below them. Not thread-safe:
+// the owner serializes calls.
+class SyncCursor {
+private:
+    struct State {
+        uint64_t synced = 0;        // Everything up to this id has been received
+        uint64_t highest = 0;       // Highest id received live or from sync
+        bool syncing = false;       // Request sent, "done" not yet received
+        std::set<uint64_t> ahead;   // Ids above synced already received
+    };
+
+    std::map<std::string, State> states;
+
+    static void prune(State& state);
+
+public:
+    // Id the next /sync request for the conversation starts after
+    uint64_t position(const std::string& conversation) const;
+
+    // Known conversations
+    std::vector<std::string> conversations() const;
+
+    // Marking a sync request as sent
+    void beginSync(const std::string& conversation);
+
+    // Recording a numbered message, false if it was already received
+    bool accept(const std::string& conversation, uint64_t id);
+
+    // Server reply for a sync page; true when the next page should be requested
+    bool finishPage(const std::string& conversation, uint64_t position, bool more);
+
+    bool isSyncing(const std::string& conversation) const;
+
+    // Connection lost: live ids stop proving continuity until the next
+    // sync of each conversation reports "done"
+    void interrupt();
+};
@@ -0,0 +1,95 @@
+#include "TimerWheel.h"
+#include <algorithm>
+
+// Constructor
+TimerWheel::TimerWheel(uint32_t tickDurationMs)
+    : tickMs(std::max<uint32_t>(tickDurationMs, 1))
+    , currentTick(0)
+{
+}
+
+// Arming timer
+void TimerWheel::schedule(ConnectionId id, uint64_t delayMs) {
+    cancel(id);
+
+    // Rounding up so a timer never fires early; at least one tick ahead
+    uint64_t ticks = std::max<uint64_t>((delayMs + tickMs - 1) / tickMs, 1);
+    ticks = std::min(ticks, MAX_TICKS);
+
+    Timer& timer = timers[id];
+    timer.expiresTick = currentTick + ticks;
+    place(id, timer);
+}
+
+// Cancelling timer
+bool TimerWheel::cancel(ConnectionId id) {
+    auto it = timers.find(id);
+    if (it == timers.end()) {
+        return false;
+    }
+    wheel[it->second.level][it->second.slot].erase(it->second.position);
+    timers.erase(it);
+    return true;
+}
+
+// The level is the highest 6-bit group where deadline and current tick differ,
+// so a timer is cascaded exactly when the clock enters its block
+void TimerWheel::place(ConnectionId id, Timer& timer) {
+    uint64_t expires = timer.expiresTick;
+
+    int level = 0;
+    while (level < LEVELS - 1 &&
+        (expires >> (SLOT_BITS * (level + 1))) != (currentTick >> (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+
+    timer.level = level;
+    timer.slot = static_cast<int>((expires >> (SLOT_BITS * level)) & (SLOTS - 1));
+    std::list<ConnectionId>& slot = wheel[timer.level][timer.slot];
+    timer.position = slot.insert(slot.end(), id);
+}
+
+void TimerWheel::cascade(int level) {
+    int index = static_cast<int>((currentTick >> (SLOT_BITS * level)) & (SLOTS - 1));
+    std::list<ConnectionId> pending;
+    pending.swap(wheel[level][index]);
+
+    for (ConnectionId id : pending) {
+        place(id, timers[id]);
+    }
+}
+
+// Advancing clock
+void TimerWheel::advance(uint64_t ticks, const Handler& expired) {
+    for (uint64_t step = 0; step < ticks; ++step) {
+        ++currentTick;
+
+        // Higher levels first, so timers due this tick reach level 0
+        for (int level = LEVELS - 1; level > 0; --level) {
+            uint64_t lowerMask = (uint64_t(1) << (SLOT_BITS * level)) - 1;
+            if ((currentTick & lowerMask) == 0) {
+                cascade(level);
+            }
+        }
+
+        std::list<ConnectionId>& due = wheel[0][currentTick & (SLOTS - 1)];
+        while (!due.empty()) {
+            ConnectionId id = due.front();
+            due.pop_front();
+            timers.erase(id);
+            expired(id);
+        }
+    }
+}
+
+bool TimerWheel::isScheduled(ConnectionId id) const {
+    return timers.count(id) > 0;
+}
+
+size_t TimerWheel::size() const {
+    return timers.size();
+}
+
+uint32_t TimerWheel::getTickDuration() const {
+    return tickMs;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include "RoomIndex.h"
+
+// Hierarchical timer wheel keyed by connection id.
+// Four levels of 64 slots cover 2^24 ticks; schedule and cancel are O(1),
+// advancing the clock costs O(1) per tick plus O(1) per expired timer.
+// Not thread-safe, the owner serializes access.
+class TimerWheel {
+public:
+    using Handler = std::function<void(ConnectionId)>;
+
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+    static constexpr uint64_t MAX_TICKS = (uint64_t(1) << (LEVELS * SLOT_BITS)) - 1;
+
+private:
+    struct Timer {
+        uint64_t expiresTick;
+        int level;
+        int slot;
+        std::list<ConnectionId>::iterator position;
+    };
+
+    uint32_t tickMs;
+    uint64_t currentTick;
+    std::list<ConnectionId> wheel[LEVELS][SLOTS];
+    std::unordered_map<ConnectionId, Timer> timers;
+
+    // Putting timer into the slot matching its distance from the current tick
+    void place(ConnectionId id, Timer& timer);
+
+    // Moving timers of a higher level slot down when its block begins
+    void cascade(int level);
+
+public:
+    explicit TimerWheel(uint32_t tickDurationMs = 1000);
+
+    // Arming timer to fire after delayMs; re-arming replaces the old deadline
+    void schedule(ConnectionId id, uint64_t delayMs);
+
+    // Cancelling timer, returns false if it was not armed
+    bool cancel(ConnectionId id);
+
+    // Advancing clock by elapsed ticks, calling handler for each expired timer.
+    // Handler may schedule or cancel timers.
+    void advance(uint64_t ticks, const Handler& expired);
+
+    bool isScheduled(ConnectionId id) const;
+    size_t size() const;
+    uint32_t getTickDuration() const;
+};
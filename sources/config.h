@@ -5,20 +5,38 @@
 // Nastroiki podklyucheniya
 #define SERVER_ADDRESS "chat.server.com"
 #define SERVER_PORT 9999
+#define METRICS_PORT 9100    // Lokal'naya vydacha metrik (tol'ko 127.0.0.1)
 
 // Protokoly
 #define PROTOCOL_VERSION "1.0"
 #define ENCRYPTION_ENABLED true
+#define LOGIN_COMMAND "/login "          // "/login <imya> <parol'>"
+#define RESUME_COMMAND "/resume "        // "/resume <imya> <token sessii>"
+#define SESSION_TOKEN_COMMAND "/token "  // Otvet servera na uspeshnyy vkhod
+#define LOGIN_DENIED_COMMAND "/denied"   // Otvet na nevernye dannye, zatem razryv
+#define LOGOUT_COMMAND "/logout"         // Otzyv tokenov sessii pol'zovatelya
+#define ROOM_JOIN_COMMAND "/join "
+#define ROOM_LEAVE_COMMAND "/leave "
+#define ROOM_PREFIX '#'
+#define PING_COMMAND "/ping"
+#define PONG_COMMAND "/pong"
+#define COMPRESS_COMMAND "/compress "
+#define SYNC_COMMAND "/sync "
+#define SYNCED_COMMAND "/synced "
+#define MESSAGE_ID_COMMAND "/id "
 
 // Formaty dannykh
 #define MESSAGE_MAX_LENGTH 4096
 #define USERNAME_MAX_LENGTH 32
+#define ROOM_NAME_MAX_LENGTH 32     // Vmeste s ROOM_PREFIX
 #define PASSWORD_MIN_LENGTH 6
 
 // Vremennye intervaly
 #define HEARTBEAT_INTERVAL 30000    // 30 sekund
 #define AUTO_SAVE_INTERVAL 60000    // 60 sekund
 #define MESSAGE_TIMEOUT 120000      // 2 minuty
+#define JOURNAL_COMMIT_WINDOW 2     // 2 millisekundy
+#define LIVENESS_TICK 1000          // 1 sekunda, shag kolesa taymerov
 
 // Rezhimy raboty
 enum class AppMode {
@@ -38,6 +56,11 @@ enum class AppMode {
 #define LOG_FILE "chat.log"
 #define DATA_DIR "data/"
 #define TEMP_DIR "temp/"
+#define JOURNAL_FILE DATA_DIR "messages.wal"
+#define SERVER_JOURNAL_FILE DATA_DIR "server.wal"
+#define BAN_LIST_FILE DATA_DIR "bans.txt"
+#define USERS_FILE DATA_DIR "users.dat"
+#define SESSION_KEY_FILE DATA_DIR "session.key"    // Klyuch podpisi tokenov, perezhivaet perezapusk
 
 // Sistemnye nastroiki
 #define USE_SYSTEM_TRAY true
@@ -48,6 +71,14 @@ enum class AppMode {
 #define SECURE_CONNECTION true
 #define SSL_CERT_FILE "cert.pem"
 #define SSL_KEY_FILE "privkey.pem"
+#define TLS_RECORD_SIZE 1400             // Pervaya TLS-zapis' bol'shogo paketa: odin segment TCP
+#define SESSION_TOKEN_LIFETIME 86400     // 24 chasa, v sekundakh
+#define SESSION_TOKEN_CACHE_SIZE 4096    // Nedavno proverennye tokeny
+#define PASSWORD_USE_SCRYPT true         // false - PBKDF2-SHA256; tol'ko takie zapisi proveryayutsya paketom po vosem' (AVX2)
+#define PASSWORD_SCRYPT_N 16384          // Stoimost' scrypt: 16 MB pamyati na proverku
+#define PASSWORD_SCRYPT_R 8
+#define PASSWORD_SCRYPT_P 1
+#define PASSWORD_PBKDF2_ITERATIONS 600000
 
 // Interfeys
 #define DEFAULT_FONT "Arial"
@@ -60,6 +91,58 @@ enum class AppMode {
 #define MAX_CONTACTS 1000
 #define MAX_GROUPS 100
 #define MAX_ATTACHMENTS 5
+#define LOG_MODEL_CAPACITY 10000000   // Zapisey v modeli loga administratora
+#define LOG_BATCH_LATENCY 16          // ms, vstavka zapisey loga raz v kadr
+#define USER_LIST_COMPACT_MIN 1024    // Pustykh strok spiska pol'zovateley do uplotneniya
+
+// Ogranichenie skorosti soobshcheniy (soobshcheniy v sekundu / razmer vspleska)
+#define RATE_LIMIT_CONNECTION_RATE 20
+#define RATE_LIMIT_CONNECTION_BURST 40
+#define RATE_LIMIT_USER_RATE 30
+#define RATE_LIMIT_USER_BURST 60
+#define RATE_LIMIT_ADDRESS_RATE 200
+#define RATE_LIMIT_ADDRESS_BURST 400
+#define RATE_LIMIT_IPV4_PREFIX 24
+#define RATE_LIMIT_IPV6_PREFIX 64
+
+// Dopusk soedineniy
+#define MAX_CONNECTIONS 10000
+#define MAX_CONNECTIONS_PER_ADDRESS 32
+#define MAX_PENDING_HANDSHAKES 512     // Soedineniya bez vypolnennogo vkhoda
+#define ACCEPT_BATCH 64                // Soedineniy za odno probuzhdenie priema
+#define ACCEPT_PAUSE 50                // ms, pauza priema pri perepolnenii
+#define HANDSHAKE_TIMEOUT 10000        // 10 sekund na vkhod
+#define LOGIN_BATCH_MAX 64             // Vkhodov, proveryaemykh odnim paketom vne tsikla sobytiy
+
+// Otpravka: kadry soedineniya nakaplivayutsya i zapisyvayutsya odnim vyzovom
+#define WRITE_COALESCE_BYTES 65536     // Nakoplennoe sverh etogo zapisyvaetsya srazu
+#define WRITE_BATCH_BUFFERS 64         // Kadrov v odnom WSASend
+#define WRITE_QUEUE_LIMIT (4 << 20)    // Ochered' medlennogo klienta, dalee kadry otbrasyvayutsya
+#define WRITE_TIMEOUT 5000             // ms, zapis' bez progressa zakryvaet soedinenie
+#define WRITE_RETRY_INTERVAL 10        // ms, povtor otpravki klientam s polnym buferom soketa
+
+// Szhatie kadrov servera (zstd, soglasuetsya komandoy COMPRESS_COMMAND)
+#define COMPRESSION_ENABLED true
+#define COMPRESSION_MIN_SIZE 96           // Korotkie kadry bez szhatiya: zaderzhka vazhnee
+#define COMPRESSION_LEVEL 3
+#define COMPRESSION_WINDOW_LOG 17         // Okno potoka 128 KB na soedinenie
+#define COMPRESSION_MAX_FRAME (1 << 20)   // Maks. razmer kadra do i posle szhatiya
+#define COMPRESSION_DICTIONARY_SIZE 16384
+#define COMPRESSION_DICTIONARY_FILE DATA_DIR "chat.dict"
+
+// Sinkhronizatsiya istorii pri perepodklyuchenii
+// Testy zhurnala zadayut svoi znacheniya, chtoby segmenty i indeks zapolnyalis' bystro
+#ifndef JOURNAL_INDEX_INTERVAL
+#define JOURNAL_INDEX_INTERVAL 256        // Zapisey mezhdu tochkami indeksa zhurnala
+#endif
+#ifndef JOURNAL_SEGMENT_SIZE
+#define JOURNAL_SEGMENT_SIZE (64 << 20)   // Bayt v segmente zhurnala, dalee - novyy fayl
+#endif
+#define SERVER_JOURNAL_SEGMENTS 16        // Segmentov zhurnala servera na diske, starye udalyayutsya
+#define SYNC_MAX_MESSAGES 500             // Na besedu za odin zapros, ostal'noe - sleduyushchim
+#define SYNC_MAX_SCAN 200000              // Glubzhe v zhurnal sinkhronizatsiya ne zaglyadyvaet
+#define SYNC_SCAN_BATCH 2048              // Zapisey zhurnala za odin prokhod tsikla sobytiy
+#define SYNC_BATCH_BYTES 65536            // Razmer paketa kadrov istorii
 
 // Sistemnye soobsheniya
 #define WELCOME_MESSAGE "Dobro pozhalovat v chat!"
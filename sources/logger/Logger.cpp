@@ -1,4 +1,6 @@
 #include "Logger.h"
+#include "MetricsRegistry.h"
+#include "TraceRecorder.h"
 #include <iostream>
 #include <fstream>
 #include <mutex>
@@ -21,6 +23,11 @@ Logger::~Logger() {
 }
 
 void Logger::log(const std::string& message, LogType type) {
+    CHAT_TRACE_SCOPE("Logger::log");
+    // Ochered' loga - zapisi, zhdushchie blokirovki fayla
+    Gauge& backlog = Metrics::logBacklog();
+    backlog.add(1);
+
     // Blokiruyem dlya zapisi
     std::unique_lock<std::shared_mutex> lock(mtx);
 
@@ -51,6 +58,7 @@ void Logger::log(const std::string& message, LogType type) {
         << prefix
         << message << "\n";
     logFile.flush();  // Garantiruem zapis' v fayl
+    backlog.sub(1);
 }
 
 std::string Logger::readLine() {
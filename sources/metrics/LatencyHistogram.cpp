@@ -0,0 +1,135 @@
+#include "LatencyHistogram.h"
+
+namespace {
+
+int highestBit(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1)
+        ++bit;
+    return bit;
+#endif
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+int LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if (value < SUB_BUCKETS)
+        return static_cast<int>(value);
+
+    int exponent = highestBit(value);
+    int mantissa = static_cast<int>((value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + mantissa;
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(int index)
+{
+    if (index < SUB_BUCKETS)
+        return static_cast<uint64_t>(index);
+
+    int exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    uint64_t mantissa = static_cast<uint64_t>(index % SUB_BUCKETS);
+    return (SUB_BUCKETS + mantissa) << (exponent - SUB_BUCKET_BITS);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < SUB_BUCKETS)
+        return static_cast<uint64_t>(index);
+
+    int exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    return bucketLowerBound(index) + ((uint64_t(1) << (exponent - SUB_BUCKET_BITS)) - 1);
+}
+
+void LatencyHistogram::record(uint64_t value)
+{
+    m_buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t current = m_max.load(std::memory_order_relaxed);
+    while (value > current &&
+        !m_max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        uint64_t bucket = other.m_buckets[i].load(std::memory_order_relaxed);
+        if (bucket)
+            m_buckets[i].fetch_add(bucket, std::memory_order_relaxed);
+    }
+    m_count.fetch_add(other.count(), std::memory_order_relaxed);
+    m_sum.fetch_add(other.sum(), std::memory_order_relaxed);
+
+    uint64_t otherMax = other.max();
+    uint64_t current = m_max.load(std::memory_order_relaxed);
+    while (otherMax > current &&
+        !m_max.compare_exchange_weak(current, otherMax, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& bucket : m_buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::sum() const
+{
+    return m_sum.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::max() const
+{
+    return m_max.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const
+{
+    uint64_t total = count();
+    return total ? static_cast<double>(sum()) / total : 0.0;
+}
+
+uint64_t LatencyHistogram::percentile(double percent) const
+{
+    uint64_t total = count();
+    if (total == 0)
+        return 0;
+
+    // Rang trebuemogo znacheniya, ne men'she 1
+    uint64_t rank = static_cast<uint64_t>(percent / 100.0 * total + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > total)
+        rank = total;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t upper = bucketUpperBound(i);
+            uint64_t maximum = max();
+            return upper < maximum ? upper : maximum;
+        }
+    }
+    return max();
+}
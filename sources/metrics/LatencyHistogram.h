@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Log-lineynaya gistogramma zaderzhek v stile HDR: 32 pod-korziny na
+// kazhduyu stepen' dvoyki (otnositel'naya pogreshnost' ~3%) dlya vsego
+// diapazona uint64. Zapis' - odin relaxed fetch_add bez blokirovok.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    // Zapis' znacheniya (obychno v nanosekundakh ili mikrosekundakh)
+    void record(uint64_t value);
+
+    // Dobavlenie schetchikov drugoy gistogrammy
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    uint64_t count() const;
+    uint64_t sum() const;
+    uint64_t max() const;
+    double mean() const;
+
+    // Znachenie dlya protsentilya 0..100
+    uint64_t percentile(double percent) const;
+
+    // Nomer korziny i ee granitsy
+    static int bucketIndex(uint64_t value);
+    static uint64_t bucketLowerBound(int index);
+    static uint64_t bucketUpperBound(int index);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> m_buckets;
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+};
@@ -0,0 +1,194 @@
+#include "MetricsRegistry.h"
+#include <sstream>
+
+namespace {
+
+// Nomer sharda potoka naznachaetsya po krugu pri pervom obrashchenii
+int threadShard()
+{
+    static std::atomic<int> nextShard(0);
+    thread_local int shard = nextShard.fetch_add(1, std::memory_order_relaxed) % Counter::SHARD_COUNT;
+    return shard;
+}
+
+void renderHeader(std::ostringstream& out, const std::string& name,
+    const std::string& help, const char* type)
+{
+    if (!help.empty())
+        out << "# HELP " << name << ' ' << help << '\n';
+    out << "# TYPE " << name << ' ' << type << '\n';
+}
+
+} // namespace
+
+Counter::Counter() = default;
+
+void Counter::add(uint64_t value)
+{
+    m_shards[threadShard()].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const
+{
+    uint64_t total = 0;
+    for (const Shard& shard : m_shards)
+        total += shard.value.load(std::memory_order_relaxed);
+    return total;
+}
+
+MetricsRegistry& MetricsRegistry::instance()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry<Counter>& entry = m_counters[name];
+    if (!entry.metric) {
+        entry.help = help;
+        entry.metric.reset(new Counter);
+    }
+    return *entry.metric;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry<Gauge>& entry = m_gauges[name];
+    if (!entry.metric) {
+        entry.help = help;
+        entry.metric.reset(new Gauge);
+    }
+    return *entry.metric;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry<LatencyHistogram>& entry = m_histograms[name];
+    if (!entry.metric) {
+        entry.help = help;
+        entry.metric.reset(new LatencyHistogram);
+    }
+    return *entry.metric;
+}
+
+std::string MetricsRegistry::renderText() const
+{
+    std::ostringstream out;
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (const auto& item : m_counters) {
+        renderHeader(out, item.first, item.second.help, "counter");
+        out << item.first << ' ' << item.second.metric->value() << '\n';
+    }
+    for (const auto& item : m_gauges) {
+        renderHeader(out, item.first, item.second.help, "gauge");
+        out << item.first << ' ' << item.second.metric->value() << '\n';
+    }
+
+    // Gistogrammy otdayutsya kak summary s protsentilyami
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    for (const auto& item : m_histograms) {
+        const LatencyHistogram& histogram = *item.second.metric;
+        renderHeader(out, item.first, item.second.help, "summary");
+        for (double quantile : quantiles) {
+            out << item.first << "{quantile=\"" << quantile << "\"} "
+                << histogram.percentile(quantile * 100.0) << '\n';
+        }
+        out << item.first << "_sum " << histogram.sum() << '\n';
+        out << item.first << "_count " << histogram.count() << '\n';
+        out << item.first << "_max " << histogram.max() << '\n';
+    }
+    return out.str();
+}
+
+namespace Metrics {
+
+Counter& connectionsAccepted()
+{
+    static Counter& metric = MetricsRegistry::instance().counter(
+        "chat_connections_accepted_total", "Prinyatye soedineniya");
+    return metric;
+}
+
+Gauge& connectionsActive()
+{
+    static Gauge& metric = MetricsRegistry::instance().gauge(
+        "chat_connections_active", "Otkrytye soedineniya");
+    return metric;
+}
+
+Counter& bytesReceived()
+{
+    static Counter& metric = MetricsRegistry::instance().counter(
+        "chat_bytes_received_total", "Baytov polucheno ot klientov");
+    return metric;
+}
+
+Counter& bytesSent()
+{
+    static Counter& metric = MetricsRegistry::instance().counter(
+        "chat_bytes_sent_total", "Baytov postavleno v otpravku klientam");
+    return metric;
+}
+
+Counter& compressionInputBytes()
+{
+    static Counter& metric = MetricsRegistry::instance().counter(
+        "chat_compression_input_bytes_total", "Baytov kadrov do szhatiya");
+    return metric;
+}
+
+Counter& compressionOutputBytes()
+{
+    static Counter& metric = MetricsRegistry::instance().counter(
+        "chat_compression_output_bytes_total", "Baytov kadrov posle szhatiya");
+    return metric;
+}
+
+Counter& historySyncedMessages()
+{
+    static Counter& metric = MetricsRegistry::instance().counter(
+        "chat_history_synced_messages_total", "Soobshcheniy, dokachannykh pri sinkhronizatsii istorii");
+    return metric;
+}
+
+Counter& framesQueued()
+{
+    static Counter& metric = MetricsRegistry::instance().counter(
+        "chat_frames_queued_total", "Kadrov, postavlennykh v ochered' otpravki");
+    return metric;
+}
+
+Counter& socketWrites()
+{
+    static Counter& metric = MetricsRegistry::instance().counter(
+        "chat_socket_writes_total", "Vyzovov zapisi v soket, kadrov na vyzov - frames_queued / socket_writes");
+    return metric;
+}
+
+LatencyHistogram& sendLatency()
+{
+    static LatencyHistogram& metric = MetricsRegistry::instance().histogram(
+        "chat_message_send_latency_us", "Ot prinyatiya soobshcheniya do zapisi vsem poluchatelyam, mks");
+    return metric;
+}
+
+LatencyHistogram& authLatency()
+{
+    static LatencyHistogram& metric = MetricsRegistry::instance().histogram(
+        "chat_auth_latency_us", "Dlitel'nost' autentifikatsii, mks");
+    return metric;
+}
+
+Gauge& logBacklog()
+{
+    static Gauge& metric = MetricsRegistry::instance().gauge(
+        "chat_log_backlog", "Zapisi loga, ozhidayushchie zapisi v fayl");
+    return metric;
+}
+
+} // namespace Metrics
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "LatencyHistogram.h"
+
+// Schetchik, razdelennyy na shardy po potokam: kazhdyy potok uvelichivaet
+// svoyu yacheyku v otdel'noy kesh-linii, summa schitaetsya tol'ko pri chtenii.
+class Counter {
+public:
+    static constexpr int SHARD_COUNT = 16;
+
+    Counter();
+
+    void add(uint64_t value = 1);
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, SHARD_COUNT> m_shards;
+};
+
+// Tekushchee znachenie (aktivnye soedineniya, ochered' logov)
+class Gauge {
+public:
+    void set(int64_t value) { m_value.store(value, std::memory_order_relaxed); }
+    void add(int64_t delta) { m_value.fetch_add(delta, std::memory_order_relaxed); }
+    void sub(int64_t delta) { m_value.fetch_sub(delta, std::memory_order_relaxed); }
+    int64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> m_value{0};
+};
+
+// Reestr metrik protsessa. Metriki sozdayutsya odin raz i zhivut do kontsa
+// programmy, poetomu ssylki na nikh mozhno keshirovat' v statikakh.
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    Counter& counter(const std::string& name, const std::string& help = std::string());
+    Gauge& gauge(const std::string& name, const std::string& help = std::string());
+    LatencyHistogram& histogram(const std::string& name, const std::string& help = std::string());
+
+    // Tekstovoe predstavlenie v formate Prometheus
+    std::string renderText() const;
+
+private:
+    MetricsRegistry() = default;
+
+    template <typename Metric>
+    struct Entry {
+        std::string help;
+        std::unique_ptr<Metric> metric;
+    };
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, Entry<Counter>> m_counters;
+    std::map<std::string, Entry<Gauge>> m_gauges;
+    std::map<std::string, Entry<LatencyHistogram>> m_histograms;
+};
+
+// Zapis' dlitel'nosti oblasti vidimosti v mikrosekundakh
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram& histogram)
+        : m_histogram(histogram)
+        , m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ScopedLatency()
+    {
+        m_histogram.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - m_start).count()));
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram& m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Metriki servera
+namespace Metrics {
+
+Counter& connectionsAccepted();
+Gauge& connectionsActive();
+Counter& bytesReceived();
+Counter& bytesSent();
+Counter& compressionInputBytes();
+Counter& compressionOutputBytes();
+Counter& historySyncedMessages();
+Counter& framesQueued();
+Counter& socketWrites();
+LatencyHistogram& sendLatency();
+LatencyHistogram& authLatency();
+Gauge& logBacklog();
+
+} // namespace Metrics
@@ -0,0 +1,222 @@
+#include "TraceRecorder.h"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+int64_t steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Sostoyanie vlozhennosti intervalov potoka
+struct SpanState {
+    uint32_t depth = 0;
+    uint32_t rootCounter = 0;
+    bool sampled = false;
+};
+
+thread_local SpanState spanState;
+
+void appendJsonString(std::ostringstream& out, const std::string& value)
+{
+    out << '"';
+    for (char c : value) {
+        switch (c) {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        default:
+            if (static_cast<unsigned char>(c) >= 0x20)
+                out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+TraceRecorder::TraceRecorder()
+    : m_enabled(false)
+    , m_sampleRate(1)
+    , m_epochNs(steadyNowNs())
+{
+}
+
+TraceRecorder& TraceRecorder::instance()
+{
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+void TraceRecorder::setEnabled(bool enabled)
+{
+    m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void TraceRecorder::setSampleRate(uint32_t everyNth)
+{
+    m_sampleRate.store(everyNth ? everyNth : 1, std::memory_order_relaxed);
+}
+
+int64_t TraceRecorder::now() const
+{
+    return steadyNowNs() - m_epochNs;
+}
+
+TraceRecorder::BufferLease::~BufferLease()
+{
+    // Sobytiya zavershivshegosya potoka ostayutsya v otchete,
+    // poka ikh ne vytesnit sleduyushchiy arendator
+    if (buffer) {
+        TraceRecorder& recorder = TraceRecorder::instance();
+        std::lock_guard<std::mutex> lock(recorder.m_buffersMutex);
+        recorder.m_freeBuffers.push_back(std::move(buffer));
+    }
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::threadBuffer()
+{
+    // Potok-na-klienta ne dolzhen ostavlyat' po buferu na kazhdoe soedinenie:
+    // chislo buferov ogranicheno pikom odnovremenno zhivykh potokov
+    thread_local BufferLease lease;
+    if (!lease.requested) {
+        lease.requested = true;
+
+        std::lock_guard<std::mutex> lock(m_buffersMutex);
+        if (!m_freeBuffers.empty()) {
+            lease.buffer = std::move(m_freeBuffers.back());
+            m_freeBuffers.pop_back();
+        }
+        else if (m_buffers.size() < MAX_THREAD_BUFFERS) {
+            lease.buffer = std::make_shared<ThreadBuffer>();
+            lease.buffer->events.resize(RING_CAPACITY);
+            lease.buffer->threadId = static_cast<uint32_t>(m_buffers.size() + 1);
+            m_buffers.push_back(lease.buffer);
+        }
+    }
+    return lease.buffer.get();
+}
+
+void TraceRecorder::setThreadName(const std::string& name)
+{
+    ThreadBuffer* buffer = threadBuffer();
+    if (!buffer)
+        return;
+    std::lock_guard<std::mutex> lock(buffer->mtx);
+    buffer->threadName = name;
+}
+
+void TraceRecorder::record(const char* name, int64_t startNs, int64_t durationNs)
+{
+    ThreadBuffer* buffer = threadBuffer();
+    if (!buffer)
+        return;
+    std::lock_guard<std::mutex> lock(buffer->mtx);
+    buffer->events[buffer->next] = Event{ name, startNs, durationNs };
+    if (++buffer->next == RING_CAPACITY) {
+        buffer->next = 0;
+        buffer->wrapped = true;
+    }
+}
+
+std::string TraceRecorder::chromeTraceJson() const
+{
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(m_buffersMutex);
+        buffers = m_buffers;
+    }
+
+    std::ostringstream out;
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() {
+        if (!first)
+            out << ",\n";
+        first = false;
+    };
+
+    for (const auto& buffer : buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mtx);
+        if (!buffer->threadName.empty()) {
+            separator();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+                << ",\"args\":{\"name\":";
+            appendJsonString(out, buffer->threadName);
+            out << "}}";
+        }
+
+        // Sobytiya v poryadke zapisi: ot samogo starogo
+        size_t count = buffer->wrapped ? RING_CAPACITY : buffer->next;
+        size_t begin = buffer->wrapped ? buffer->next : 0;
+        for (size_t i = 0; i < count; ++i) {
+            const Event& event = buffer->events[(begin + i) % RING_CAPACITY];
+            separator();
+            out << "{\"name\":";
+            appendJsonString(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                << ",\"ts\":" << event.startNs / 1000 << '.' << (event.startNs % 1000) / 100
+                << ",\"dur\":" << event.durationNs / 1000 << '.' << (event.durationNs % 1000) / 100
+                << '}';
+        }
+    }
+    out << "]}\n";
+    return out.str();
+}
+
+bool TraceRecorder::writeChromeTrace(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+        return false;
+    file << chromeTraceJson();
+    return static_cast<bool>(file);
+}
+
+void TraceRecorder::clear()
+{
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(m_buffersMutex);
+        buffers = m_buffers;
+    }
+    for (const auto& buffer : buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mtx);
+        buffer->next = 0;
+        buffer->wrapped = false;
+    }
+}
+
+TraceSpan::TraceSpan(const char* name)
+    : m_name(name)
+    , m_start(0)
+    , m_active(false)
+{
+    TraceRecorder& recorder = TraceRecorder::instance();
+    SpanState& state = spanState;
+
+    // Reshenie o vyborke prinimaetsya dlya kornevogo intervala,
+    // vlozhennye nasleduyut ego, chtoby derevo ne rvalos'
+    if (state.depth == 0) {
+        state.sampled = recorder.isEnabled() &&
+            ++state.rootCounter % recorder.sampleRate() == 0;
+    }
+    ++state.depth;
+
+    if (state.sampled) {
+        m_active = true;
+        m_start = recorder.now();
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    --spanState.depth;
+    if (m_active) {
+        TraceRecorder& recorder = TraceRecorder::instance();
+        recorder.record(m_name, m_start, recorder.now() - m_start);
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Zapis' trassirovochnykh intervalov goryachikh putey.
+// Kazhdyy potok pishet v svoy kol'tsevoy bufer; vygruzka v format
+// Chrome trace (chrome://tracing, Perfetto) vypolnyaetsya po zaprosu.
+// Makros CHAT_TRACE_SCOPE kompiliruetsya v pustotu bez CHAT_ENABLE_TRACING.
+class TraceRecorder {
+public:
+    // Razmer kol'tsevogo bufera potoka (sobytiy)
+    static constexpr size_t RING_CAPACITY = 16384;
+
+    // Buferov na vse potoki; potoki sverkh limita ne zapisyvayutsya
+    static constexpr size_t MAX_THREAD_BUFFERS = 256;
+
+    struct Event {
+        const char* name;       // Tol'ko strokovye literaly
+        int64_t startNs;
+        int64_t durationNs;
+    };
+
+    static TraceRecorder& instance();
+
+    // Vklyuchenie zapisi vo vremya raboty
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // Zapisyvaetsya kazhdoe N-e kornevoe derevo intervalov potoka (1 - vse)
+    void setSampleRate(uint32_t everyNth);
+    uint32_t sampleRate() const { return m_sampleRate.load(std::memory_order_relaxed); }
+
+    // Imya tekushchego potoka v otchete
+    void setThreadName(const std::string& name);
+
+    void record(const char* name, int64_t startNs, int64_t durationNs);
+
+    // Vremya ot starta zapisi v nanosekundakh
+    int64_t now() const;
+
+    // JSON v formate Chrome trace
+    std::string chromeTraceJson() const;
+    bool writeChromeTrace(const std::string& path) const;
+
+    // Ochistka vsekh buferov
+    void clear();
+
+private:
+    TraceRecorder();
+
+    struct ThreadBuffer {
+        std::mutex mtx;                 // Bez konkurentsii, krome momenta vygruzki
+        std::vector<Event> events;
+        size_t next = 0;
+        bool wrapped = false;
+        uint32_t threadId = 0;
+        std::string threadName;
+    };
+
+    // Arenda bufera potokom: pri zavershenii potoka bufer vozvrashchaetsya
+    // v pul i dostaetsya sleduyushchemu novomu potoku. Novyy potok pishet
+    // poverkh starykh sobytiy, tid v otchete - nomer bufera, a ne potoka.
+    struct BufferLease {
+        std::shared_ptr<ThreadBuffer> buffer;
+        bool requested = false;
+        ~BufferLease();
+    };
+
+    // nullptr, esli vse MAX_THREAD_BUFFERS zanyaty
+    ThreadBuffer* threadBuffer();
+
+    std::atomic<bool> m_enabled;
+    std::atomic<uint32_t> m_sampleRate;
+    int64_t m_epochNs;
+
+    mutable std::mutex m_buffersMutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> m_buffers;
+    std::vector<std::shared_ptr<ThreadBuffer>> m_freeBuffers;   // Ot zavershivshikhsya potokov
+};
+
+// Interval ot konstruktora do destruktora
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* m_name;
+    int64_t m_start;
+    bool m_active;
+};
+
+#ifdef CHAT_ENABLE_TRACING
+#define CHAT_TRACE_CONCAT_IMPL(a, b) a##b
+#define CHAT_TRACE_CONCAT(a, b) CHAT_TRACE_CONCAT_IMPL(a, b)
+#define CHAT_TRACE_SCOPE(name) TraceSpan CHAT_TRACE_CONCAT(traceSpan_, __LINE__)(name)
+#else
+#define CHAT_TRACE_SCOPE(name) ((void)0)
+#endif
@@ -0,0 +1,256 @@
+#include "chattcpserver.h"
+#include "BanList.h"
+#include "AdmissionController.h"
+#include "MetricsRegistry.h"
+#include <QFile>
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QSslSocket>
+#ifdef CHAT_SHARED_SSL_CONTEXT
+#include <private/qsslsocket_p.h>   // Obshchiy QSslContext, kak v QHttpNetworkConnection
+#endif
+
+#ifdef Q_OS_WIN
+#include <WS2tcpip.h>
+using NativeSocket = SOCKET;
+#else
+#include <sys/socket.h>
+#include <unistd.h>
+using NativeSocket = int;
+#endif
+
+namespace {
+
+void closeDescriptor(qintptr socketDescriptor)
+{
+#ifdef Q_OS_WIN
+    closesocket(static_cast<NativeSocket>(socketDescriptor));
+#else
+    ::close(static_cast<NativeSocket>(socketDescriptor));
+#endif
+}
+
+Counter& bannedConnections()
+{
+    static Counter& metric = MetricsRegistry::instance().counter(
+        "chat_connections_banned_total", "Soedineniya, otklonennye po spisku banov");
+    return metric;
+}
+
+Counter& tlsHandshakes()
+{
+    static Counter& metric = MetricsRegistry::instance().counter(
+        "chat_tls_handshakes_total", "Zavershennye rukopozhatiya TLS");
+    return metric;
+}
+
+} // namespace
+
+ChatTcpServer::ChatTcpServer(QObject* parent) :
+    QTcpServer(parent),
+    m_bans(nullptr),
+    m_admission(nullptr),
+    m_resumeTimer(new QTimer(this)),
+    m_tlsEnabled(false)
+{
+    m_resumeTimer->setSingleShot(true);
+    m_resumeTimer->setInterval(ACCEPT_PAUSE);
+    connect(m_resumeTimer, &QTimer::timeout,
+        this, &ChatTcpServer::resumeIfAvailable);
+}
+
+void ChatTcpServer::setBanList(const BanList* bans)
+{
+    m_bans = bans;
+}
+
+void ChatTcpServer::setAdmissionController(AdmissionController* admission)
+{
+    m_admission = admission;
+
+    // QTcpServer perestaet prinimat', poka ochered' ozhidayushchikh polna:
+    // obrabotchik newConnection (QueuedConnection) razbiraet ee paketom,
+    // i tsikl sobytiy uspevaet obsluzhit' uzhe podklyuchennykh klientov
+    if (m_admission)
+        setMaxPendingConnections(static_cast<int>(m_admission->getLimits().acceptBatch));
+}
+
+bool ChatTcpServer::enableTls(const QString& certFile, const QString& keyFile)
+{
+    if (!QSslSocket::supportsSsl())
+        return false;
+
+    QList<QSslCertificate> chain = QSslCertificate::fromPath(certFile, QSsl::Pem);
+    QFile file(keyFile);
+    if (chain.isEmpty() || !file.open(QIODevice::ReadOnly))
+        return false;
+
+    QByteArray pem = file.readAll();
+    QSslKey key(pem, QSsl::Rsa, QSsl::Pem);
+    if (key.isNull())
+        key = QSslKey(pem, QSsl::Ec, QSsl::Pem);
+    if (key.isNull())
+        return false;
+
+    QSslConfiguration configuration = QSslConfiguration::defaultConfiguration();
+    configuration.setLocalCertificateChain(chain);
+    configuration.setPrivateKey(key);
+    configuration.setPeerVerifyMode(QSslSocket::VerifyNone);
+    configuration.setProtocol(QSsl::TlsV1_2OrLater);
+    configuration.setSslOption(QSsl::SslOptionDisableSessionTickets, false);
+
+    m_sslConfiguration = configuration;
+#ifdef CHAT_SHARED_SSL_CONTEXT
+    m_sslContext.clear();
+#endif
+    m_tlsEnabled = true;
+    return true;
+}
+
+bool ChatTcpServer::isTlsEnabled() const
+{
+    return m_tlsEnabled;
+}
+
+bool ChatTcpServer::sharesSslContext()
+{
+#ifdef CHAT_SHARED_SSL_CONTEXT
+    return true;
+#else
+    return false;
+#endif
+}
+
+quint64 ChatTcpServer::admissionKey(const QTcpSocket* socket)
+{
+    return static_cast<quint64>(reinterpret_cast<quintptr>(socket));
+}
+
+void ChatTcpServer::incomingConnection(qintptr socketDescriptor)
+{
+    sockaddr_storage address;
+    socklen_t length = sizeof(address);
+    bool known = getpeername(static_cast<NativeSocket>(socketDescriptor), reinterpret_cast<sockaddr*>(&address), &length) == 0;
+    const sockaddr* peer = reinterpret_cast<const sockaddr*>(&address);
+
+    if (m_bans && known && m_bans->isAddressBanned(peer)) {
+        closeDescriptor(socketDescriptor);
+        bannedConnections().add();
+        emit connectionRejected("ban");
+        return;
+    }
+
+    if (!m_admission) {
+        QTcpSocket* socket = createSocket();
+        socket->setSocketDescriptor(socketDescriptor);
+        startEncryption(socket);
+        addPendingConnection(socket);
+        return;
+    }
+
+    BanList::Address peerAddress;
+    if (!known || !BanList::fromSockaddr(peer, peerAddress)) {
+        closeDescriptor(socketDescriptor);
+        return;
+    }
+
+    // Klyuch dopuska - adres soketa, slot osvobozhdaetsya pri ego udalenii
+    QTcpSocket* socket = createSocket();
+    quint64 key = admissionKey(socket);
+    AdmissionController::Decision decision = m_admission->admit(key, peerAddress);
+    if (decision != AdmissionController::ADMITTED) {
+        delete socket;
+        closeDescriptor(socketDescriptor);
+        emit connectionRejected(AdmissionController::decisionName(decision));
+        throttle();
+        return;
+    }
+
+    connect(socket, &QObject::destroyed, this, [this, key]() {
+        m_admission->release(key);
+    });
+    socket->setSocketDescriptor(socketDescriptor);
+    startEncryption(socket);
+    addPendingConnection(socket);
+    throttle();
+}
+
+QTcpSocket* ChatTcpServer::createSocket()
+{
+    if (m_tlsEnabled)
+        return new QSslSocket(this);
+    return new QTcpSocket(this);
+}
+
+void ChatTcpServer::startEncryption(QTcpSocket* socket)
+{
+    QSslSocket* sslSocket = qobject_cast<QSslSocket*>(socket);
+    if (!sslSocket)
+        return;
+
+    // Qt sozdaet SSL_CTX na kazhdyy soket so svoim klyuchom biletov, i bilet
+    // drugogo soedineniya ne rasshifrovyvaetsya. Kontekst pervogo soedineniya
+    // peredaetsya ostal'nym: sertifikat ne razbiraetsya zanovo, a bilety
+    // prinimayutsya na lyubom soedinenii servera. Eto zakrytyy API Qt 5
+    // (QSslSocketPrivate), bez CHAT_SHARED_SSL_CONTEXT kontekst u soketa svoy.
+    sslSocket->setSslConfiguration(m_sslConfiguration);
+#ifdef CHAT_SHARED_SSL_CONTEXT
+    if (m_sslContext)
+        QSslSocketPrivate::checkSettingSslContext(sslSocket, m_sslContext);
+
+    connect(sslSocket, &QSslSocket::encrypted, this, [this, sslSocket]() {
+        if (!m_sslContext)
+            m_sslContext = QSslSocketPrivate::sslContext(sslSocket);
+        tlsHandshakes().add();
+    });
+#else
+    connect(sslSocket, &QSslSocket::encrypted, this, []() {
+        tlsHandshakes().add();
+    });
+#endif
+    sslSocket->startServerEncryption();
+}
+
+QTcpSocket* ChatTcpServer::nextPendingConnection()
+{
+    // Bazovyy klass snova vklyuchaet priem, pauza dolzhna sokhranit'sya
+    QTcpSocket* socket = QTcpServer::nextPendingConnection();
+    if (m_resumeTimer->isActive())
+        pauseAccepting();
+    return socket;
+}
+
+void ChatTcpServer::completeHandshake(QTcpSocket* socket)
+{
+    if (m_admission)
+        m_admission->completeHandshake(admissionKey(socket));
+}
+
+QList<QTcpSocket*> ChatTcpServer::expiredHandshakes() const
+{
+    QList<QTcpSocket*> sockets;
+    if (!m_admission)
+        return sockets;
+
+    // Klyuchi udalennykh soketov uzhe osvobozhdeny, ostal'nye zhivy
+    for (quint64 key : m_admission->expiredHandshakes())
+        sockets.append(reinterpret_cast<QTcpSocket*>(static_cast<quintptr>(key)));
+    return sockets;
+}
+
+void ChatTcpServer::throttle()
+{
+    if (m_admission->isSaturated() && !m_resumeTimer->isActive()) {
+        pauseAccepting();
+        m_resumeTimer->start();
+    }
+}
+
+void ChatTcpServer::resumeIfAvailable()
+{
+    if (m_admission && m_admission->isSaturated()) {
+        m_resumeTimer->start();
+        return;
+    }
+    resumeAccepting();
+}
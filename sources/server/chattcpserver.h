@@ -0,0 +1,78 @@
+#pragma once
+#ifndef CHATTCPSERVER_H
+#define CHATTCPSERVER_H
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QSslConfiguration>
+#include <QSharedPointer>
+
+class BanList;
+class AdmissionController;
+#ifdef CHAT_SHARED_SSL_CONTEXT
+class QSslContext;
+#endif
+
+// QTcpServer s proverkoy adresa do sozdaniya QTcpSocket:
+// soedineniya iz zabanennykh podsetey zakryvayutsya po deskriptoru,
+// ne popadaya v ochered' ozhidayushchikh soedineniy.
+// Kontroller dopuska ogranichivaet chislo soedineniy; pri perepolnenii
+// priem priostanavlivaetsya, i novye soedineniya zhdut v ocheredi yadra.
+// Za odno probuzhdenie prinimaetsya ne bolee acceptBatch soedineniy.
+// V rezhime TLS sozdayutsya QSslSocket. So sborkoy CHAT_SHARED_SSL_CONTEXT
+// kontekst SSL pervogo soedineniya peredaetsya sleduyushchim, poetomu klyuch
+// biletov sessii i kesh sessiy u vsekh soedineniy obshchiy i klient mozhet
+// vozobnovit' sessiyu; bez nee u kazhdogo soedineniya svoy kontekst i kazhdoe
+// rukopozhatie polnoe.
+class ChatTcpServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    explicit ChatTcpServer(QObject* parent = nullptr);
+
+    void setBanList(const BanList* bans);
+    void setAdmissionController(AdmissionController* admission);
+
+    // Vklyuchenie TLS s sertifikatom i klyuchom v formate PEM
+    bool enableTls(const QString& certFile, const QString& keyFile);
+    bool isTlsEnabled() const;
+
+    // Obshchiy kontekst SSL (vozobnovlenie sessiy) vklyuchen pri sborke
+    static bool sharesSslContext();
+
+    // Vkhod vypolnen, soedinenie bol'she ne schitaetsya ozhidayushchim
+    void completeHandshake(QTcpSocket* socket);
+
+    // Soedineniya, ne vypolnivshie vkhod za HANDSHAKE_TIMEOUT
+    QList<QTcpSocket*> expiredHandshakes() const;
+
+    QTcpSocket* nextPendingConnection() override;
+
+signals:
+    void connectionRejected(const QString& reason);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private slots:
+    void resumeIfAvailable();
+
+private:
+    static quint64 admissionKey(const QTcpSocket* socket);
+    QTcpSocket* createSocket();
+    void startEncryption(QTcpSocket* socket);
+    void throttle();
+
+    const BanList* m_bans;
+    AdmissionController* m_admission;
+    QTimer* m_resumeTimer;
+    QSslConfiguration m_sslConfiguration;
+    bool m_tlsEnabled;
+#ifdef CHAT_SHARED_SSL_CONTEXT
+    QSharedPointer<QSslContext> m_sslContext;
+#endif
+};
+
+#endif //  CHATTCPSERVER_H
@@ -0,0 +1,84 @@
+#include "metricsendpoint.h"
+#include "MetricsRegistry.h"
+#include "TraceRecorder.h"
+#include <QHostAddress>
+#include <QDebug>
+
+MetricsEndpoint::MetricsEndpoint(QObject* parent) :
+    QObject(parent),
+    m_server(new QTcpServer(this))
+{
+    connect(m_server, &QTcpServer::newConnection,
+        this, &MetricsEndpoint::handleNewConnection);
+}
+
+MetricsEndpoint::~MetricsEndpoint()
+{
+    stop();
+}
+
+bool MetricsEndpoint::start(quint16 port)
+{
+    if (m_server->isListening())
+        return true;
+
+    if (!m_server->listen(QHostAddress::LocalHost, port)) {
+        qDebug() << "Ne udalos' zapustit' vydachu metrik: " << m_server->errorString();
+        return false;
+    }
+    return true;
+}
+
+void MetricsEndpoint::stop()
+{
+    m_server->close();
+}
+
+bool MetricsEndpoint::isListening() const
+{
+    return m_server->isListening();
+}
+
+void MetricsEndpoint::handleNewConnection()
+{
+    while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead,
+            this, &MetricsEndpoint::answerRequest);
+        connect(socket, &QTcpSocket::disconnected,
+            socket, &QObject::deleteLater);
+    }
+}
+
+void MetricsEndpoint::answerRequest()
+{
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket)
+        return;
+
+    // Iz zaprosa nuzhna tol'ko pervaya stroka s putem
+    if (!socket->canReadLine())
+        return;
+    QByteArray requestLine = socket->readLine();
+    socket->readAll();
+    disconnect(socket, &QTcpSocket::readyRead, this, &MetricsEndpoint::answerRequest);
+
+    QByteArray body;
+    QByteArray contentType;
+    if (requestLine.startsWith("GET /trace")) {
+        body = QByteArray::fromStdString(TraceRecorder::instance().chromeTraceJson());
+        contentType = "application/json";
+    }
+    else {
+        body = QByteArray::fromStdString(MetricsRegistry::instance().renderText());
+        contentType = "text/plain; version=0.0.4";
+    }
+
+    QByteArray response = "HTTP/1.0 200 OK\r\n"
+        "Content-Type: " + contentType + "\r\n"
+        "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+        "Connection: close\r\n\r\n";
+    response.append(body);
+
+    socket->write(response);
+    socket->disconnectFromHost();
+}
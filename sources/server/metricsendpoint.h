@@ -0,0 +1,33 @@
+#pragma once
+#ifndef METRICSENDPOINT_H
+#define METRICSENDPOINT_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+// Lokal'naya tochka vydachi metrik: na zapros otvechaet HTTP/1.0
+// s tekstom MetricsRegistry::renderText() i zakryvaet soedinenie.
+// Zapros "GET /trace" vozvrashchaet trassirovku v formate Chrome trace.
+// Slushaet tol'ko 127.0.0.1, chtoby metriki ne byli vidny izvne.
+class MetricsEndpoint : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsEndpoint(QObject* parent = nullptr);
+    ~MetricsEndpoint();
+
+    bool start(quint16 port);
+    void stop();
+    bool isListening() const;
+
+private slots:
+    void handleNewConnection();
+    void answerRequest();
+
+private:
+    QTcpServer* m_server;
+};
+
+#endif //  METRICSENDPOINT_H
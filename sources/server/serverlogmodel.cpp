@@ -1,38 +1,63 @@
 #include "serverlogmodel.h"
 #include <QDateTime>
 #include <QDebug>
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
 
-ServerLogModel::ServerLogModel(QObject* parent)
+namespace {
+
+const char* const TIME_FORMAT = "dd.MM.yyyy hh:mm:ss";
+const QString FIELD_SEPARATOR = " | ";
+
+} // namespace
+
+ServerLogModel::ServerLogModel(QObject* parent, int capacity)
     : QAbstractListModel(parent)
+    , m_firstIndex(0)
+    , m_nextIndex(0)
+    , m_capacity(CHUNK_SIZE)
+    , m_cachedSecond(-1)
+    , m_flushTimer(new QTimer(this))
 {
     // Initsializatsiya roley
     m_roleNames[MessageRole] = "message";
     m_roleNames[TypeRole] = "type";
     m_roleNames[TimeRole] = "time";
     m_roleNames[UserRole] = "user";
+
+    setCapacity(capacity);
+
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(LOG_BATCH_LATENCY);
+    connect(m_flushTimer, &QTimer::timeout, this, &ServerLogModel::flushPendingLogs);
 }
 
 int ServerLogModel::rowCount(const QModelIndex& parent) const
 {
     if (parent.isValid())
         return 0;
-    return m_logs.size();
+    return m_filter.isEmpty() ? totalCount() : static_cast<int>(m_filtered.size());
 }
 
 QVariant ServerLogModel::data(const QModelIndex& index, int role) const
 {
-    if (!index.isValid())
+    if (!index.isValid() || index.row() >= rowCount())
         return QVariant();
 
-    const LogEntry& entry = m_logs[index.row()];
+    qint64 absoluteIndex = m_filter.isEmpty()
+        ? m_firstIndex + index.row()
+        : m_filtered[static_cast<size_t>(index.row())];
+    const LogEntry& entry = entryAt(absoluteIndex);
 
     switch (role) {
+    case Qt::DisplayRole:
     case MessageRole:
         return entry.message;
     case TypeRole:
         return entry.type;
     case TimeRole:
-        return entry.time.toString("dd.MM.yyyy hh:mm:ss");
+        return entry.timeText;
     case UserRole:
         return entry.user;
     default:
@@ -47,24 +72,67 @@ QHash<int, QByteArray> ServerLogModel::roleNames() const
 
 void ServerLogModel::addLogMessage(const QString& message, const QString& type, const QString& user)
 {
-    beginInsertRows(QModelIndex(), rowCount(), rowCount());
-
     LogEntry newEntry;
     newEntry.message = message;
     newEntry.type = type;
-    newEntry.time = QDateTime::currentDateTime();
     newEntry.user = user;
+    newEntry.timeMs = QDateTime::currentMSecsSinceEpoch();
 
-    m_logs.append(newEntry);
-    endInsertRows();
+    bool firstPending;
+    {
+        QMutexLocker locker(&m_pendingMutex);
+        firstPending = m_pending.isEmpty();
+        m_pending.append(std::move(newEntry));
+    }
+
+    // Taymer zapuskaetsya v potoke modeli odin raz na partiyu
+    if (firstPending)
+        QMetaObject::invokeMethod(this, "startFlushTimer", Qt::QueuedConnection);
+}
+
+void ServerLogModel::startFlushTimer()
+{
+    if (!m_flushTimer->isActive())
+        m_flushTimer->start();
+}
+
+void ServerLogModel::flushPendingLogs()
+{
+    QVector<LogEntry> batch;
+    {
+        QMutexLocker locker(&m_pendingMutex);
+        batch.swap(m_pending);
+    }
+    m_flushTimer->stop();
+    if (batch.isEmpty())
+        return;
+
+    int count = batch.size();
+    appendEntries(batch);
+    emit logsAdded(count);
+}
+
+void ServerLogModel::setMaxBatchLatency(int ms)
+{
+    m_flushTimer->setInterval(qMax(0, ms));
+}
 
-    emit logAdded(message);
+int ServerLogModel::maxBatchLatency() const
+{
+    return m_flushTimer->interval();
 }
 
 void ServerLogModel::clearLogs()
 {
+    {
+        QMutexLocker locker(&m_pendingMutex);
+        m_pending.clear();
+    }
+
     beginResetModel();
-    m_logs.clear();
+    m_chunks.clear();
+    m_filtered.clear();
+    m_firstIndex = m_nextIndex = 0;
     endResetModel();
 
     emit logsCleared();
@@ -72,24 +140,161 @@ void ServerLogModel::clearLogs()
 
 void ServerLogModel::filterLogs(const QString& filter)
 {
+    if (filter == m_filter)
+        return;
+
+    beginResetModel();
+    if (filter.isEmpty()) {
+        m_filtered.clear();
+    }
+    else if (!m_filter.isEmpty() && filter.contains(m_filter, Qt::CaseInsensitive)) {
+        // Utochnenie fil'tra: dostatochno proverit' uzhe otobrannye zapisi
+        std::deque<qint64> narrowed;
+        for (qint64 absoluteIndex : m_filtered) {
+            if (matchesFilter(entryAt(absoluteIndex), filter))
+                narrowed.push_back(absoluteIndex);
+        }
+        m_filtered.swap(narrowed);
+    }
+    else {
+        m_filtered.clear();
+        for (qint64 i = m_firstIndex; i < m_nextIndex; ++i) {
+            if (matchesFilter(entryAt(i), filter))
+                m_filtered.push_back(i);
+        }
+    }
     m_filter = filter;
+    endResetModel();
+
     emit filterChanged(filter);
 }
 
-// Dopolnitel'nyye metody dlya raboty s fil'tratsiyey
-QList<LogEntry> ServerLogModel::filteredLogs() const
+QString ServerLogModel::filter() const
 {
-    QList<LogEntry> filtered;
+    return m_filter;
+}
 
-    for (const LogEntry& entry : m_logs) {
-        if (entry.message.contains(m_filter, Qt::CaseInsensitive) ||
-            entry.type.contains(m_filter, Qt::CaseInsensitive) ||
-            entry.user.contains(m_filter, Qt::CaseInsensitive)) {
-            filtered.append(entry);
-        }
+void ServerLogModel::setCapacity(int capacity)
+{
+    // Ne men'she dvukh blokov: otbrasyvaetsya vsegda zapolnennyy blok
+    int chunks = qMax(2, (capacity + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    m_capacity = chunks * CHUNK_SIZE;
+    trimToCapacity(true);
+}
+
+int ServerLogModel::capacity() const
+{
+    return m_capacity;
+}
+
+int ServerLogModel::totalCount() const
+{
+    return static_cast<int>(m_nextIndex - m_firstIndex);
+}
+
+void ServerLogModel::appendEntry(LogEntry&& entry, bool notify)
+{
+    if (totalCount() >= m_capacity)
+        dropOldestChunk(notify);
+
+    if (m_chunks.empty() || m_chunks.back()->size() == CHUNK_SIZE) {
+        m_chunks.emplace_back(new Chunk);
+        m_chunks.back()->reserve(CHUNK_SIZE);
     }
 
-    return filtered;
+    bool visible = m_filter.isEmpty() || matchesFilter(entry, m_filter);
+    int row = rowCount();
+    if (notify && visible)
+        beginInsertRows(QModelIndex(), row, row);
+
+    m_chunks.back()->append(std::move(entry));
+    if (!m_filter.isEmpty() && visible)
+        m_filtered.push_back(m_nextIndex);
+    ++m_nextIndex;
+
+    if (notify && visible)
+        endInsertRows();
+}
+
+void ServerLogModel::appendEntries(QVector<LogEntry>& batch)
+{
+    // Partiya bol'she emkosti: ostavlyaem tol'ko samye novye zapisi
+    int keep = qMin(batch.size(), m_capacity - CHUNK_SIZE);
+    int skip = batch.size() - keep;
+
+    // Mesto osvobozhdaetsya zaranee; nezapolnennyy posledniy blok ne otbrasyvaetsya
+    while (m_chunks.size() > 1 && totalCount() + keep > m_capacity)
+        dropOldestChunk(true);
+
+    int visible = 0;
+    for (int i = skip; i < batch.size(); ++i) {
+        LogEntry& entry = batch[i];
+        entry.timeText = timeTextFor(entry.timeMs);
+        if (m_filter.isEmpty() || matchesFilter(entry, m_filter))
+            ++visible;
+    }
+
+    int firstRow = rowCount();
+    if (visible > 0)
+        beginInsertRows(QModelIndex(), firstRow, firstRow + visible - 1);
+
+    for (int i = skip; i < batch.size(); ++i)
+        appendEntry(std::move(batch[i]), false);
+
+    if (visible > 0)
+        endInsertRows();
+}
+
+void ServerLogModel::dropOldestChunk(bool notify)
+{
+    if (m_chunks.empty())
+        return;
+
+    qint64 droppedEnd = m_firstIndex + m_chunks.front()->size();
+    int removedRows = m_filter.isEmpty()
+        ? m_chunks.front()->size()
+        : static_cast<int>(std::lower_bound(m_filtered.begin(), m_filtered.end(), droppedEnd) - m_filtered.begin());
+
+    if (notify && removedRows > 0)
+        beginRemoveRows(QModelIndex(), 0, removedRows - 1);
+
+    m_chunks.pop_front();
+    m_firstIndex = droppedEnd;
+    if (!m_filter.isEmpty())
+        m_filtered.erase(m_filtered.begin(), m_filtered.begin() + removedRows);
+
+    if (notify && removedRows > 0)
+        endRemoveRows();
+}
+
+void ServerLogModel::trimToCapacity(bool notify)
+{
+    while (totalCount() > m_capacity)
+        dropOldestChunk(notify);
+}
+
+const ServerLogModel::LogEntry& ServerLogModel::entryAt(qint64 absoluteIndex) const
+{
+    // m_firstIndex vsegda vyrovnen po granitse bloka
+    size_t chunk = static_cast<size_t>((absoluteIndex - m_firstIndex) / CHUNK_SIZE);
+    return m_chunks[chunk]->at(static_cast<int>(absoluteIndex % CHUNK_SIZE));
+}
+
+bool ServerLogModel::matchesFilter(const LogEntry& entry, const QString& filter) const
+{
+    return entry.message.contains(filter, Qt::CaseInsensitive) ||
+        entry.type.contains(filter, Qt::CaseInsensitive) ||
+        entry.user.contains(filter, Qt::CaseInsensitive);
+}
+
+QString ServerLogModel::timeTextFor(qint64 timeMs)
+{
+    qint64 second = timeMs / 1000;
+    if (second != m_cachedSecond) {
+        m_cachedSecond = second;
+        m_cachedTimeText = QDateTime::fromMSecsSinceEpoch(timeMs).toString(TIME_FORMAT);
+    }
+    return m_cachedTimeText;
 }
 
 // Metod dlya sokhraneniya logov v fayl
@@ -103,10 +308,11 @@ void ServerLogModel::saveLogsToFile(const QString& fileName) const
 
     QTextStream out(&file);
 
-    for (const LogEntry& entry : m_logs) {
-        out << entry.time.toString("dd.MM.yyyy hh:mm:ss") << " | "
-            << entry.type << " | "
-            << entry.user << " | "
+    for (qint64 i = m_firstIndex; i < m_nextIndex; ++i) {
+        const LogEntry& entry = entryAt(i);
+        out << entry.timeText << FIELD_SEPARATOR
+            << entry.type << FIELD_SEPARATOR
+            << entry.user << FIELD_SEPARATOR
             << entry.message << "\n";
     }
 
@@ -123,17 +329,35 @@ void ServerLogModel::loadLogsFromFile(const QString& fileName)
     }
 
     QTextStream in(&file);
-    QString line;
 
     beginResetModel();
-    m_logs.clear();
-
- 
+    m_chunks.clear();
+    m_filtered.clear();
+    m_firstIndex = m_nextIndex = 0;
 
     while (!in.atEnd()) {
-        line = in.readLine();
-       // Zdes mozhno dobavit parsing stroki i sozdat LogEntry
+        QString line = in.readLine();
+
+        // Soobshchenie mozhet soderzhat' razdelitel', poetomu polya berutsya sleva
+        int typePos = line.indexOf(FIELD_SEPARATOR);
+        int userPos = typePos < 0 ? -1 : line.indexOf(FIELD_SEPARATOR, typePos + FIELD_SEPARATOR.size());
+        int messagePos = userPos < 0 ? -1 : line.indexOf(FIELD_SEPARATOR, userPos + FIELD_SEPARATOR.size());
+        if (messagePos < 0)
+            continue;
 
+        LogEntry entry;
+        QDateTime time = QDateTime::fromString(line.left(typePos), TIME_FORMAT);
+        if (time.isValid()) {
+            entry.timeMs = time.toMSecsSinceEpoch();
+            entry.timeText = timeTextFor(entry.timeMs);
+        }
+        else {
+            entry.timeText = line.left(typePos);
+        }
+        entry.type = line.mid(typePos + FIELD_SEPARATOR.size(), userPos - typePos - FIELD_SEPARATOR.size());
+        entry.user = line.mid(userPos + FIELD_SEPARATOR.size(), messagePos - userPos - FIELD_SEPARATOR.size());
+        entry.message = line.mid(messagePos + FIELD_SEPARATOR.size());
+        appendEntry(std::move(entry), false);
     }
 
     endResetModel();
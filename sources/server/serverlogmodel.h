@@ -1,11 +1,26 @@
 #pragma once
 
 #include <QAbstractListModel>
-#include <QList>
+#include <QVector>
 #include <QVariant>
 #include <QDateTime>
 #include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QTimer>
+#include <deque>
+#include <memory>
+#include "config.h"
 
+// Model' loga administratora.
+// Zapisi khranyatsya v kol'tse blokov po CHUNK_SIZE: pri prevyshenii emkosti
+// otbrasyvaetsya samyy staryy blok tselikom. Stroka vremeni formatiruetsya
+// odin raz na sekundu i razdelyaetsya zapisyami etoy sekundy. Pri aktivnom
+// fil'tre model' vedet indeks podkhodyashchikh zapisey i popolnyaet ego
+// pri dobavlenii, ne perebiraya ves' log.
+// addLogMessage mozhno vyzyvat' iz lyubogo potoka: zapisi nakaplivayutsya
+// i vstavlyayutsya v model' odnim diapazonom strok ne pozzhe chem cherez
+// maxBatchLatency() ms, poetomu predstavleniya perestraivayutsya raz na kadr.
 class ServerLogModel : public QAbstractListModel
 {
     Q_OBJECT
@@ -18,20 +33,43 @@ public:
         UserRole
     };
 
-    explicit ServerLogModel(QObject* parent = nullptr);
+    // Razmer bloka kol'tsa (zapisey)
+    static const int CHUNK_SIZE = 4096;
+
+    explicit ServerLogModel(QObject* parent = nullptr, int capacity = LOG_MODEL_CAPACITY);
 
     // Bazovye metody modeli
     int rowCount(const QModelIndex& parent = QModelIndex()) const override;
     QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
     QHash<int, QByteArray> roleNames() const override;
 
-    // Upravlenie logami
+    // Upravlenie logami; addLogMessage potokobezopasen
     void addLogMessage(const QString& message, const QString& type, const QString& user);
     void clearLogs();
     void filterLogs(const QString& filter);
+    QString filter() const;
+
+    // Emkost' kol'tsa; okruglyaetsya vverkh do tselogo chisla blokov
+    void setCapacity(int capacity);
+    int capacity() const;
+
+    // Vsego zapisey v kol'tse (bez ucheta fil'tra)
+    int totalCount() const;
+
+    // Maksimal'naya zaderzhka vstavki nakoplennykh zapisey, ms
+    void setMaxBatchLatency(int ms);
+    int maxBatchLatency() const;
+
+    // Sokhranenie i zagruzka v formate "vremya | tip | pol'zovatel' | soobshchenie"
+    void saveLogsToFile(const QString& fileName) const;
+    void loadLogsFromFile(const QString& fileName);
+
+public slots:
+    // Nemedlennaya vstavka nakoplennykh zapisey (vyzyvaetsya v potoke modeli)
+    void flushPendingLogs();
 
 signals:
-    void logAdded(const QString& message);
+    void logsAdded(int count);
     void logsCleared();
     void filterChanged(const QString& filter);
 
@@ -39,10 +77,42 @@ private:
     struct LogEntry {
         QString message;
         QString type;
-        QDateTime time;
         QString user;
+        QString timeText;       // Obshchaya stroka dlya vsekh zapisey sekundy
+        qint64 timeMs = 0;
     };
+    using Chunk = QVector<LogEntry>;
+
+private slots:
+    void startFlushTimer();
+
+private:
+    // Dobavlenie zapisi v kol'tso; notify - soobshchat' li predstavleniyam
+    void appendEntry(LogEntry&& entry, bool notify);
+    // Vstavka partii odnim diapazonom strok
+    void appendEntries(QVector<LogEntry>& batch);
+    void dropOldestChunk(bool notify);
+    void trimToCapacity(bool notify);
+
+    const LogEntry& entryAt(qint64 absoluteIndex) const;
+    bool matchesFilter(const LogEntry& entry, const QString& filter) const;
+    QString timeTextFor(qint64 timeMs);
+
+    std::deque<std::unique_ptr<Chunk>> m_chunks;
+    qint64 m_firstIndex;            // Absolyutnyy nomer pervoy zapisi v kol'tse
+    qint64 m_nextIndex;             // Absolyutnyy nomer sleduyushchey zapisi
+    int m_capacity;
 
-    QList<LogEntry> m_logs;
     QString m_filter;
+    std::deque<qint64> m_filtered;  // Absolyutnye nomera zapisey, proshedshikh fil'tr
+
+    qint64 m_cachedSecond;
+    QString m_cachedTimeText;
+
+    QHash<int, QByteArray> m_roleNames;
+
+    // Zapisi iz lyubykh potokov, ozhidayushchie vstavki
+    QMutex m_pendingMutex;
+    QVector<LogEntry> m_pending;
+    QTimer* m_flushTimer;
 };
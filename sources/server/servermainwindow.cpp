@@ -2,7 +2,10 @@
 #include "ui_servermainwindow.h"
 #include "Logger.h"
 #include "UserInfoDialog.h"
+#include "MetricsRegistry.h"
+#include "config.h"
 #include <QMessageBox>
+#include <QInputDialog>
 #include <QFile>
 #include <QDir>
 #include <QDateTime>
@@ -13,17 +16,42 @@ ServerMainWindow::ServerMainWindow(QWidget* parent)
     , logger(Logger())
     , updateTimer(new QTimer(this))
     , userInfoDialog(new UserInfoDialog(this))
+    , metricsEndpoint(new MetricsEndpoint(this))
+    , metricsLabel(new QLabel(this))
+    , lastAcceptedCount(0)
+    , userModel(new ServerUserListModel(this))
+    , userProxy(new ServerUserProxyModel(this))
+    , server(new ServerManager(this))
 {
     ui->setupUi(this);
+    ui->statusbar->addPermanentWidget(metricsLabel);
+
+    // Spisok pol'zovateley cherez proksi sortirovki i fil'tra
+    userProxy->setSourceModel(userModel);
+    ui->userListView->setModel(userProxy);
+    ui->userListView->setRootIsDecorated(false);
+    ui->userListView->setUniformRowHeights(true);
+    connect(ui->nicknameFilterEdit, &QLineEdit::textChanged, this, &ServerMainWindow::applyUserFilter);
+    connect(ui->subnetFilterEdit, &QLineEdit::textChanged, this, &ServerMainWindow::applyUserFilter);
+    connect(ui->bannedFilterCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+        this, &ServerMainWindow::applyUserFilter);
+    connect(ui->sortKeyCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+        userProxy->setSortKey(static_cast<ServerUserProxyModel::SortKey>(index));
+    });
 
     // Nastroyka taymera obnovleniya
     connect(updateTimer, &QTimer::timeout, this, &ServerMainWindow::updateUserList);
+    connect(updateTimer, &QTimer::timeout, this, &ServerMainWindow::updateMetrics);
     updateTimer->start(1000);
 
     // Podklyuchenie signalov
     connect(ui->startServerButton, &QPushButton::clicked, this, &ServerMainWindow::startServer);
     connect(ui->stopServerButton, &QPushButton::clicked, this, &ServerMainWindow::stopServer);
     connect(ui->clearLogsButton, &QPushButton::clicked, this, &ServerMainWindow::clearLogs);
+    connect(ui->banUserButton, &QPushButton::clicked, this, &ServerMainWindow::banUser);
+    connect(ui->unbanUserButton, &QPushButton::clicked, this, &ServerMainWindow::unbanUser);
+    connect(ui->banSubnetButton, &QPushButton::clicked, this, &ServerMainWindow::banSubnet);
+    connect(ui->unbanSubnetButton, &QPushButton::clicked, this, &ServerMainWindow::unbanSubnet);
     connect(ui->actionShow_User_Info, &QAction::triggered, this, &ServerMainWindow::showUserInfo);
 
     // Initsializatsiya logov
@@ -44,6 +72,42 @@ void ServerMainWindow::updateUserList()
     // ui->userListView->setModel(serverModel);
 }
 
+void ServerMainWindow::updateMetrics()
+{
+    // Taymer srabatyvaet raz v sekundu, poetomu raznost' - chastota priema
+    quint64 accepted = Metrics::connectionsAccepted().value();
+    quint64 acceptRate = accepted - lastAcceptedCount;
+    lastAcceptedCount = accepted;
+
+    metricsLabel->setText(QString("Soedineniy: %1 | prinyato: %2/s | vkhod: %3 KB | iskhod: %4 KB"
+        " | otpravka p99: %5 mks | avtorizatsiya p99: %6 mks | ochered' loga: %7")
+        .arg(Metrics::connectionsActive().value())
+        .arg(acceptRate)
+        .arg(Metrics::bytesReceived().value() / 1024)
+        .arg(Metrics::bytesSent().value() / 1024)
+        .arg(Metrics::sendLatency().percentile(99.0))
+        .arg(Metrics::authLatency().percentile(99.0))
+        .arg(Metrics::logBacklog().value()));
+}
+
+void ServerMainWindow::applyUserFilter()
+{
+    userProxy->setNicknamePrefix(ui->nicknameFilterEdit->text());
+    userProxy->setBannedFilter(static_cast<ServerUserProxyModel::BannedFilter>(ui->bannedFilterCombo->currentIndex()));
+
+    // Nedopisannaya podset' podsvechivaetsya, a fil'tr ostaetsya prezhnim
+    bool subnetValid = userProxy->setSubnet(ui->subnetFilterEdit->text());
+    ui->subnetFilterEdit->setStyleSheet(subnetValid ? QString() : QString("color: red"));
+}
+
+QString ServerMainWindow::selectedNickname() const
+{
+    QModelIndex current = ui->userListView->currentIndex();
+    if (!current.isValid())
+        return QString();
+    return current.data(ServerUserListModel::NicknameRole).toString();
+}
+
 void ServerMainWindow::showUserInfo()
 {
     if (ui->userListView->selectedIndexes().isEmpty()) {
@@ -56,16 +120,18 @@ void ServerMainWindow::showUserInfo()
 
 void ServerMainWindow::startServer()
 {
-    // Realizatsiya zapuska servera
+    server->startServer(SERVER_PORT);
     logger.log("Server zapushchen administratorem");
+    metricsEndpoint->start(METRICS_PORT);
     ui->startServerButton->setEnabled(false);
     ui->stopServerButton->setEnabled(true);
 }
 
 void ServerMainWindow::stopServer()
 {
-    // Realizatsiya ostanovki servera
+    server->stopServer();
     logger.log("Server ostanovlen administratorem");
+    metricsEndpoint->stop();
     ui->startServerButton->setEnabled(true);
     ui->stopServerButton->setEnabled(false);
 }
@@ -111,16 +177,61 @@ void ServerMainWindow::on_clearLogsButton_clicked()
 
 void ServerMainWindow::banUser()
 {
-    // Realizatsiya bana polzovatelya
+    QString nickname = selectedNickname();
+    if (nickname.isEmpty())
+        return;
+
+    // Zapis' v spisok banov servera; sessii pol'zovatelya otklyuchayutsya
+    if (!server->banUser(nickname))
+        return;
+    userModel->banUser(nickname);
     logger.log("Polzovatel' zabanen administratorem");
 }
 
 void ServerMainWindow::unbanUser()
 {
-    // Realizatsiya razbana polzovatelya
+    QString nickname = selectedNickname();
+    if (nickname.isEmpty())
+        return;
+
+    if (!server->unbanUser(nickname))
+        return;
+    userModel->unbanUser(nickname);
     logger.log("Ban polzovatelya snyat administratorem");
 }
 
+QString ServerMainWindow::askSubnet(const QString& title)
+{
+    return QInputDialog::getText(this, title, "Podset' (10.0.0.0/8, 2001:db8::/32) ili adres:",
+        QLineEdit::Normal, ui->subnetFilterEdit->text()).trimmed();
+}
+
+void ServerMainWindow::banSubnet()
+{
+    QString subnet = askSubnet("Ban podseti");
+    if (subnet.isEmpty())
+        return;
+
+    if (!server->banSubnet(subnet)) {
+        QMessageBox::warning(this, "Oshibka", "Nevernaya podset' ili ona uzhe zabanena");
+        return;
+    }
+    logger.log("Podset' zabanena administratorem");
+}
+
+void ServerMainWindow::unbanSubnet()
+{
+    QString subnet = askSubnet("Snyatie bana podseti");
+    if (subnet.isEmpty())
+        return;
+
+    if (!server->unbanSubnet(subnet)) {
+        QMessageBox::warning(this, "Oshibka", "Podset' ne naydena v spiske banov");
+        return;
+    }
+    logger.log("Ban podseti snyat administratorem");
+}
+
 void ServerMainWindow::kickUser()
 {
     // Realization otklyucheniya polzovatelya
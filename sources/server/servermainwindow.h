@@ -9,8 +9,13 @@
 #include <QSplitter>
 #include <QListWidget>
 #include <QTimer>
+#include <QLabel>
 #include "Logger.h"
 #include "UserInfoDialog.h"
+#include "metricsendpoint.h"
+#include "serveruserlistmodel.h"
+#include "serveruserproxymodel.h"
+#include "servermanager.h"
 
 namespace Ui {
     class ServerMainWindow;
@@ -32,7 +37,11 @@ public slots:
     void clearLogs();
     void banUser();
     void unbanUser();
+    void banSubnet();
+    void unbanSubnet();
     void kickUser();
+    void updateMetrics();
+    void applyUserFilter();
 
 private:
     Ui::ServerMainWindow* ui;
@@ -47,6 +56,18 @@ private:
     QStatusBar* statusBar;
     UserInfoDialog* userInfoDialog;
 
+    // Niknem vybrannogo v spiske pol'zovatelya (pustoy, esli vybora net)
+    QString selectedNickname() const;
+    MetricsEndpoint* metricsEndpoint;
+    QLabel* metricsLabel;
+    ServerUserListModel* userModel;
+    ServerUserProxyModel* userProxy;
+    quint64 lastAcceptedCount;
+    ServerManager* server;
+
+    // Podset' dlya bana: vvod administratora, po umolchaniyu - tekushchiy fil'tr
+    QString askSubnet(const QString& title);
+
 private slots:
     void on_userListView_clicked(const QModelIndex& index);
     void on_actionShow_User_Info_triggered();
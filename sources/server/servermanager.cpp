@@ -1,18 +1,63 @@
 #include "servermanager.h"
 #include "Logger.h"
+#include "ChatProtocol.h"
+#include "MetricsRegistry.h"
+#include "TraceRecorder.h"
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QSslSocket>
 #include <QDebug>
+#include <QDir>
+#include <QFile>
 #include <QThread>
 #include <QMutex>
+#include <algorithm>
 
 ServerManager::ServerManager(QObject* parent) :
     QObject(parent),
-    m_server(new QTcpServer(this)),
-    m_logger(Logger::getInstance())
+    m_server(new ChatTcpServer(this)),
+    m_nextConnectionId(1),
+    m_livenessTimer(new QTimer(this)),
+    m_banWatcher(new QFileSystemWatcher(this)),
+    m_logger(Logger::getInstance()),
+    m_journal(&m_logger, SERVER_JOURNAL_FILE),
+    m_security(&m_logger)
 {
+    // Ochered' ozhidayushchikh razbiraetsya paketom posle vozvrata v tsikl sobytiy
     connect(m_server, &QTcpServer::newConnection,
-        this, &ServerManager::handleNewConnection);
+        this, &ServerManager::handleNewConnection, Qt::QueuedConnection);
+    m_server->setBanList(&m_bans);
+    m_server->setAdmissionController(&m_admission);
+
+    // Spisok sokhranyaetsya cherez pereimenovanie, poetomu nablyudaetsya i katalog
+    connect(m_banWatcher, &QFileSystemWatcher::fileChanged, this, &ServerManager::reloadBans);
+    connect(m_banWatcher, &QFileSystemWatcher::directoryChanged, this, &ServerManager::reloadBans);
+
+    // Sinkhronizatsiya ne zaglyadyvaet glubzhe SYNC_MAX_SCAN: starye segmenty ne nuzhny
+    m_journal.setSegmentLimit(SERVER_JOURNAL_SEGMENTS);
+
+    // Odin taymer na vse soedineniya vmesto QTimer na kazhdyy soket
+    m_liveness.setPingHandler([this](ConnectionId id) {
+        // Bez zapisi v log: pri nagruzke eto stroka na soedinenie za interval
+        static const QByteArray ping = QByteArray(PING_COMMAND) + '\n';
+        sendFrame(m_sockets.value(id), ping);
+    });
+    m_liveness.setReapHandler([this](ConnectionId id) {
+        QTcpSocket* socket = m_sockets.value(id);
+        if (socket) {
+            m_logger.log("Otkljuchen molchashchiy klient: " + socket->peerAddress().toString());
+            socket->abort();
+        }
+    });
+    connect(m_livenessTimer, &QTimer::timeout,
+        this, &ServerManager::checkLiveness);
+
+    // Obuchennyy slovar' neobyazatelen: bez nego bloki szhimayutsya sami po sebe
+    if (COMPRESSION_ENABLED && FrameCodec::isAvailable()) {
+        auto dictionary = std::make_shared<CompressionDictionary>();
+        if (dictionary->loadFile(COMPRESSION_DICTIONARY_FILE))
+            m_dictionary = dictionary;
+    }
 }
 
 ServerManager::~ServerManager()
@@ -25,34 +70,90 @@ void ServerManager::startServer(quint16 port)
     if (m_server->isListening())
         return;
 
+    m_bans.load();
     if (!m_server->listen(QHostAddress::Any, port)) {
         qDebug() << "Ne udalos' zapustit' server: " << m_server->errorString();
         return;
     }
+    QDir().mkpath(DATA_DIR);
+    m_banWatcher->addPath(DATA_DIR);
+    if (QFile::exists(BAN_LIST_FILE))
+        m_banWatcher->addPath(BAN_LIST_FILE);
+
+    // Bez zhurnala soobshcheniya dostavlyayutsya, no bez nomerov i istorii
+    if (!m_journal.open())
+        m_logger.log("Sinkhronizatsiya istorii nedostupna");
 
+    m_livenessTimer->start(LIVENESS_TICK);
     m_logger.log("Server zapushchen na portu " + QString::number(port));
     emit serverStarted(port);
 }
 
+bool ServerManager::enableTls(const QString& certFile, const QString& keyFile)
+{
+    if (!m_server->enableTls(certFile, keyFile)) {
+        m_logger.log("Ne udalos' zagruzit' sertifikat TLS " + certFile + " i klyuch " + keyFile);
+        return false;
+    }
+    m_logger.log("Vklyuchen rezhim TLS");
+    return true;
+}
+
 void ServerManager::stopServer()
 {
     if (!m_server->isListening())
         return;
 
     m_server->close();
+    m_livenessTimer->stop();
+    if (!m_banWatcher->files().isEmpty())
+        m_banWatcher->removePaths(m_banWatcher->files());
+    if (!m_banWatcher->directories().isEmpty())
+        m_banWatcher->removePaths(m_banWatcher->directories());
+    // Rezul'tat proverki vkhodov posle ostanovki nikomu ne dostavlyaetsya
+    if (m_loginThread)
+        m_loginThread->wait();
+    m_loginQueue.clear();
+    m_pendingLogins.clear();
+    for (ConnectionId id : m_sockets.keys()) {
+        m_liveness.remove(id);
+        m_rooms.removeConnection(id);
+        m_routes.unbind(id);
+        m_rateLimiter.removeConnection(id);
+    }
+    m_socketIds.clear();
+    m_sockets.clear();
+    m_encoders.clear();
+    m_syncClients.clear();
+    m_syncJobs.clear();
+    m_outbox.clear();
     qDeleteAll(m_clients);
     m_clients.clear();
+    Metrics::connectionsActive().set(0);
+    m_journal.close();
     m_logger.log("Server ostanovlen");
     emit serverStopped();
 }
 
 void ServerManager::handleNewConnection()
 {
-    QTcpSocket* socket = m_server->nextPendingConnection();
-    if (!socket)
-        return;
+    while (QTcpSocket* socket = m_server->nextPendingConnection())
+        acceptClient(socket);
+}
 
+void ServerManager::acceptClient(QTcpSocket* socket)
+{
+    ConnectionId id = m_nextConnectionId++;
     m_clients.insert(socket);
+    m_socketIds.insert(socket, id);
+    m_sockets.insert(id, socket);
+    m_liveness.add(id);
+    Q_IPV6ADDR peer = socket->peerAddress().toIPv6Address();     // IPv4 - IPv4-mapped
+    BanList::Address address;
+    std::copy(peer.c, peer.c + 16, address.begin());
+    m_rateLimiter.addConnection(id, address);
+    Metrics::connectionsAccepted().add();
+    Metrics::connectionsActive().set(m_clients.size());
     connect(socket, &QTcpSocket::readyRead,
         this, &ServerManager::readClientData);
     connect(socket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::error),
@@ -70,31 +171,532 @@ void ServerManager::readClientData()
     if (!socket)
         return;
 
-    QByteArray data = socket->readAll();
-    QString message = data.constData();
-    m_logger.log("Polucheno ot klienta: " + message);
+    m_liveness.touch(m_socketIds.value(socket));
+    readLines(socket);
+}
+
+void ServerManager::readLines(QTcpSocket* socket)
+{
+    static const QString loginCommand = LOGIN_COMMAND;
+    static const QString resumeCommand = RESUME_COMMAND;
+    ConnectionId id = m_socketIds.value(socket);
+
+    // Soobshcheniya razdeleny simvolom '\n'
+    while (!m_pendingLogins.contains(id) && socket->canReadLine()) {
+        QByteArray line = socket->readLine();
+        Metrics::bytesReceived().add(line.size());
+        while (line.endsWith('\n') || line.endsWith('\r'))
+            line.chop(1);
+        if (line.isEmpty() || line == PONG_COMMAND)
+            continue;
+
+        // Sverkh limita soobshchenie otbrasyvaetsya do dekodirovaniya i razbora
+        if (!m_rateLimiter.allow(id))
+            continue;
+
+        QString message = QString::fromUtf8(line);
+        // Parol' i token ne popadayut ni v log, ni v podpischikov
+        bool credentials = message.startsWith(loginCommand) || message.startsWith(resumeCommand);
+        QString visible = credentials ? message.section(' ', 0, 1) : message;
+        {
+            CHAT_TRACE_SCOPE("ServerManager::readClientData");
+            // Ot chteniya soobshcheniya do zapisi vsem poluchatelyam
+            ScopedLatency latency(Metrics::sendLatency());
+            m_logger.log("Polucheno ot klienta: " + visible);
+            routeMessage(socket, message);
+        }
+        emit messageReceived(socket, visible);
+    }
 
-    emit messageReceived(socket, message);
+    // Klient bez razdeliteley ne dolzhen kopit' bufer bez predela
+    if (socket->bytesAvailable() > MESSAGE_MAX_LENGTH) {
+        m_logger.log("Slishkom dlinnoe soobshenie ot " + socket->peerAddress().toString());
+        socket->abort();
+    }
 }
 
-void ServerManager::sendMessage(QTcpSocket* socket, const QString& message)
+bool ServerManager::routeMessage(QTcpSocket* socket, const QString& message)
+{
+    CHAT_TRACE_SCOPE("ServerManager::routeMessage");
+    static const QString loginCommand = LOGIN_COMMAND;
+    static const QString resumeCommand = RESUME_COMMAND;
+    static const QString logoutCommand = LOGOUT_COMMAND;
+    static const QString joinCommand = ROOM_JOIN_COMMAND;
+    static const QString leaveCommand = ROOM_LEAVE_COMMAND;
+    static const QString compressCommand = COMPRESS_COMMAND;
+    static const QString syncCommand = SYNC_COMMAND;
+
+    ConnectionId id = m_socketIds.value(socket);
+    if (message.startsWith(loginCommand) || message.startsWith(resumeCommand)) {
+        bool resume = message.startsWith(resumeCommand);
+        queueLogin(socket, message.mid(resume ? resumeCommand.size() : loginCommand.size()), resume);
+        return true;
+    }
+    if (message == logoutCommand) {
+        const std::string username = m_routes.getUsername(id);
+        if (!username.empty())
+            m_security.revokeSessionTokens(QString::fromStdString(username));
+        return true;
+    }
+    if (message.startsWith(joinCommand) || message.startsWith(leaveCommand)) {
+        // Komnaty - tol'ko posle vkhoda i tol'ko s imenem vida "#imya"
+        bool join = message.startsWith(joinCommand);
+        std::string room = message.mid(join ? joinCommand.size() : leaveCommand.size()).toStdString();
+        if (m_routes.getUsername(id).empty() || !RoomIndex::isValidName(room)) {
+            m_logger.log("Otklonena komanda komnaty: " + message);
+            return true;
+        }
+        if (join)
+            m_rooms.join(room, id);
+        else
+            m_rooms.leave(room, id);
+        return true;
+    }
+    if (message.startsWith(compressCommand)) {
+        negotiateCompression(socket, message.mid(compressCommand.size()));
+        return true;
+    }
+    if (message.startsWith(syncCommand)) {
+        syncHistory(socket, message.mid(syncCommand.size()));
+        return true;
+    }
+
+    ChatLine line;
+    if (!parseChatLine(message, line))
+        return false;
+
+    // Soobshcheniya - tol'ko posle vkhoda i tol'ko ot imeni svoego pol'zovatelya:
+    // inache chuzhaya stroka popala by v zhurnal i v istoriyu sobesednika
+    const std::string username = m_routes.getUsername(id);
+    if (username.empty() || line.sender.toStdString() != username) {
+        m_logger.log("Otbrosheno soobshchenie bez vkhoda ili s chuzhim otpravitelem: " + message);
+        return true;
+    }
+
+    // Kadr kodiruetsya odin raz dlya vsekh poluchateley; nomer v zhurnale
+    // pozvolyaet klientu posle perepodklyucheniya dokachat' tol'ko propushchennoe
+    Frame frame;
+    frame.text = message.toUtf8();
+    frame.sequence = m_journal.append(frame.text);
+    frame.text.append('\n');
+
+    if (line.recipient == "all") {
+        broadcastFrame(frame);
+        return true;
+    }
+
+    auto deliver = [&](ConnectionId memberId) {
+        if (memberId != id)
+            sendFrame(m_sockets.value(memberId), frame);
+    };
+
+    if (line.recipient.startsWith(ROOM_PREFIX))
+        m_rooms.forEachMember(line.recipient.toStdString(), deliver);
+    else
+        m_routes.forEachConnection(line.recipient.toStdString(), deliver);
+    return true;
+}
+
+void ServerManager::queueLogin(QTcpSocket* socket, const QString& request, bool resume)
+{
+    // "<imya> <parol' ili token>": parol' - ves' ostatok stroki
+    int separator = request.indexOf(' ');
+    LoginRequest login;
+    login.id = m_socketIds.value(socket);
+    login.username = request.left(separator);
+    login.secret = separator > 0 ? request.mid(separator + 1) : QString();
+    login.resume = resume;
+    if (login.username.isEmpty() || login.username.size() > USERNAME_MAX_LENGTH || login.secret.isEmpty()) {
+        m_logger.log("Nevernyy zapros vkhoda ot " + socket->peerAddress().toString());
+        socket->abort();
+        return;
+    }
+    if (m_bans.isUserBanned(login.username.toStdString())) {
+        m_logger.log("Otklonen vkhod zabanennogo pol'zovatelya " + login.username);
+        socket->abort();
+        return;
+    }
+
+    m_pendingLogins.insert(login.id);
+    m_loginQueue.append(login);
+    if (!m_loginScheduled) {
+        m_loginScheduled = true;
+        QMetaObject::invokeMethod(this, "verifyLogins", Qt::QueuedConnection);
+    }
+}
+
+void ServerManager::verifyLogins()
+{
+    m_loginScheduled = false;
+    if (m_loginThread || m_loginQueue.isEmpty())
+        return;
+
+    // Khesh parolya - desyatki millisekund: tsikl sobytiy ego ne zhdet.
+    // Paroli paketa proveryayutsya odnim authenticateUsers(): zapisi PBKDF2
+    // s odinakovoy stoimost'yu schitayutsya po vosem' za prokhod, zapisi
+    // scrypt (po umolchaniyu) - po odnoy, paket dlya nikh nichego ne uskoryaet
+    QVector<LoginRequest> batch = m_loginQueue.mid(0, LOGIN_BATCH_MAX);
+    m_loginQueue.remove(0, batch.size());
+    m_loginThread = QThread::create([this, batch]() {
+        QVector<QPair<QString, QString>> credentials;
+        for (const LoginRequest& login : batch) {
+            if (!login.resume)
+                credentials.append(qMakePair(login.username, login.secret));
+        }
+        QVector<bool> passwords = credentials.isEmpty()
+            ? QVector<bool>() : m_security.authenticateUsers(credentials);
+
+        QVector<QString> tokens;
+        int next = 0;
+        for (const LoginRequest& login : batch) {
+            bool verified = login.resume
+                ? m_security.authenticateToken(login.username, login.secret)
+                : passwords.at(next++);
+            if (!verified)
+                tokens.append(QString());
+            else
+                tokens.append(login.resume ? login.secret : m_security.issueSessionToken(login.username));
+        }
+        QMetaObject::invokeMethod(this, [this, batch, tokens]() {
+            finishLogins(batch, tokens);
+        }, Qt::QueuedConnection);
+    });
+    connect(m_loginThread, &QThread::finished, m_loginThread, &QObject::deleteLater);
+    m_loginThread->start();
+}
+
+void ServerManager::finishLogins(const QVector<LoginRequest>& batch, const QVector<QString>& tokens)
+{
+    CHAT_TRACE_SCOPE("ServerManager::finishLogins");
+    m_loginThread = nullptr;
+    for (int i = 0; i < batch.size(); ++i) {
+        const LoginRequest& login = batch.at(i);
+        m_pendingLogins.remove(login.id);
+        QTcpSocket* socket = m_sockets.value(login.id);
+        if (!socket)
+            continue;       // Otklyuchilsya vo vremya proverki
+
+        // Ban mog poyavit'sya, poka shla proverka
+        if (tokens.at(i).isEmpty() || m_bans.isUserBanned(login.username.toStdString())) {
+            // Otvet uhodit do razryva, a ne so sleduyushchim flushOutbox()
+            m_logger.log("Otklonen vkhod pol'zovatelya " + login.username);
+            sendFrame(socket, QByteArray(LOGIN_DENIED_COMMAND) + '\n');
+            QByteArray pending = m_outbox.take(socket);
+            if (!pending.isEmpty())
+                writeOut(socket, pending);
+            socket->disconnectFromHost();
+            continue;
+        }
+
+        std::string username = login.username.toStdString();
+        m_routes.bind(username, login.id);
+        m_rateLimiter.bindUser(login.id, username);
+        m_server->completeHandshake(socket);
+        sendFrame(socket, QByteArray(SESSION_TOKEN_COMMAND) + tokens.at(i).toUtf8() + '\n');
+
+        // Stroki, prishedshie vo vremya proverki
+        readLines(socket);
+    }
+    verifyLogins();
+}
+
+void ServerManager::negotiateCompression(QTcpSocket* socket, const QString& request)
+{
+    // Zapros "zstd <id slovarya klienta>", otvet "zstd <id obshchego slovarya>"
+    // ili "none"; posle otveta vse kadry servera idut v formate FrameCodec
+    if (m_encoders.contains(socket))
+        return;
+
+    const QStringList parts = request.split(' ', QString::SkipEmptyParts);
+    if (!COMPRESSION_ENABLED || parts.isEmpty() || parts.first() != FrameCodec::algorithm()) {
+        sendFrame(socket, QByteArray(COMPRESS_COMMAND) + "none\n");
+        return;
+    }
+
+    uint clientDictionary = parts.size() > 1 ? parts.at(1).toUInt() : 0;
+    DictionaryPtr dictionary = m_dictionary && m_dictionary->id() == clientDictionary
+        ? m_dictionary : DictionaryPtr();
+    sendFrame(socket, QByteArray(COMPRESS_COMMAND) + FrameCodec::algorithm() + ' '
+        + QByteArray::number(dictionary ? dictionary->id() : 0) + '\n');
+    m_encoders.insert(socket, QSharedPointer<FrameEncoder>::create(dictionary));
+}
+
+void ServerManager::syncHistory(QTcpSocket* socket, const QString& request)
+{
+    CHAT_TRACE_SCOPE("ServerManager::syncHistory");
+    ConnectionId id = m_socketIds.value(socket);
+    // Istoriya - tol'ko pol'zovatelyu, proshedshemu proverku parolya ili tokena
+    const QByteArray user = QByteArray::fromStdString(m_routes.getUsername(id));
+    if (user.isEmpty()) {
+        m_logger.log("Otklonen zapros sinkhronizatsii bez vkhoda");
+        return;
+    }
+
+    // S etogo momenta soobshcheniya idut klientu s nomerami: vse novee head
+    // on poluchit vzhivuyu, dazhe poka chitaetsya zhurnal
+    m_syncClients.insert(socket);
+
+    // "<beseda>=<posledniy nomer> ...": "all", komnata ili sobesednik
+    QSharedPointer<SyncJob> job = QSharedPointer<SyncJob>::create();
+    job->id = id;
+    job->user = user;
+    for (const QString& item : request.split(' ', QString::SkipEmptyParts)) {
+        int separator = item.lastIndexOf('=');
+        if (separator <= 0)
+            continue;
+        QByteArray name = item.left(separator).toUtf8();
+        if (name.startsWith(ROOM_PREFIX) && !m_rooms.isMember(name.toStdString(), id))
+            continue;
+        if (!job->conversations.contains(name))
+            job->order.append(name);
+        job->conversations[name].lastSeen = item.mid(separator + 1).toULongLong();
+    }
+    if (job->conversations.isEmpty())
+        return;
+
+    // Chtenie iz zhurnala s samogo starogo uvidennogo nomera, no ne glubzhe
+    // SYNC_MAX_SCAN: perepodklyuchenie ne vyzyvaet peredachu vsey istorii
+    job->head = m_journal.lastSequence();
+    quint64 after = job->head > SYNC_MAX_SCAN ? job->head - SYNC_MAX_SCAN : 0;
+    quint64 oldest = job->head;
+    for (const SyncConversation& conversation : job->conversations)
+        oldest = qMin(oldest, conversation.lastSeen);
+    job->position = qMax(after, oldest);
+
+    m_syncJobs.append(job);
+    if (!m_syncScheduled) {
+        m_syncScheduled = true;
+        QMetaObject::invokeMethod(this, "continueSync", Qt::QueuedConnection);
+    }
+}
+
+void ServerManager::continueSync()
+{
+    CHAT_TRACE_SCOPE("ServerManager::continueSync");
+    m_syncScheduled = false;
+    if (m_syncJobs.isEmpty())
+        return;
+
+    // Odna portsiya pervogo zaprosa, nezavershennyy uhodit v konets ocheredi
+    QSharedPointer<SyncJob> job = m_syncJobs.takeFirst();
+    QTcpSocket* socket = m_sockets.value(job->id);
+    if (socket) {
+        if (scanSyncJob(*job))
+            finishSyncJob(socket, *job);
+        else
+            m_syncJobs.append(job);
+    }
+
+    if (!m_syncJobs.isEmpty()) {
+        m_syncScheduled = true;
+        QMetaObject::invokeMethod(this, "continueSync", Qt::QueuedConnection);
+    }
+}
+
+bool ServerManager::scanSyncJob(SyncJob& job)
+{
+    int scanned = 0;
+    bool complete = true;
+    m_journal.scan(job.position, [&](quint64 sequence, const QByteArray& record) {
+        if (sequence > job.head)
+            return false;       // Bolee novye klient poluchil vzhivuyu
+        job.position = sequence;
+        bool more = ++scanned < SYNC_SCAN_BATCH;
+        complete = sequence == job.head;
+
+        // Zapis' "otpravitel' -> poluchatel': tekst" razbiraetsya bez dekodirovaniya UTF-8
+        int arrow = record.indexOf(" -> ");
+        int colon = arrow < 0 ? -1 : record.indexOf(": ", arrow + 4);
+        if (colon < 0)
+            return more;
+        QByteArray sender = record.left(arrow);
+        QByteArray name = record.mid(arrow + 4, colon - arrow - 4);
+
+        // Privatnaya beseda nazyvaetsya po sobesedniku
+        if (name != "all" && !name.startsWith(ROOM_PREFIX)) {
+            if (name == job.user)
+                name = sender;
+            else if (sender != job.user)
+                return more;
+        }
+
+        auto it = job.conversations.find(name);
+        if (it == job.conversations.end() || sequence <= it->lastSeen || it->count >= SYNC_MAX_MESSAGES)
+            return more;
+        it->frames += MESSAGE_ID_COMMAND + QByteArray::number(sequence) + ' ' + record + '\n';
+        it->lastSent = sequence;
+        ++job.synced;
+        if (++it->count < SYNC_MAX_MESSAGES)
+            return more;
+        // Vse besedy zapolneny - dal'she chitat' ne nuzhno
+        if (++job.filled == job.conversations.size()) {
+            complete = true;
+            return false;
+        }
+        return more;
+    });
+
+    // Portsiya ischerpana ne na kontse: prodolzhenie v sleduyushchem prokhode
+    return complete || job.position >= job.head || scanned < SYNC_SCAN_BATCH;
+}
+
+void ServerManager::finishSyncJob(QTcpSocket* socket, const SyncJob& job)
+{
+    // Istoriya idet paketami po SYNC_BATCH_BYTES bez ozhidaniya klienta;
+    // v kontse kazhdoy besedy "/synced <beseda> <nomer> more|done":
+    // posle "more" klient zaprashivaet prodolzhenie s poluchennogo nomera
+    QByteArray burst;
+    for (const QByteArray& name : job.order) {
+        const SyncConversation& conversation = job.conversations[name];
+        bool more = conversation.count >= SYNC_MAX_MESSAGES;
+        quint64 position = more ? conversation.lastSent : qMax(conversation.lastSeen, job.head);
+        burst += conversation.frames;
+        burst += SYNCED_COMMAND + name + ' ' + QByteArray::number(position) + (more ? " more\n" : " done\n");
+        if (burst.size() >= SYNC_BATCH_BYTES) {
+            sendBurst(socket, burst);
+            burst.clear();
+        }
+    }
+    sendBurst(socket, burst);
+    Metrics::historySyncedMessages().add(job.synced);
+}
+
+void ServerManager::sendFrame(QTcpSocket* socket, Frame& frame)
 {
     if (!socket || !socket->isWritable())
         return;
 
-    socket->write(message.toUtf8());
+    QSharedPointer<FrameEncoder> encoder = m_encoders.value(socket);
+    bool numbered = frame.sequence != 0 && m_syncClients.contains(socket);
+
+    // Gotovyy variant obshchiy dlya vsekh, krome kodirovshchikov bez obshchego slovarya
+    bool shared = !encoder || encoder->getDictionary() == m_dictionary;
+    QByteArray& cached = frame.variants[(encoder ? 2 : 0) + (numbered ? 1 : 0)];
+    QByteArray bytes = shared ? cached : QByteArray();
+    if (bytes.isEmpty()) {
+        bytes = numbered
+            ? MESSAGE_ID_COMMAND + QByteArray::number(frame.sequence) + ' ' + frame.text
+            : frame.text;
+        if (encoder) {
+            std::string encoded;
+            encoder->encodeBlock(bytes.constData(), static_cast<size_t>(bytes.size()), encoded);
+            bytes = QByteArray(encoded.data(), static_cast<int>(encoded.size()));
+        }
+        if (shared)
+            cached = bytes;
+    }
+
+    if (encoder) {
+        Metrics::compressionInputBytes().add(frame.text.size());
+        Metrics::compressionOutputBytes().add(bytes.size());
+    }
+    writeFrame(socket, bytes);
+}
+
+void ServerManager::sendFrame(QTcpSocket* socket, const QByteArray& text)
+{
+    Frame frame;
+    frame.text = text;
+    sendFrame(socket, frame);
+}
+
+void ServerManager::sendBurst(QTcpSocket* socket, const QByteArray& frames)
+{
+    if (!socket || !socket->isWritable() || frames.isEmpty())
+        return;
+
+    QSharedPointer<FrameEncoder> encoder = m_encoders.value(socket);
+    if (!encoder) {
+        writeFrame(socket, frames);
+        return;
+    }
+
+    std::string encoded;
+    encoder->encodeStream(frames.constData(), static_cast<size_t>(frames.size()), encoded);
+    Metrics::compressionInputBytes().add(frames.size());
+    Metrics::compressionOutputBytes().add(encoded.size());
+    writeFrame(socket, QByteArray(encoded.data(), static_cast<int>(encoded.size())));
+}
+
+void ServerManager::writeFrame(QTcpSocket* socket, const QByteArray& frame)
+{
+    // Kadry soedineniya skleivayutsya do kontsa prokhoda tsikla sobytiy:
+    // rassylka v komnatu ili paket istorii - odna zapis' na soedinenie
+    QByteArray& pending = m_outbox[socket];
+    pending += frame;
+    Metrics::framesQueued().add();
+    if (pending.size() >= WRITE_COALESCE_BYTES) {
+        writeOut(socket, pending);
+        m_outbox.remove(socket);
+        return;
+    }
+
+    if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, "flushOutbox", Qt::QueuedConnection);
+    }
+}
+
+void ServerManager::flushOutbox()
+{
+    CHAT_TRACE_SCOPE("ServerManager::flushOutbox");
+    m_flushScheduled = false;
+    QHash<QTcpSocket*, QByteArray> outbox;
+    outbox.swap(m_outbox);
+    for (auto it = outbox.cbegin(); it != outbox.cend(); ++it) {
+        if (m_clients.contains(it.key()) && it.key()->isWritable())
+            writeOut(it.key(), it.value());
+    }
+}
+
+void ServerManager::writeOut(QTcpSocket* socket, const QByteArray& frame)
+{
+    // V TLS kazhdyy flush() shifruet nakoplennye dannye otdel'noy zapis'yu.
+    // Pervaya zapis' bol'shogo paketa ne dlinnee TLS_RECORD_SIZE: klient
+    // rasshifrovyvaet nachalo, poluchiv odin segment TCP, a ne 16 KB;
+    // ostal'noe idet odnim vyzovom.
+    int offset = 0;
+    QSslSocket* sslSocket = qobject_cast<QSslSocket*>(socket);
+    if (sslSocket && sslSocket->isEncrypted() && frame.size() > TLS_RECORD_SIZE) {
+        socket->write(frame.constData(), TLS_RECORD_SIZE);
+        socket->flush();
+        Metrics::socketWrites().add();
+        offset = TLS_RECORD_SIZE;
+    }
+
+    // Bez flush() zapis' zhdala by uvedomleniya o gotovnosti soketa
+    socket->write(frame.constData() + offset, frame.size() - offset);
     socket->flush();
+    Metrics::socketWrites().add();
+    Metrics::bytesSent().add(frame.size());
+}
+
+void ServerManager::sendMessage(QTcpSocket* socket, const QString& message)
+{
+    if (!socket || !socket->isWritable())
+        return;
+
+    QByteArray frame = message.toUtf8();
+    frame.append('\n');
+    sendFrame(socket, frame);
     m_logger.log("Otpravleno klientu: " + message);
 }
 
 void ServerManager::broadcastMessage(const QString& message)
 {
+    Frame frame;
+    frame.text = message.toUtf8();
+    frame.text.append('\n');
+    broadcastFrame(frame);
+}
+
+void ServerManager::broadcastFrame(Frame& frame)
+{
+    CHAT_TRACE_SCOPE("ServerManager::broadcastMessage");
     QMutexLocker locker(&m_mutex);
-    for (QTcpSocket* socket : m_clients) {
-        if (socket->isWritable())
-            socket->write(message.toUtf8());
-    }
-    m_logger.log("Shirokoveshchatel'noe soobshenie: " + message);
+    for (QTcpSocket* socket : m_clients)
+        sendFrame(socket, frame);
+    m_logger.log("Shirokoveshchatel'noe soobshenie: " + QString::fromUtf8(frame.text.trimmed()));
 }
 
 void ServerManager::socketError(QAbstractSocket::SocketError error)
@@ -113,8 +715,122 @@ void ServerManager::socketDisconnected()
     if (!socket)
         return;
 
+    ConnectionId id = m_socketIds.take(socket);
+    m_sockets.remove(id);
+    m_liveness.remove(id);
+    m_rooms.removeConnection(id);
+    m_routes.unbind(id);
+    m_rateLimiter.removeConnection(id);
+    m_pendingLogins.remove(id);
+    m_encoders.remove(socket);
+    m_syncClients.remove(socket);
+    m_outbox.remove(socket);
     m_clients.remove(socket);
+    Metrics::connectionsActive().set(m_clients.size());
     socket->deleteLater();
     m_logger.log("Klient otkljuchilsja: " + socket->peerAddress().toString());
     emit clientDisconnected(socket);
 }
+
+void ServerManager::checkLiveness()
+{
+    m_liveness.tick();
+    m_rateLimiter.prune();
+
+    // Soedineniya bez vkhoda ne uderzhivayut slot dol'she HANDSHAKE_TIMEOUT
+    for (QTcpSocket* socket : m_server->expiredHandshakes()) {
+        m_logger.log("Istek srok vkhoda: " + socket->peerAddress().toString());
+        socket->abort();
+    }
+}
+
+BanList& ServerManager::banList()
+{
+    return m_bans;
+}
+
+bool ServerManager::banUser(const QString& username)
+{
+    if (!m_bans.banUser(username.toStdString()))
+        return false;
+    // Vkhod po tokenu tozhe zakryt, a ne tol'ko tekushchie sessii
+    m_security.revokeSessionTokens(username);
+    m_logger.log("Zabanen pol'zovatel' " + username);
+    enforceBans();
+    return true;
+}
+
+bool ServerManager::unbanUser(const QString& username)
+{
+    if (!m_bans.unbanUser(username.toStdString()))
+        return false;
+    m_logger.log("Snyat ban pol'zovatelya " + username);
+    return true;
+}
+
+bool ServerManager::banSubnet(const QString& cidr)
+{
+    if (!m_bans.banSubnet(cidr.toStdString()))
+        return false;
+    m_logger.log("Zabanena podset' " + cidr);
+    enforceBans();
+    return true;
+}
+
+bool ServerManager::unbanSubnet(const QString& cidr)
+{
+    if (!m_bans.unbanSubnet(cidr.toStdString()))
+        return false;
+    m_logger.log("Snyat ban podseti " + cidr);
+    return true;
+}
+
+void ServerManager::reloadBans()
+{
+    // Posle pereimenovaniya fayl nablyudaetsya zanovo
+    if (QFile::exists(BAN_LIST_FILE) && !m_banWatcher->files().contains(BAN_LIST_FILE))
+        m_banWatcher->addPath(BAN_LIST_FILE);
+    if (m_bans.load())
+        enforceBans();
+}
+
+void ServerManager::enforceBans()
+{
+    // abort() udalyaet soket iz m_clients cherez socketDisconnected()
+    const QList<QTcpSocket*> clients = m_clients.values();
+    for (QTcpSocket* socket : clients) {
+        std::string username = m_routes.getUsername(m_socketIds.value(socket));
+        Q_IPV6ADDR peer = socket->peerAddress().toIPv6Address();
+        BanList::Address address;
+        std::copy(peer.c, peer.c + 16, address.begin());
+        if ((!username.empty() && m_bans.isUserBanned(username)) || m_bans.isAddressBanned(address)) {
+            m_logger.log("Otklyuchena zabanennaya sessiya " + socket->peerAddress().toString());
+            socket->abort();
+        }
+    }
+}
+
+RateLimiter& ServerManager::rateLimiter()
+{
+    return m_rateLimiter;
+}
+
+AdmissionController& ServerManager::admissionController()
+{
+    return m_admission;
+}
+
+int ServerManager::liveConnectionCount() const
+{
+    return static_cast<int>(m_liveness.getTrackedCount());
+}
+
+int ServerManager::pingedConnectionCount() const
+{
+    return static_cast<int>(m_liveness.getPingedCount());
+}
+
+quint64 ServerManager::reapedConnectionCount() const
+{
+    return m_liveness.getReapedTotal();
+}
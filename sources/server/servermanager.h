@@ -8,7 +8,23 @@
 #include <QSet>
 #include <QMutex>
 #include <QHostAddress>
+#include <QHash>
+#include <QTimer>
+#include <QSharedPointer>
+#include <QThread>
+#include <QVector>
+#include <QFileSystemWatcher>
 #include "Logger.h"
+#include "Security.h"
+#include "FrameCodec.h"
+#include "MessageJournal.h"
+#include "LivenessMonitor.h"
+#include "RoomIndex.h"
+#include "RoutingTable.h"
+#include "BanList.h"
+#include "RateLimiter.h"
+#include "AdmissionController.h"
+#include "chattcpserver.h"
 
 class ServerManager : public QObject
 {
@@ -21,6 +37,30 @@ public:
     void startServer(quint16 port);
     void stopServer();
 
+    // Rezhim TLS, vklyuchaetsya do startServer()
+    bool enableTls(const QString& certFile, const QString& keyFile);
+
+    // Schetchiki zhivykh soedineniy
+    int liveConnectionCount() const;
+    int pingedConnectionCount() const;
+    quint64 reapedConnectionCount() const;
+
+    // Spisok banov, proveryaemyy pri prieme soedineniya i vkhode
+    BanList& banList();
+
+    // Bany administratora: zapis' v spisok banov i otklyuchenie uzhe
+    // podklyuchennykh sessiy pol'zovatelya ili podseti
+    bool banUser(const QString& username);
+    bool unbanUser(const QString& username);
+    bool banSubnet(const QString& cidr);
+    bool unbanSubnet(const QString& cidr);
+
+    // Ogranichenie skorosti soobshcheniy klientov
+    RateLimiter& rateLimiter();
+
+    // Limity soedineniy i priema
+    AdmissionController& admissionController();
+
 signals:
     void serverStarted(quint16 port);
     void serverStopped();
@@ -32,17 +72,119 @@ public slots:
     void sendMessage(QTcpSocket* socket, const QString& message);
     void broadcastMessage(const QString& message);
 
+    // Paket kadrov (naprimer, istoriya) odnim vyzovom: pri szhatii idet
+    // cherez potok zstd soedineniya i szhimaetsya otnositel'no predydushchikh
+    void sendBurst(QTcpSocket* socket, const QByteArray& frames);
+
 private slots:
     void handleNewConnection();
     void readClientData();
     void socketError(QAbstractSocket::SocketError error);
     void socketDisconnected();
+    void checkLiveness();
+
+    // Fayl banov izmenen izvne (naprimer, chat-server -ban-user)
+    void reloadBans();
+
+    // Proverka nakoplennykh zaprosov vkhoda v otdel'nom potoke
+    void verifyLogins();
+
+    // Ocherednaya portsiya chteniya zhurnala dlya zaprosov sinkhronizatsii
+    void continueSync();
+
+    // Zapis' nakoplennykh za prokhod tsikla sobytiy kadrov vsekh soedineniy
+    void flushOutbox();
 
 private:
-    QTcpServer* m_server;
+    // Kadr dlya odnogo ili mnogikh poluchateley. Variant s nomerom soobshcheniya
+    // (dlya klientov s sinkhronizatsiey istorii) i szhatyy variant sozdayutsya
+    // pri pervom obrashchenii i obshchie dlya vsekh poluchateley rassylki
+    struct Frame {
+        QByteArray text;
+        quint64 sequence = 0;           // Nomer v zhurnale servera, 0 - bez nomera
+        QByteArray variants[4];         // [szhatyy * 2 + s nomerom]
+    };
+
+    // Vkhod po parolyu ili tokenu sessii. Zaprosy odnogo prokhoda tsikla
+    // sobytiy proveryayutsya vmeste vne ego; poka reshenie ne prinyato,
+    // sleduyushchie stroki soedineniya ostayutsya v bufere soketa
+    struct LoginRequest {
+        ConnectionId id = 0;
+        QString username;
+        QString secret;                 // Parol' ili token sessii
+        bool resume = false;            // secret - token
+    };
+
+    // Razbor strok soedineniya; ostanavlivaetsya na ozhidayushchem vkhode
+    void readLines(QTcpSocket* socket);
+
+    // Obrabotka komand i adresnaya dostavka, true - soobshchenie obrabotano
+    bool routeMessage(QTcpSocket* socket, const QString& message);
+    void queueLogin(QTcpSocket* socket, const QString& request, bool resume);
+    void finishLogins(const QVector<LoginRequest>& batch, const QVector<QString>& tokens);
+    void acceptClient(QTcpSocket* socket);
+
+    // Otklyuchenie sessiy, popavshikh pod bany pol'zovateley i podsetey
+    void enforceBans();
+    void negotiateCompression(QTcpSocket* socket, const QString& request);
+
+    // Dokachka propushchennogo po poslednim uvidennym nomeram besed. Zhurnal
+    // chitaetsya po SYNC_SCAN_BATCH zapisey za prokhod tsikla sobytiy,
+    // zaprosy raznykh klientov chereduyutsya
+    struct SyncConversation {
+        quint64 lastSeen = 0;
+        quint64 lastSent = 0;
+        int count = 0;
+        QByteArray frames;
+    };
+    struct SyncJob {
+        ConnectionId id = 0;
+        QByteArray user;
+        QList<QByteArray> order;
+        QHash<QByteArray, SyncConversation> conversations;
+        quint64 head = 0;               // Konets zhurnala na moment zaprosa
+        quint64 position = 0;           // Posledniy prochitannyy nomer
+        int filled = 0;                 // Besed, nabravshikh SYNC_MAX_MESSAGES
+        quint64 synced = 0;
+    };
+    void syncHistory(QTcpSocket* socket, const QString& request);
+    bool scanSyncJob(SyncJob& job);
+    void finishSyncJob(QTcpSocket* socket, const SyncJob& job);
+
+    void sendFrame(QTcpSocket* socket, Frame& frame);
+    void sendFrame(QTcpSocket* socket, const QByteArray& text);
+    void broadcastFrame(Frame& frame);
+    void writeFrame(QTcpSocket* socket, const QByteArray& bytes);
+    void writeOut(QTcpSocket* socket, const QByteArray& bytes);
+
+    ChatTcpServer* m_server;
     QSet<QTcpSocket*> m_clients;
+    QHash<QTcpSocket*, ConnectionId> m_socketIds;
+    QHash<ConnectionId, QTcpSocket*> m_sockets;
+    ConnectionId m_nextConnectionId;
+    LivenessMonitor m_liveness;
+    QTimer* m_livenessTimer;
+    RoomIndex m_rooms;
+    RoutingTable m_routes;
+    BanList m_bans;
+    QFileSystemWatcher* m_banWatcher;
+    RateLimiter m_rateLimiter;
+    AdmissionController m_admission;
+    DictionaryPtr m_dictionary;
+    QHash<QTcpSocket*, QSharedPointer<FrameEncoder>> m_encoders;     // Soglasovavshie szhatie
+    QSet<QTcpSocket*> m_syncClients;    // Poluchayut kadry s nomerami soobshcheniy
+    QList<QSharedPointer<SyncJob>> m_syncJobs;  // Nezavershennye zaprosy sinkhronizatsii
+    bool m_syncScheduled = false;
+    QHash<QTcpSocket*, QByteArray> m_outbox;    // Kadry do blizhayshego flushOutbox()
+    bool m_flushScheduled = false;
     QMutex m_mutex;
     Logger m_logger;
+    MessageJournal m_journal;           // Istoriya soobshcheniy dlya sinkhronizatsii
+    SecurityManager m_security;         // Uchetnye zapisi i tokeny sessiy
+    QVector<LoginRequest> m_loginQueue; // Eshche ne otdannye na proverku
+    QSet<ConnectionId> m_pendingLogins; // Soedineniya, zhdushchie resheniya o vkhode
+    QThread* m_loginThread = nullptr;   // Tekushchiy paket proverki
+    bool m_loginScheduled = false;
 };
 
 #endif //  SERVERMANAGER_H
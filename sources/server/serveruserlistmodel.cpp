@@ -1,9 +1,13 @@
 #include "serveruserlistmodel.h"
+#include "config.h"
 #include <QDebug>
 #include <QDateTime>
+#include <algorithm>
+#include <cstring>
 
 ServerUserListModel::ServerUserListModel(QObject* parent)
     : QAbstractListModel(parent)
+    , m_changeTimer(new QTimer(this))
 {
     // Initsializatsiya roley
     m_roleNames[NicknameRole] = "nickname";
@@ -11,6 +15,11 @@ ServerUserListModel::ServerUserListModel(QObject* parent)
     m_roleNames[StatusRole] = "status";
     m_roleNames[ConnectTimeRole] = "connectTime";
     m_roleNames[BannedRole] = "banned";
+
+    // Vse izmeneniya odnogo prokhoda tsikla sobytiy uhodyat vmeste
+    m_changeTimer->setSingleShot(true);
+    m_changeTimer->setInterval(0);
+    connect(m_changeTimer, &QTimer::timeout, this, &ServerUserListModel::flushChanges);
 }
 
 int ServerUserListModel::rowCount(const QModelIndex& parent) const
@@ -22,12 +31,13 @@ int ServerUserListModel::rowCount(const QModelIndex& parent) const
 
 QVariant ServerUserListModel::data(const QModelIndex& index, int role) const
 {
-    if (!index.isValid())
+    if (!index.isValid() || index.row() >= m_users.size() || isRemoved(index.row()))
         return QVariant();
 
     const ServerUser& user = m_users[index.row()];
 
     switch (role) {
+    case Qt::DisplayRole:
     case NicknameRole:
         return user.nickname();
     case IpAddressRole:
@@ -50,33 +60,89 @@ QHash<int, QByteArray> ServerUserListModel::roleNames() const
 
 void ServerUserListModel::addUser(const ServerUser& user)
 {
-    beginInsertRows(QModelIndex(), m_users.size(), m_users.size());
+    if (user.nickname().isEmpty())
+        return;
+
+    // Povtornyy vkhod s tem zhe nikneymom obnovlyaet sushchestvuyushchuyu stroku
+    int row = m_userIndex.value(user.nickname(), -1);
+    if (row != -1) {
+        m_users[row] = user;
+        markChanged(row, -1);
+        emit userAdded(user);
+        return;
+    }
+
+    // Svobodnaya stroka zanimaetsya bez vstavki: dlya proksi eto izmenenie odnoy stroki
+    if (!m_freeRows.isEmpty()) {
+        row = m_freeRows.takeLast();
+        m_users[row] = user;
+        m_userIndex.insert(user.nickname(), row);
+        markChanged(row, -1);
+        emit userAdded(user);
+        return;
+    }
+
+    row = m_users.size();
+    beginInsertRows(QModelIndex(), row, row);
     m_users.append(user);
-    m_userIndexMap[user.nickname()] = m_users.size() - 1;
+    m_userIndex.insert(user.nickname(), row);
     endInsertRows();
     emit userAdded(user);
 }
 
 void ServerUserListModel::removeUser(const QString& nickname)
 {
-    int row = m_userIndexMap.value(nickname, -1);
-    if (row != -1) {
-        beginRemoveRows(QModelIndex(), row, row);
-        m_users.removeAt(row);
-        m_userIndexMap.remove(nickname);
-        endRemoveRows();
-        emit userRemoved(nickname);
+    int row = m_userIndex.value(nickname, -1);
+    if (row == -1)
+        return;
+
+    // Stroka ostaetsya pustoy: ostal'nye ne sdvigayutsya i ne menyayut nomer,
+    // a proksi obrabatyvaet odin dataChanged vmesto polnoy peresortirovki
+    m_users[row] = ServerUser();
+    m_userIndex.remove(nickname);
+    m_freeRows.append(row);
+    markChanged(row, -1);
+    emit userRemoved(nickname);
+}
+
+void ServerUserListModel::compact()
+{
+    // Postoyannye indeksy pustykh strok stanovyatsya nevalidnymi,
+    // ostal'nye sleduyut za svoim pol'zovatelem
+    emit layoutAboutToBeChanged();
+    QVector<int> newRows(m_users.size(), -1);
+    int next = 0;
+    for (int row = 0; row < m_users.size(); ++row) {
+        if (isRemoved(row))
+            continue;
+        if (row != next) {
+            m_users[next] = std::move(m_users[row]);
+            m_userIndex[m_users[next].nickname()] = next;
+        }
+        newRows[row] = next++;
     }
+    m_users.resize(next);
+    m_freeRows.clear();
+
+    const QModelIndexList persistent = persistentIndexList();
+    QModelIndexList moved;
+    moved.reserve(persistent.size());
+    for (const QModelIndex& old : persistent) {
+        int row = newRows.value(old.row(), -1);
+        moved.append(row == -1 ? QModelIndex() : index(row, old.column()));
+    }
+    changePersistentIndexList(persistent, moved);
+    emit layoutChanged();
 }
 
 void ServerUserListModel::updateUserStatus(const QString& nickname, bool status)
 {
-    int row = m_userIndexMap.value(nickname, -1);
+    int row = m_userIndex.value(nickname, -1);
     if (row != -1) {
         ServerUser& user = m_users[row];
         if (user.status() != status) {
             user.setStatus(status);
-            emit dataChanged(index(row), index(row), { StatusRole });
+            markChanged(row, StatusRole);
             emit userStatusChanged(nickname, status);
         }
     }
@@ -84,12 +150,12 @@ void ServerUserListModel::updateUserStatus(const QString& nickname, bool status)
 
 void ServerUserListModel::banUser(const QString& nickname)
 {
-    int row = m_userIndexMap.value(nickname, -1);
+    int row = m_userIndex.value(nickname, -1);
     if (row != -1) {
         ServerUser& user = m_users[row];
         if (!user.isBanned()) {
             user.setBanned(true);
-            emit dataChanged(index(row), index(row), { BannedRole });
+            markChanged(row, BannedRole);
             emit userBanned(nickname);
         }
     }
@@ -97,12 +163,12 @@ void ServerUserListModel::banUser(const QString& nickname)
 
 void ServerUserListModel::unbanUser(const QString& nickname)
 {
-    int row = m_userIndexMap.value(nickname, -1);
+    int row = m_userIndex.value(nickname, -1);
     if (row != -1) {
         ServerUser& user = m_users[row];
         if (user.isBanned()) {
             user.setBanned(false);
-            emit dataChanged(index(row), index(row), { BannedRole });
+            markChanged(row, BannedRole);
             emit userUnbanned(nickname);
         }
     }
@@ -114,22 +180,91 @@ ServerUser ServerUserListModel::user(int row) const {
     return ServerUser();
 }
 
+const ServerUser& ServerUserListModel::userAt(int row) const {
+    return m_users[row];
+}
+
+int ServerUserListModel::rowOf(const QString& nickname) const {
+    return m_userIndex.value(nickname, -1);
+}
+
+bool ServerUserListModel::contains(const QString& nickname) const {
+    return m_userIndex.contains(nickname);
+}
+
+bool ServerUserListModel::isRemoved(int row) const {
+    return m_users[row].nickname().isEmpty();
+}
+
+int ServerUserListModel::userCount() const {
+    return m_userIndex.size();
+}
+
+void ServerUserListModel::markChanged(int row, int role)
+{
+    m_changedRows.insert(row);
+
+    // role -1 - izmenilas' vsya stroka
+    if (role == -1)
+        m_changedRoles = { NicknameRole, IpAddressRole, StatusRole, ConnectTimeRole, BannedRole, Qt::DisplayRole };
+    else if (!m_changedRoles.contains(role))
+        m_changedRoles.append(role);
+
+    if (!m_changeTimer->isActive())
+        m_changeTimer->start();
+}
+
+void ServerUserListModel::flushChanges()
+{
+    m_changeTimer->stop();
+    if (m_changedRows.isEmpty())
+        return;
+
+    // Stroki, udalennye posle otmetki, propuskayutsya
+    QVector<int> rows;
+    rows.reserve(m_changedRows.size());
+    for (int row : m_changedRows) {
+        if (row < m_users.size())
+            rows.append(row);
+    }
+    std::sort(rows.begin(), rows.end());
+
+    QVector<int> roles = m_changedRoles;
+    m_changedRows.clear();
+    m_changedRoles.clear();
+
+    // Odin signal na kazhdyy nepreryvnyy diapazon
+    int first = 0;
+    for (int i = 1; i <= rows.size(); ++i) {
+        if (i == rows.size() || rows[i] != rows[i - 1] + 1) {
+            emit dataChanged(index(rows[first]), index(rows[i - 1]), roles);
+            first = i;
+        }
+    }
+
+    // Proksi uzhe skryl pustye stroki; uplotnenie - posle otpravki izmeneniy
+    if (m_freeRows.size() >= USER_LIST_COMPACT_MIN && m_freeRows.size() * 4 > m_users.size())
+        compact();
+}
+
 // Realizatsiya klassa ServerUser
 
 ServerUser::ServerUser()
-    : m_connectTime(QDateTime::currentDateTime())
-    , m_status(false)
+    : m_status(false)
+    , m_connectTime(QDateTime::currentDateTime())
     , m_banned(false)
 {
+    parseAddress();
 }
 
 ServerUser::ServerUser(const QString& nickname, const QString& ipAddress)
     : m_nickname(nickname)
     , m_ipAddress(ipAddress)
-    , m_connectTime(QDateTime::currentDateTime())
     , m_status(true)
+    , m_connectTime(QDateTime::currentDateTime())
     , m_banned(false)
 {
+    parseAddress();
 }
 
 QString ServerUser::nickname() const {
@@ -146,6 +281,29 @@ QString ServerUser::ipAddress() const {
 
 void ServerUser::setIpAddress(const QString& ipAddress) {
     m_ipAddress = ipAddress;
+    parseAddress();
+}
+
+const QHostAddress& ServerUser::address() const {
+    return m_address;
+}
+
+int ServerUser::compareAddress(const ServerUser& other) const {
+    bool valid = !m_address.isNull();
+    bool otherValid = !other.m_address.isNull();
+    if (valid && otherValid) {
+        int order = std::memcmp(m_addressKey.c, other.m_addressKey.c, sizeof(m_addressKey.c));
+        return order < 0 ? -1 : (order > 0 ? 1 : 0);
+    }
+    if (valid != otherValid)
+        return valid ? -1 : 1;
+    int order = QString::compare(m_ipAddress, other.m_ipAddress);
+    return order < 0 ? -1 : (order > 0 ? 1 : 0);
+}
+
+void ServerUser::parseAddress() {
+    m_address = QHostAddress(m_ipAddress);
+    m_addressKey = m_address.toIPv6Address();      // IPv4 - IPv4-mapped
 }
 
 bool ServerUser::status() const {
@@ -187,6 +345,7 @@ QDataStream& operator>>(QDataStream& in, ServerUser& user) {
         >> user.m_status
         >> user.m_connectTime
         >> user.m_banned;
+    user.parseAddress();
     return in;
 }
 
@@ -1,14 +1,71 @@
 #pragma once
 
 #include <QAbstractListModel>
-#include <QList>
+#include <QVector>
 #include <QVariant>
-#include <QMap>
+#include <QHash>
+#include <QSet>
 #include <QString>
 #include <QDateTime>
+#include <QDataStream>
+#include <QTimer>
+#include <QHostAddress>
 
-class ServerUser;
+class ServerUser {
+public:
+    ServerUser();
+    ServerUser(const QString& nickname, const QString& ipAddress);
+
+    QString nickname() const;
+    void setNickname(const QString& nickname);
+
+    QString ipAddress() const;
+    void setIpAddress(const QString& ipAddress);
+
+    // Adres, razobrannyy odin raz pri sokhranenii: dlya fil'tra po podseti
+    // i sortirovki bez razbora stroki pri kazhdom sravnenii
+    const QHostAddress& address() const;
+    // -1/0/1; IPv4 sravnivaetsya kak IPv4-mapped, nerazobrannye adresa - v kontse
+    int compareAddress(const ServerUser& other) const;
+
+    bool status() const;
+    void setStatus(bool status);
+
+    QDateTime connectTime() const;
+    void setConnectTime(const QDateTime& time);
+
+    bool isBanned() const;
+    void setBanned(bool banned);
+
+    QString toString() const;
+    bool operator==(const ServerUser& other) const;
+    bool operator!=(const ServerUser& other) const;
+
+    friend QDataStream& operator<<(QDataStream& out, const ServerUser& user);
+    friend QDataStream& operator>>(QDataStream& in, ServerUser& user);
+
+private:
+    void parseAddress();
+
+    QString m_nickname;
+    QString m_ipAddress;
+    QHostAddress m_address;
+    Q_IPV6ADDR m_addressKey;            // Bayty adresa v setevom poryadke
+    bool m_status;
+    QDateTime m_connectTime;
+    bool m_banned;
+};
 
+// Spisok podklyuchennykh pol'zovateley dlya administratora.
+// Stroki khranyatsya massivom s indeksom QHash po nikneymu; udalenie
+// ostavlyaet na meste stroki pustuyu zapis' (O(1), soobshchaetsya kak
+// dataChanged odnoy stroki, proksi ee skryvaet), a novyy pol'zovatel'
+// zanimaet svobodnuyu stroku. Poryadok strok ne sokhranyaetsya - sortirovka
+// delaetsya proksi. Kogda pustykh strok bol'she chetverti (i ne men'she
+// USER_LIST_COMPACT_MIN), massiv uplotnyaetsya odnim izmeneniem raskladki,
+// chto v srednem daet O(1) signalov na udalenie.
+// Izmeneniya dannykh nakaplivayutsya i soobshchayutsya predstavleniyam
+// odnim dataChanged na nepreryvnyy diapazon strok za prokhod tsikla sobytiy.
 class ServerUserListModel : public QAbstractListModel
 {
     Q_OBJECT
@@ -37,6 +94,18 @@ public:
     void unbanUser(const QString& nickname);
 
     ServerUser user(int row) const;
+    // Bez kopirovaniya, dlya proksi; row dolzhen byt' v diapazone
+    const ServerUser& userAt(int row) const;
+    int rowOf(const QString& nickname) const;
+    bool contains(const QString& nickname) const;
+
+    // Pustaya stroka udalennogo pol'zovatelya, proksi ee ne pokazyvaet
+    bool isRemoved(int row) const;
+    int userCount() const;
+
+public slots:
+    // Nemedlennaya otpravka nakoplennykh dataChanged
+    void flushChanges();
 
 signals:
     void userAdded(const ServerUser& user);
@@ -46,36 +115,20 @@ signals:
     void userUnbanned(const QString& nickname);
 
 private:
-    QList<ServerUser> m_users;
-    QMap<QString, int> m_userIndexMap;
-};
+    // Otmetka izmenennoy stroki; dataChanged ukhodit v flushChanges
+    void markChanged(int row, int role);
 
-class ServerUser {
-public:
-    ServerUser();
-    ServerUser(const QString& nickname, const QString& ipAddress);
+    // Udalenie pustykh strok odnim izmeneniem raskladki
+    void compact();
 
-    QString nickname() const;
-    void setNickname(const QString& nickname);
+    QVector<ServerUser> m_users;            // Pustoy niknem - udalennaya stroka
+    QHash<QString, int> m_userIndex;        // Niknem -> stroka
+    QVector<int> m_freeRows;                // Pustye stroki dlya povtornogo ispol'zovaniya
+    QHash<int, QByteArray> m_roleNames;
 
-    QString ipAddress() const;
-    void setIpAddress(const QString& ipAddress);
-
-    bool status() const;
-    void setStatus(bool status);
-
-    QDateTime connectTime() const;
-    void setConnectTime(const QDateTime& time);
-
-    bool isBanned() const;
-    void setBanned(bool banned);
-
-private:
-    QString m_nickname;
-    QString m_ipAddress;
-    bool m_status;
-    QDateTime m_connectTime;
-    bool m_banned;
+    QSet<int> m_changedRows;
+    QVector<int> m_changedRoles;
+    QTimer* m_changeTimer;
 };
 
 QDataStream& operator<<(QDataStream& out, const ServerUser& user);
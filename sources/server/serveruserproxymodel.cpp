@@ -0,0 +1,161 @@
+#include "serveruserproxymodel.h"
+#include "serveruserlistmodel.h"
+
+ServerUserProxyModel::ServerUserProxyModel(QObject* parent)
+    : QSortFilterProxyModel(parent)
+    , m_users(nullptr)
+    , m_hasSubnet(false)
+    , m_bannedFilter(AnyBanState)
+    , m_sortKey(SortByNickname)
+{
+    setDynamicSortFilter(true);
+    setSortCaseSensitivity(Qt::CaseInsensitive);
+    sort(0, Qt::AscendingOrder);
+}
+
+void ServerUserProxyModel::setSourceModel(QAbstractItemModel* sourceModel)
+{
+    m_users = qobject_cast<ServerUserListModel*>(sourceModel);
+    QSortFilterProxyModel::setSourceModel(sourceModel);
+}
+
+void ServerUserProxyModel::setNicknamePrefix(const QString& prefix)
+{
+    if (prefix == m_nicknamePrefix)
+        return;
+    m_nicknamePrefix = prefix;
+    invalidateFilter();
+}
+
+QString ServerUserProxyModel::nicknamePrefix() const
+{
+    return m_nicknamePrefix;
+}
+
+bool ServerUserProxyModel::setSubnet(const QString& subnet)
+{
+    QString text = subnet.trimmed();
+    if (text == m_subnetText)
+        return true;
+
+    if (text.isEmpty()) {
+        m_hasSubnet = false;
+    }
+    else {
+        // Adres bez maski - podset' iz odnogo adresa
+        QPair<QHostAddress, int> parsed = QHostAddress::parseSubnet(text.contains('/') ? text
+            : text + (text.contains(':') ? "/128" : "/32"));
+        if (parsed.first.isNull())
+            return false;
+        m_subnet = parsed;
+        m_hasSubnet = true;
+    }
+    m_subnetText = text;
+    invalidateFilter();
+    return true;
+}
+
+QString ServerUserProxyModel::subnet() const
+{
+    return m_subnetText;
+}
+
+void ServerUserProxyModel::setBannedFilter(BannedFilter filter)
+{
+    if (filter == m_bannedFilter)
+        return;
+    m_bannedFilter = filter;
+    invalidateFilter();
+}
+
+ServerUserProxyModel::BannedFilter ServerUserProxyModel::bannedFilter() const
+{
+    return m_bannedFilter;
+}
+
+void ServerUserProxyModel::setConnectTimeRange(const QDateTime& from, const QDateTime& to)
+{
+    m_connectedFrom = from;
+    m_connectedTo = to;
+    invalidateFilter();
+}
+
+void ServerUserProxyModel::setSortKey(SortKey key)
+{
+    if (key == m_sortKey)
+        return;
+    m_sortKey = key;
+    invalidate();
+}
+
+ServerUserProxyModel::SortKey ServerUserProxyModel::sortKey() const
+{
+    return m_sortKey;
+}
+
+const ServerUser& ServerUserProxyModel::sourceUser(int sourceRow) const
+{
+    return m_users->userAt(sourceRow);
+}
+
+bool ServerUserProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const
+{
+    if (!m_users || sourceParent.isValid())
+        return QSortFilterProxyModel::filterAcceptsRow(sourceRow, sourceParent);
+
+    // Stroki udalennykh pol'zovateley zhdut uplotneniya modeli
+    if (m_users->isRemoved(sourceRow))
+        return false;
+
+    const ServerUser& user = sourceUser(sourceRow);
+
+    if (!m_nicknamePrefix.isEmpty() &&
+        !user.nickname().startsWith(m_nicknamePrefix, Qt::CaseInsensitive))
+        return false;
+
+    if (m_bannedFilter == BannedOnly && !user.isBanned())
+        return false;
+    if (m_bannedFilter == NotBannedOnly && user.isBanned())
+        return false;
+
+    if (m_connectedFrom.isValid() && user.connectTime() < m_connectedFrom)
+        return false;
+    if (m_connectedTo.isValid() && user.connectTime() > m_connectedTo)
+        return false;
+
+    // Adres razobran pri sokhranenii pol'zovatelya
+    if (m_hasSubnet && !user.address().isInSubnet(m_subnet))
+        return false;
+
+    return true;
+}
+
+bool ServerUserProxyModel::lessThan(const QModelIndex& left, const QModelIndex& right) const
+{
+    if (!m_users)
+        return QSortFilterProxyModel::lessThan(left, right);
+
+    const ServerUser& a = sourceUser(left.row());
+    const ServerUser& b = sourceUser(right.row());
+
+    int order = 0;
+    switch (m_sortKey) {
+    case SortByIpAddress:
+        // Sravnenie zaranee razobrannykh baytov adresa, bez razbora strok
+        order = a.compareAddress(b);
+        break;
+    case SortByConnectTime:
+        order = a.connectTime() < b.connectTime() ? -1 : (b.connectTime() < a.connectTime() ? 1 : 0);
+        break;
+    case SortByBanned:
+        order = int(a.isBanned()) - int(b.isBanned());
+        break;
+    case SortByNickname:
+        break;
+    }
+
+    // Ravnye klyuchi uporyadochivayutsya po nikneymu dlya ustoychivosti
+    if (order == 0)
+        order = QString::compare(a.nickname(), b.nickname(), sortCaseSensitivity());
+    return order < 0;
+}
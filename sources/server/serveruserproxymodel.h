@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QSortFilterProxyModel>
+#include <QHostAddress>
+#include <QDateTime>
+#include <QString>
+#include <QPair>
+
+class ServerUser;
+class ServerUserListModel;
+
+// Sortirovka i fil'tratsiya spiska pol'zovateley dlya administratora.
+// Dinamicheskaya sortirovka QSortFilterProxyModel vstavlyaet novye i
+// izmenennye stroki binarnym poiskom, bez polnoy peresortirovki;
+// polnyy prokhod nuzhen tol'ko pri smene kriteriev fil'tra ili sortirovki.
+class ServerUserProxyModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    enum SortKey {
+        SortByNickname,
+        SortByIpAddress,
+        SortByConnectTime,
+        SortByBanned
+    };
+
+    enum BannedFilter {
+        AnyBanState,
+        BannedOnly,
+        NotBannedOnly
+    };
+
+    explicit ServerUserProxyModel(QObject* parent = nullptr);
+
+    void setSourceModel(QAbstractItemModel* sourceModel) override;
+
+    // Kriterii fil'tra; pustoe znachenie otklyuchaet kriteriy
+    void setNicknamePrefix(const QString& prefix);
+    QString nicknamePrefix() const;
+
+    // Podset' v vide "10.0.0.0/8" ili "2001:db8::/32"; false - oshibka razbora
+    bool setSubnet(const QString& subnet);
+    QString subnet() const;
+
+    void setBannedFilter(BannedFilter filter);
+    BannedFilter bannedFilter() const;
+
+    // Interval vremeni podklyucheniya; nevalidnaya granitsa ne proveryaetsya
+    void setConnectTimeRange(const QDateTime& from, const QDateTime& to);
+
+    void setSortKey(SortKey key);
+    SortKey sortKey() const;
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
+    bool lessThan(const QModelIndex& left, const QModelIndex& right) const override;
+
+private:
+    const ServerUser& sourceUser(int sourceRow) const;
+
+    ServerUserListModel* m_users;
+    QString m_nicknamePrefix;
+    QString m_subnetText;
+    QPair<QHostAddress, int> m_subnet;
+    bool m_hasSubnet;
+    BannedFilter m_bannedFilter;
+    QDateTime m_connectedFrom;
+    QDateTime m_connectedTo;
+    SortKey m_sortKey;
+};
@@ -0,0 +1,543 @@
+#include "MessageJournal.h"
+#include <QtEndian>
+#include <QDir>
+#include <QFileInfo>
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Tablitsa CRC32 (polinom 0xEDB88320)
+quint32 crc32(const char* data, int size) {
+    static const std::array<quint32, 256> table = [] {
+        std::array<quint32, 256> t{};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (int i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<uchar>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// Sinkhronizatsiya dannykh fayla bez metadannykh, gde eto vozmozhno
+bool syncData(int fd) {
+#ifdef Q_OS_WIN
+    return FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(fd))) != 0;
+#elif defined(Q_OS_MACOS)
+    return fsync(fd) == 0;
+#else
+    return fdatasync(fd) == 0;
+#endif
+}
+
+// Obkhod zapisey partii v pamyati: nomer, smeshchenie zagolovka i dannye
+template <typename Handler>
+void forEachRecord(const QByteArray& batch, Handler handler) {
+    int offset = 0;
+    while (batch.size() - offset >= MessageJournal::RECORD_HEADER_SIZE) {
+        const char* header = batch.constData() + offset;
+        quint32 size = qFromLittleEndian<quint32>(header);
+        quint64 sequence = qFromLittleEndian<quint64>(header + 8);
+        handler(sequence, offset, header + MessageJournal::RECORD_HEADER_SIZE, size);
+        offset += MessageJournal::RECORD_HEADER_SIZE + static_cast<int>(size);
+    }
+}
+
+} // namespace
+
+// Konstruktor
+MessageJournal::MessageJournal(Logger* log, const QString& path, int windowMs)
+    : logger(log)
+    , fileName(path)
+    , nextSequence(1)
+    , pendingSequence(0)
+    , durableSequence(0)
+    , commitWindowMs(windowMs)
+    , isRunning(false)
+    , isFailed(false)
+    , segmentLimit(0)
+{
+}
+
+// Destruktor
+MessageJournal::~MessageJournal() {
+    close();
+}
+
+QString MessageJournal::segmentPath(quint64 firstSequence) const {
+    // Nomer s vedushchimi nulyami: imena segmentov sortiruyutsya kak nomera
+    return fileName + '.' + QString::number(firstSequence).rightJustified(20, '0');
+}
+
+std::vector<quint64> MessageJournal::findSegments() {
+    QFileInfo info(fileName);
+    QDir dir = info.absoluteDir();
+
+    // Zhurnal odnim faylom (do segmentov) stanovitsya pervym segmentom
+    if (QFile::exists(fileName)) {
+        QFile legacy(fileName);
+        char header[RECORD_HEADER_SIZE];
+        quint64 first = 1;
+        if (legacy.open(QIODevice::ReadOnly) && legacy.read(header, RECORD_HEADER_SIZE) == RECORD_HEADER_SIZE) {
+            first = qMax<quint64>(1, qFromLittleEndian<quint64>(header + 8));
+        }
+        legacy.close();
+        if (!QFile::rename(fileName, segmentPath(first))) {
+            logger->log("Oshibka preobrazovaniya zhurnala v segment: " + fileName.toStdString());
+        }
+    }
+
+    std::vector<quint64> found;
+    const QString prefix = info.fileName() + '.';
+    for (const QString& name : dir.entryList(QStringList(prefix + '*'), QDir::Files)) {
+        bool ok = false;
+        quint64 first = name.mid(prefix.size()).toULongLong(&ok);
+        if (ok && first > 0) {
+            found.push_back(first);
+        }
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+bool MessageJournal::open() {
+    // Prodolzhaem numeratsiyu posle uzhe zapisannykh zapisey
+    bool loaded;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        loaded = !segments.empty();
+    }
+    if (!loaded) {
+        replay(nullptr);
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (isRunning) {
+        return true;
+    }
+
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    if (segments.empty()) {
+        Segment segment;
+        segment.firstSequence = nextSequence;
+        segments.push_back(segment);
+    }
+
+    file.setFileName(segmentPath(segments.back().firstSequence));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered)) {
+        logger->log("Oshibka otkrytiya zhurnala soobshcheniy");
+        return false;
+    }
+
+    isRunning = true;
+    isFailed = false;
+    commitThread = std::thread(&MessageJournal::commitLoop, this);
+    logger->log("Zhurnal soobshcheniy otkryt: " + fileName.toStdString());
+    return true;
+}
+
+void MessageJournal::close() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!isRunning) {
+            return;
+        }
+        isRunning = false;
+    }
+    pendingCondition.notify_all();
+
+    // Potok kommita dopisyvaet ostavshuyusya partiyu pered vykhodom
+    if (commitThread.joinable()) {
+        commitThread.join();
+    }
+    file.close();
+    durableCondition.notify_all();
+}
+
+quint64 MessageJournal::append(const QByteArray& payload) {
+    std::lock_guard<std::mutex> lock(mtx);
+    return appendLocked(payload);
+}
+
+quint64 MessageJournal::appendAsync(const QByteArray& payload, std::function<void(bool)> done) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        quint64 sequence = appendLocked(payload);
+        if (sequence != 0) {
+            completions.emplace_back(sequence, std::move(done));
+            return sequence;
+        }
+    }
+    done(false);
+    return 0;
+}
+
+quint64 MessageJournal::appendLocked(const QByteArray& payload) {
+    char header[RECORD_HEADER_SIZE];
+    if (!isRunning || isFailed) {
+        return 0;
+    }
+
+    quint64 sequence = nextSequence++;
+    qToLittleEndian<quint32>(static_cast<quint32>(payload.size()), header);
+    qToLittleEndian<quint32>(crc32(payload.constData(), payload.size()), header + 4);
+    qToLittleEndian<quint64>(sequence, header + 8);
+
+    pendingBatch.append(header, RECORD_HEADER_SIZE);
+    pendingBatch.append(payload);
+    pendingSequence = sequence;
+
+    // Budim potok kommita tol'ko dlya pervoy zapisi v partii
+    if (pendingBatch.size() == RECORD_HEADER_SIZE + payload.size()) {
+        pendingCondition.notify_one();
+    }
+    return sequence;
+}
+
+bool MessageJournal::waitDurable(quint64 sequence) {
+    if (sequence == 0) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mtx);
+    durableCondition.wait(lock, [&] {
+        return durableSequence >= sequence || isFailed || !isRunning;
+    });
+    return durableSequence >= sequence;
+}
+
+bool MessageJournal::appendDurable(const QString& message) {
+    return waitDurable(append(message.toUtf8()));
+}
+
+void MessageJournal::commitLoop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        pendingCondition.wait(lock, [&] {
+            return !pendingBatch.isEmpty() || !isRunning;
+        });
+        if (pendingBatch.isEmpty() && !isRunning) {
+            break;
+        }
+
+        // Daem drugim potokam dobavit' zapisi v tu zhe partiyu
+        int window = commitWindowMs.load(std::memory_order_relaxed);
+        if (window > 0 && isRunning) {
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::milliseconds(window));
+            lock.lock();
+        }
+
+        // Partiya v zapisi ostaetsya vidimoy dlya scan() do sinkhronizatsii;
+        // menyaetsya ona tol'ko etim potokom i pod mtx
+        committingBatch.swap(pendingBatch);
+        quint64 batchSequence = pendingSequence;
+        lock.unlock();
+
+        bool ok = writeBatch(committingBatch);
+
+        lock.lock();
+        if (ok) {
+            indexBatch(committingBatch);
+            durableSequence = batchSequence;
+        }
+        else {
+            isFailed = true;
+        }
+        committingBatch.clear();
+        durableCondition.notify_all();
+
+        // Obrabotchiki appendAsync vyzyvayutsya bez mtx: oni mogut snova pisat' v zhurnal
+        std::vector<std::function<void(bool)>> done;
+        while (!completions.empty() && (isFailed || completions.front().first <= durableSequence)) {
+            done.push_back(std::move(completions.front().second));
+            completions.pop_front();
+        }
+        if (!done.empty()) {
+            lock.unlock();
+            for (const auto& callback : done) {
+                callback(ok);
+            }
+            lock.lock();
+        }
+
+        // Sleduyushchaya partiya nachnetsya v novom segmente
+        if (ok && segments.back().size >= JOURNAL_SEGMENT_SIZE) {
+            quint64 first = durableSequence + 1;
+            lock.unlock();
+            ok = rotateSegment(first);
+            lock.lock();
+            if (!ok) {
+                isFailed = true;
+            }
+        }
+        if (isFailed) {
+            break;
+        }
+    }
+}
+
+bool MessageJournal::rotateSegment(quint64 firstSequence) {
+    // Fayl segmenta menyaet tol'ko potok kommita; scan() vidit novyy
+    // segment tol'ko posle dobavleniya v spisok pod mtx
+    file.close();
+    file.setFileName(segmentPath(firstSequence));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered)) {
+        logger->log("Oshibka sozdaniya segmenta zhurnala soobshcheniy");
+        return false;
+    }
+
+    std::vector<quint64> expired;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        Segment segment;
+        segment.firstSequence = firstSequence;
+        segments.push_back(segment);
+        while (segmentLimit > 0 && segments.size() > static_cast<size_t>(segmentLimit)) {
+            expired.push_back(segments.front().firstSequence);
+            segments.erase(segments.begin());
+        }
+    }
+    for (quint64 first : expired) {
+        QFile::remove(segmentPath(first));
+    }
+    return true;
+}
+
+bool MessageJournal::writeBatch(const QByteArray& batch) {
+    if (file.write(batch) != batch.size()) {
+        logger->log("Oshibka zapisi v zhurnal soobshcheniy");
+        return false;
+    }
+    if (!syncData(file.handle())) {
+        logger->log("Oshibka sinkhronizatsii zhurnala soobshcheniy");
+        return false;
+    }
+    return true;
+}
+
+void MessageJournal::indexBatch(const QByteArray& batch) {
+    Segment& segment = segments.back();
+    forEachRecord(batch, [&](quint64 sequence, int offset, const char*, quint32) {
+        if (segment.records++ % JOURNAL_INDEX_INTERVAL == 0) {
+            segment.index.emplace_back(sequence, segment.size + offset);
+        }
+    });
+    segment.size += batch.size();
+}
+
+quint64 MessageJournal::replay(const std::function<void(quint64, const QByteArray&)>& handler) {
+    // Sostoyanie (indeks, numeratsiya) vosstanavlivaetsya tol'ko pri pervom
+    // chtenii, do open(); povtornyy vyzov lish' peredaet zapisi handler
+    bool restore;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        restore = segments.empty();
+    }
+
+    std::vector<Segment> found;
+    quint64 lastSequence = 0;
+    quint64 count = 0;
+    char header[RECORD_HEADER_SIZE];
+
+    for (quint64 first : findSegments()) {
+        QFile input(segmentPath(first));
+        if (!input.open(QIODevice::ReadOnly)) {
+            logger->log("Oshibka chteniya zhurnala soobshcheniy");
+            continue;
+        }
+
+        Segment segment;
+        segment.firstSequence = first;
+        const qint64 available = input.size();
+        QByteArray payload;
+        while (input.read(header, RECORD_HEADER_SIZE) == RECORD_HEADER_SIZE) {
+            quint32 size = qFromLittleEndian<quint32>(header);
+            quint32 checksum = qFromLittleEndian<quint32>(header + 4);
+            quint64 sequence = qFromLittleEndian<quint64>(header + 8);
+
+            if (available - segment.size - RECORD_HEADER_SIZE < size) {
+                break;
+            }
+            payload = input.read(size);
+            if (payload.size() != static_cast<int>(size) ||
+                crc32(payload.constData(), payload.size()) != checksum || sequence <= lastSequence) {
+                break;
+            }
+
+            if (handler) {
+                handler(sequence, payload);
+            }
+            if (segment.records++ % JOURNAL_INDEX_INTERVAL == 0) {
+                segment.index.emplace_back(sequence, segment.size);
+            }
+            lastSequence = sequence;
+            segment.size += RECORD_HEADER_SIZE + size;
+            ++count;
+        }
+        input.close();
+
+        // Nepolnaya zapis' v kontse - sled prervannogo kommita
+        if (restore && segment.size < available) {
+            logger->log("Zhurnal soobshcheniy obrezan posle povrezhdennoy zapisi");
+            QFile::resize(segmentPath(first), segment.size);
+        }
+        found.push_back(std::move(segment));
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (restore && segments.empty()) {
+        segments.swap(found);
+        if (lastSequence >= nextSequence) {
+            nextSequence = lastSequence + 1;
+            durableSequence = lastSequence;
+        }
+    }
+    return count;
+}
+
+quint64 MessageJournal::scan(quint64 afterSequence, const std::function<bool(quint64, const QByteArray&)>& handler) const {
+    // Fayly segmentov dlya chteniya: s blizhayshey tochki indeksa v pervom
+    struct Range {
+        quint64 firstSequence;
+        qint64 offset;
+        qint64 end;
+    };
+
+    quint64 next = afterSequence + 1;
+    quint64 count = 0;
+
+    while (true) {
+        quint64 durable;
+        std::vector<Range> ranges;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            durable = durableSequence;
+            // Pervyy segment, gde mozhet byt' zapis' next; udalennye propuskayutsya
+            auto segment = std::upper_bound(segments.begin(), segments.end(), next,
+                [](quint64 sequence, const Segment& entry) {
+                    return sequence < entry.firstSequence;
+                });
+            if (segment != segments.begin()) {
+                --segment;
+            }
+            for (; segment != segments.end(); ++segment) {
+                qint64 offset = 0;
+                auto it = std::upper_bound(segment->index.begin(), segment->index.end(), next,
+                    [](quint64 sequence, const std::pair<quint64, qint64>& entry) {
+                        return sequence < entry.first;
+                    });
+                if (it != segment->index.begin()) {
+                    offset = std::prev(it)->second;
+                }
+                if (segment->size > offset) {
+                    ranges.push_back(Range{ segment->firstSequence, offset, segment->size });
+                }
+            }
+        }
+
+        // Sinkhronizirovannyye zapisi chitayutsya iz faylov
+        if (next <= durable) {
+            char header[RECORD_HEADER_SIZE];
+            for (const Range& range : ranges) {
+                QFile input(segmentPath(range.firstSequence));
+                if (!input.open(QIODevice::ReadOnly)) {
+                    continue;       // Udalen pri smene segmenta
+                }
+                input.seek(range.offset);
+
+                bool stop = false;
+                while (input.pos() < range.end && input.read(header, RECORD_HEADER_SIZE) == RECORD_HEADER_SIZE) {
+                    quint32 size = qFromLittleEndian<quint32>(header);
+                    quint64 sequence = qFromLittleEndian<quint64>(header + 8);
+                    if (sequence > durable) {
+                        stop = true;
+                        break;
+                    }
+                    if (sequence < next) {
+                        input.seek(input.pos() + size);
+                        continue;
+                    }
+
+                    QByteArray payload = input.read(size);
+                    if (payload.size() != static_cast<int>(size)) {
+                        break;
+                    }
+                    ++count;
+                    if (!handler(sequence, payload)) {
+                        return count;
+                    }
+                }
+                if (stop) {
+                    break;
+                }
+            }
+            next = durable + 1;
+        }
+
+        // Ostal'noye - v partiyakh v pamyati; esli za vremya chteniya partiya
+        // uspela sinkhronizirovat'sya, ee nuzhno dochitat' iz fayla
+        std::vector<std::pair<quint64, QByteArray>> records;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (durableSequence != durable) {
+                continue;
+            }
+            auto collect = [&](quint64 sequence, int, const char* payload, quint32 size) {
+                if (sequence >= next) {
+                    records.emplace_back(sequence, QByteArray(payload, static_cast<int>(size)));
+                }
+            };
+            forEachRecord(committingBatch, collect);
+            forEachRecord(pendingBatch, collect);
+        }
+
+        for (const auto& record : records) {
+            ++count;
+            if (!handler(record.first, record.second)) {
+                break;
+            }
+        }
+        return count;
+    }
+}
+
+void MessageJournal::setCommitWindow(int windowMs) {
+    commitWindowMs.store(windowMs, std::memory_order_relaxed);
+}
+
+int MessageJournal::commitWindow() const {
+    return commitWindowMs.load(std::memory_order_relaxed);
+}
+
+void MessageJournal::setSegmentLimit(int count) {
+    std::lock_guard<std::mutex> lock(mtx);
+    segmentLimit = qMax(0, count);
+}
+
+quint64 MessageJournal::lastDurableSequence() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return durableSequence;
+}
+
+quint64 MessageJournal::lastSequence() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return nextSequence - 1;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "config.h"
+#include "Logger.h"
+
+// Zhurnal predvaritel'noy zapisi (WAL) dlya prinyatykh soobshcheniy.
+// Zapisi nakaplivayutsya v techenie okna kommita i sbrasyvayutsya na disk
+// odnim write() + fdatasync(), posle chego vse ozhidayushchiye poluchayut
+// podtverzhdeniye. Razrezhennyy indeks nomerov pozvolyaet chitat' khvost
+// zhurnala s nuzhnoy zapisi, ne razbiraya fayl s nachala.
+// Zhurnal delitsya na segmenty "<fileName>.<nomer pervoy zapisi>" po
+// JOURNAL_SEGMENT_SIZE: zapis' idet v posledniy, starye mozhno udalyat'.
+class MessageJournal {
+private:
+    // Segment: fayl s zapisyami nachinaya s firstSequence
+    struct Segment {
+        quint64 firstSequence = 0;
+        qint64 size = 0;                // Konets posledney sinkhronizirovannoy partii
+        quint64 records = 0;            // Zapisey uchteno v indekse
+        // Nomer zapisi -> smeshchenie v fayle, kazhdye JOURNAL_INDEX_INTERVAL zapisey
+        std::vector<std::pair<quint64, qint64>> index;
+    };
+
+    Logger* logger;
+    QString fileName;
+    QFile file;                         // Tekushchiy (posledniy) segment
+
+    std::thread commitThread;
+    mutable std::mutex mtx;
+    std::condition_variable pendingCondition;   // Est' novyye zapisi
+    std::condition_variable durableCondition;   // Partiya sinkhronizirovana
+
+    QByteArray pendingBatch;            // Zapisi, ozhidayushchiye kommita
+    QByteArray committingBatch;         // Partiya, zapisyvaemaya potokom kommita
+    std::deque<std::pair<quint64, std::function<void(bool)>>> completions;  // Ozhidayut kommita
+    quint64 nextSequence;               // Nomer sleduyushchey zapisi
+    quint64 pendingSequence;            // Posledniy nomer v pendingBatch
+    quint64 durableSequence;            // Posledniy sinkhronizirovannyy nomer
+    std::atomic<int> commitWindowMs;    // Okno gruppovogo kommita
+    bool isRunning;
+    bool isFailed;
+
+    std::vector<Segment> segments;      // Po vozrastaniyu nomerov, posledniy - tekushchiy
+    int segmentLimit;                   // Segmentov na diske, 0 - bez udaleniya
+
+    // Potok gruppovogo kommita
+    void commitLoop();
+
+    // Perekhod na novyy segment posle zapolneniya tekushchego (potok kommita)
+    bool rotateSegment(quint64 firstSequence);
+
+    // Fayl segmenta i poisk segmentov na diske po vozrastaniyu nomerov
+    QString segmentPath(quint64 firstSequence) const;
+    std::vector<quint64> findSegments();
+
+    // Dobavleniye zapisi v tekushchuyu partiyu (pod mtx)
+    quint64 appendLocked(const QByteArray& payload);
+
+    // Dobavleniye zapisey sinkhronizirovannoy partii v indeks (pod mtx)
+    void indexBatch(const QByteArray& batch);
+
+    // Zapis' partii i sinkhronizatsiya fayla
+    bool writeBatch(const QByteArray& batch);
+
+public:
+    // Razmer zagolovka zapisi: dlina, CRC32, nomer
+    static const int RECORD_HEADER_SIZE = 16;
+
+    explicit MessageJournal(Logger* log,
+        const QString& path = JOURNAL_FILE,
+        int windowMs = JOURNAL_COMMIT_WINDOW);
+    ~MessageJournal();
+
+    // Otkrytiye zhurnala i zapusk potoka kommita
+    bool open();
+    void close();
+
+    // Dobavleniye zapisi, vozvrashchaet ee nomer (0 - oshibka)
+    quint64 append(const QByteArray& payload);
+
+    // Ozhidaniye, poka zapis' s ukazannym nomerom ne budet na diske
+    bool waitDurable(quint64 sequence);
+
+    // Dobavleniye zapisi s ozhidaniyem podtverzhdeniya
+    bool appendDurable(const QString& message);
+
+    // Dobavleniye bez ozhidaniya: done vyzyvaetsya iz potoka kommita posle
+    // sinkhronizatsii partii (true) ili pri oshibke zapisi (false), v poryadke nomerov
+    quint64 appendAsync(const QByteArray& payload, std::function<void(bool)> done);
+
+    // Vosstanovleniye zapisey posle sboya; povrezhdennyy khvost obrezaetsya.
+    // Segmenty chitayutsya potokom, bez zagruzki fayla v pamyat' tselikom
+    quint64 replay(const std::function<void(quint64, const QByteArray&)>& handler);
+
+    // Chteniye zapisey s nomerami posle afterSequence po vozrastaniyu, vklyuchaya
+    // eshche ne sinkhronizirovannyye; handler vozvrashchaet false dlya ostanovki
+    quint64 scan(quint64 afterSequence, const std::function<bool(quint64, const QByteArray&)>& handler) const;
+
+    void setCommitWindow(int windowMs);
+    int commitWindow() const;
+
+    // Skol'ko segmentov khranit' (0 - vse); lishnie udalyayutsya pri smene segmenta
+    void setSegmentLimit(int count);
+    quint64 lastDurableSequence() const;
+    quint64 lastSequence() const;
+};
@@ -0,0 +1,284 @@
+// test_message_journal.cpp : Proverka zhurnala predvaritel'noy zapisi (WAL).
+// Sobiraetsya s JOURNAL_SEGMENT_SIZE 4096 i JOURNAL_INDEX_INTERVAL 16.
+
+#include <QDir>
+#include <QFile>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MessageJournal.h"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* what)
+{
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        ++failures;
+    }
+}
+
+const QString JOURNAL_DIR = "test_message_journal_data";
+const QString JOURNAL_PATH = JOURNAL_DIR + "/messages.wal";
+
+void resetJournalDir()
+{
+    QDir(JOURNAL_DIR).removeRecursively();
+}
+
+// Zapis' s nomerom v tekste: soderzhimoe proveryaetsya pri chtenii
+QByteArray payload(quint64 sequence)
+{
+    std::string text = "soobshchenie " + std::to_string(sequence) + std::string(24, '.');
+    return QByteArray(text.c_str(), static_cast<int>(text.size()));
+}
+
+// Dobavlenie zapisey po odnoy s ozhidaniem diska: kazhdaya - otdel'naya partiya
+quint64 appendRecords(MessageJournal& journal, int count)
+{
+    quint64 last = 0;
+    for (int i = 0; i < count; ++i) {
+        last = journal.append(payload(journal.lastSequence() + 1));
+        journal.waitDurable(last);
+    }
+    return last;
+}
+
+// Vse zapisi posle afterSequence idut podryad i s vernym soderzhimym
+bool scanContiguous(const MessageJournal& journal, quint64 afterSequence, quint64 lastSequence)
+{
+    quint64 expected = afterSequence + 1;
+    bool ok = true;
+    journal.scan(afterSequence, [&](quint64 sequence, const QByteArray& record) {
+        ok = ok && sequence == expected && record == payload(sequence);
+        ++expected;
+        return true;
+    });
+    return ok && expected == lastSequence + 1;
+}
+
+QStringList segmentFiles()
+{
+    return QDir(JOURNAL_DIR).entryList(QStringList("messages.wal.*"), QDir::Files);
+}
+
+QString segmentPath(quint64 firstSequence)
+{
+    return JOURNAL_PATH + '.' + QString::number(firstSequence).rightJustified(20, '0');
+}
+
+// Prervannyy kommit: nepolnaya i isporchennaya zapisi v khvoste otbrasyvayutsya
+void tornTailTruncatedOnReplay(Logger* log)
+{
+    resetJournalDir();
+    qint64 intactSize = 0;
+    {
+        MessageJournal journal(log, JOURNAL_PATH, 0);
+        check(journal.open(), "zhurnal otkryt");
+        check(appendRecords(journal, 10) == 10, "zapisano 10");
+        journal.close();
+        intactSize = QFile(segmentPath(1)).size();
+    }
+
+    // Zagolovok zapisi 11 obeshchaet 100 bayt, na disk popalo 5
+    {
+        QFile segment(segmentPath(1));
+        check(segment.open(QIODevice::WriteOnly | QIODevice::Append), "segment otkryt na zapis'");
+        QByteArray torn(MessageJournal::RECORD_HEADER_SIZE, '\0');
+        torn[0] = 100;
+        torn[8] = 11;
+        torn.append("obryv", 5);
+        segment.write(torn);
+    }
+    {
+        MessageJournal journal(log, JOURNAL_PATH, 0);
+        check(journal.replay(nullptr) == 10, "posle obryva vosstanovleno 10");
+        check(QFile(segmentPath(1)).size() == intactSize, "nepolnaya zapis' obrezana");
+        check(journal.open(), "zhurnal otkryt posle obryva");
+        check(journal.lastSequence() == 10, "numeratsiya prodolzhaetsya s 10");
+        check(appendRecords(journal, 1) == 11, "novaya zapis' poluchila nomer 11");
+        check(scanContiguous(journal, 0, 11), "zapisi 1..11 chitayutsya podryad");
+        journal.close();
+    }
+
+    // Isporchennyy bayt dannykh posledney zapisi: ne skhoditsya CRC
+    {
+        QFile segment(segmentPath(1));
+        check(segment.open(QIODevice::ReadWrite), "segment otkryt na izmenenie");
+        segment.seek(segment.size() - 1);
+        segment.write(QByteArray("#"));
+    }
+    {
+        MessageJournal journal(log, JOURNAL_PATH, 0);
+        check(journal.open(), "zhurnal otkryt posle porchi");
+        check(journal.lastSequence() == 10, "zapis' s nevernoy CRC otbroshena");
+        check(QFile(segmentPath(1)).size() == intactSize, "isporchennaya zapis' obrezana");
+        check(scanContiguous(journal, 0, 10), "zapisi 1..10 tsely");
+    }
+}
+
+// Smena segmentov po razmeru i udalenie lishnikh po setSegmentLimit
+void segmentRotationAndDeletion(Logger* log)
+{
+    resetJournalDir();
+    MessageJournal journal(log, JOURNAL_PATH, 0);
+    check(journal.open(), "zhurnal otkryt");
+
+    quint64 last = appendRecords(journal, 400);
+    const int segments = segmentFiles().size();
+    check(segments > 3, "zapisi razlozheny po neskol'kim segmentam");
+    check(QFile::exists(segmentPath(1)), "pervyy segment nachinaetsya s zapisi 1");
+    check(scanContiguous(journal, 0, last), "chtenie cherez granitsy segmentov");
+
+    // Lishnie segmenty udalyayutsya pri sleduyushchey smene segmenta
+    journal.setSegmentLimit(3);
+    last = appendRecords(journal, 150);
+    check(segmentFiles().size() == 3, "na diske ostalos' 3 segmenta");
+    check(!QFile::exists(segmentPath(1)), "staryy segment udalen");
+
+    quint64 first = 0;
+    journal.scan(0, [&](quint64 sequence, const QByteArray&) {
+        if (first == 0)
+            first = sequence;
+        return true;
+    });
+    check(first > 1, "udalennye zapisi ne chitayutsya");
+    check(first > 1 && scanContiguous(journal, first - 1, last), "ostavshiesya zapisi chitayutsya podryad");
+    journal.close();
+
+    // Posle perezapuska vidny tol'ko ostavshiesya segmenty
+    MessageJournal reopened(log, JOURNAL_PATH, 0);
+    check(reopened.open(), "zhurnal otkryt povtorno");
+    check(reopened.lastSequence() == last, "numeratsiya vosstanovlena");
+    check(first > 1 && scanContiguous(reopened, first - 1, last), "zapisi posle perezapuska");
+}
+
+// Posle perezapuska scan nachinaet chtenie s tochki indeksa, a ne s nachala segmenta
+void indexSeekAfterReopen(Logger* log)
+{
+    resetJournalDir();
+    quint64 last = 0;
+    {
+        MessageJournal journal(log, JOURNAL_PATH, 0);
+        check(journal.open(), "zhurnal otkryt");
+        last = appendRecords(journal, 60);
+        check(segmentFiles().size() == 1, "60 zapisey v odnom segmente");
+    }
+
+    MessageJournal journal(log, JOURNAL_PATH, 0);
+    check(journal.open(), "zhurnal otkryt povtorno");
+    check(journal.lastSequence() == last, "numeratsiya vosstanovlena");
+
+    // Dlina zapisi 1 portitsya uzhe posle vosstanovleniya indeksa: chtenie
+    // s nachala segmenta pereskakivaet za ego konets i teryaet vse zapisi,
+    // a s tochki indeksa (zapis' 33 pri intervale 16) - ne zatragivaet ikh
+    {
+        QFile segment(segmentPath(1));
+        check(segment.open(QIODevice::ReadWrite), "segment otkryt na izmenenie");
+        segment.seek(3);
+        segment.write(QByteArray("\x7f", 1));
+    }
+
+    check(scanContiguous(journal, 39, last), "scan s 40 ispol'zuet indeks");
+    check(scanContiguous(journal, 32, last), "scan s tochki indeksa 33");
+    check(journal.scan(0, [](quint64, const QByteArray&) { return true; }) == 0,
+        "chtenie s nachala segmenta vidit porchu");
+}
+
+// Obrabotchiki appendAsync vyzyvayutsya v poryadke nomerov, v tom chisle
+// pri dobavlenii iz neskol'kikh potokov i iz samogo obrabotchika
+void appendAsyncCompletionOrder(Logger* log)
+{
+    resetJournalDir();
+    MessageJournal journal(log, JOURNAL_PATH, 2);
+    check(journal.open(), "zhurnal otkryt");
+
+    const int threads = 4;
+    const int perThread = 200;
+    const size_t total = threads * perThread + 1;
+
+    // Obrabotchik mozhet srabotat' do vozvrata iz appendAsync, poetomu
+    // zapominaetsya soderzhimoe zapisi, a nomer nakhoditsya po nemu potom
+    std::mutex mtx;
+    std::condition_variable finished;
+    std::vector<std::string> completed;
+    bool allSucceeded = true;
+    auto completion = [&](const std::string& text) {
+        return [&, text](bool ok) {
+            std::lock_guard<std::mutex> lock(mtx);
+            allSucceeded = allSucceeded && ok;
+            completed.push_back(text);
+            finished.notify_all();
+        };
+    };
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; ++t) {
+        writers.emplace_back([&, t]() {
+            for (int i = 0; i < perThread; ++i) {
+                std::string text = "potok " + std::to_string(t) + " zapis' " + std::to_string(i);
+                std::function<void(bool)> done = completion(text);
+                if (t == 0 && i == 0) {
+                    // Povtornaya zapis' iz obrabotchika (potok kommita)
+                    done = [&, done](bool ok) {
+                        done(ok);
+                        journal.appendAsync(QByteArray("iz obrabotchika"), completion("iz obrabotchika"));
+                    };
+                }
+                journal.appendAsync(QByteArray(text.c_str(), static_cast<int>(text.size())), done);
+            }
+        });
+    }
+    for (std::thread& writer : writers)
+        writer.join();
+
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        check(finished.wait_for(lock, std::chrono::seconds(10), [&]() { return completed.size() == total; }),
+            "vse obrabotchiki vyzvany");
+    }
+    journal.close();
+
+    std::vector<std::pair<std::string, quint64>> sequences;
+    journal.scan(0, [&](quint64 sequence, const QByteArray& record) {
+        sequences.emplace_back(std::string(record.constData(), record.size()), sequence);
+        return true;
+    });
+    check(sequences.size() == total, "vse zapisi v zhurnale");
+
+    std::lock_guard<std::mutex> lock(mtx);
+    check(allSucceeded, "vse zapisi podtverzhdeny");
+    quint64 previous = 0;
+    bool ordered = completed.size() == total;
+    for (const std::string& text : completed) {
+        auto it = std::find_if(sequences.begin(), sequences.end(),
+            [&](const std::pair<std::string, quint64>& entry) { return entry.first == text; });
+        ordered = ordered && it != sequences.end() && it->second > previous;
+        if (it != sequences.end())
+            previous = it->second;
+    }
+    check(ordered, "obrabotchiki vyzvany v poryadke nomerov");
+}
+
+} // namespace
+
+int main()
+{
+    Logger log;
+    tornTailTruncatedOnReplay(&log);
+    segmentRotationAndDeletion(&log);
+    indexSeekAfterReopen(&log);
+    appendAsyncCompletionOrder(&log);
+    resetJournalDir();
+    if (failures == 0)
+        std::printf("test_message_journal: OK\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+// test_password_hash.cpp : Proverka SHA-256, PBKDF2 i scrypt.
+// Yadra mnogobufernogo SHA-256 sravnivayutsya s obychnym Sha256::compress,
+// funktsii vyvoda klyucha - s kontrol'nymi vektorami RFC 7914.
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "PasswordHasher.h"
+#include "Sha256.h"
+#include "Sha256MultiBuffer.h"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* what)
+{
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        ++failures;
+    }
+}
+
+std::string toHex(const uint8_t* data, size_t size)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < size; ++i) {
+        hex += digits[data[i] >> 4];
+        hex += digits[data[i] & 15];
+    }
+    return hex;
+}
+
+// SHA-256 ot "abc" (FIPS 180-4, prilozhenie B.1)
+void sha256KnownAnswer()
+{
+    Sha256::Digest digest = Sha256::hash(std::string("abc"));
+    check(toHex(digest.data(), digest.size())
+            == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+        "SHA-256(\"abc\")");
+}
+
+// Vybrannoe yadro (AVX2, esli est') i perenosimoe dayut to zhe, chto Sha256::compress
+void multiBufferKernels()
+{
+    std::mt19937 random(7914);
+    for (int round = 0; round < 64; ++round) {
+        uint32_t state[8][Sha256MultiBuffer::LANES];
+        uint32_t block[16][Sha256MultiBuffer::LANES];
+        for (size_t lane = 0; lane < Sha256MultiBuffer::LANES; ++lane) {
+            for (int i = 0; i < 8; ++i)
+                state[i][lane] = round == 0 ? Sha256::INITIAL_STATE[i] : random();
+            for (int t = 0; t < 16; ++t)
+                block[t][lane] = random();
+        }
+
+        uint32_t selected[8][Sha256MultiBuffer::LANES];
+        uint32_t portable[8][Sha256MultiBuffer::LANES];
+        std::memcpy(selected, state, sizeof(selected));
+        std::memcpy(portable, state, sizeof(portable));
+        Sha256MultiBuffer::compress(selected, block);
+        Sha256MultiBuffer::compressPortable(portable, block);
+
+        bool same = std::memcmp(selected, portable, sizeof(selected)) == 0;
+        bool scalar = true;
+        for (size_t lane = 0; lane < Sha256MultiBuffer::LANES; ++lane) {
+            uint32_t expected[8];
+            uint8_t bytes[Sha256::BLOCK_SIZE];
+            for (int i = 0; i < 8; ++i)
+                expected[i] = state[i][lane];
+            for (int t = 0; t < 16; ++t) {
+                bytes[4 * t] = static_cast<uint8_t>(block[t][lane] >> 24);
+                bytes[4 * t + 1] = static_cast<uint8_t>(block[t][lane] >> 16);
+                bytes[4 * t + 2] = static_cast<uint8_t>(block[t][lane] >> 8);
+                bytes[4 * t + 3] = static_cast<uint8_t>(block[t][lane]);
+            }
+            Sha256::compress(expected, bytes);
+            for (int i = 0; i < 8; ++i)
+                scalar = scalar && expected[i] == portable[i][lane];
+        }
+        check(same, "vybrannoe yadro sovpadaet s perenosimym");
+        check(scalar, "perenosimoe yadro sovpadaet s Sha256::compress");
+    }
+}
+
+// PBKDF2-HMAC-SHA256 i scrypt: vektory RFC 7914, razdely 11 i 12
+void rfc7914Vectors()
+{
+    uint8_t output[64];
+
+    PasswordHasher::pbkdf2Sha256("passwd", "salt", 1, output, sizeof(output));
+    check(toHex(output, sizeof(output)) ==
+            "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc"
+            "49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783",
+        "PBKDF2(passwd, salt, 1)");
+
+    PasswordHasher::pbkdf2Sha256("Password", "NaCl", 80000, output, sizeof(output));
+    check(toHex(output, sizeof(output)) ==
+            "4ddcd8f60b98be21830cee5ef22701f9641a4418d04c0414aeff08876b34ab56"
+            "a1d425a1225833549adb841b51c9b3176a272bdebba1d078478f62b397f33c8d",
+        "PBKDF2(Password, NaCl, 80000)");
+
+    check(PasswordHasher::scrypt("", "", 16, 1, 1, output, sizeof(output)) &&
+            toHex(output, sizeof(output)) ==
+                "77d6576238657b203b19ca42c18a0497f16b4844e3074ae8dfdffa3fede2144"
+                "2fcd0069ded0948f8326a753a0fc81f17e8d3e0fb2e0d3628cf35e20c38d18906",
+        "scrypt(\"\", \"\", 16, 1, 1)");
+
+    check(PasswordHasher::scrypt("password", "NaCl", 1024, 8, 16, output, sizeof(output)) &&
+            toHex(output, sizeof(output)) ==
+                "fdbabe1c9d3472007856e7190d01e9fe7c6ad7cbc8237830e77376634b373162"
+                "2eaf30d92e22a3886ff109279d9830dac727afb94a83ee6d8360cbdfa2cc0640",
+        "scrypt(password, NaCl, 1024, 8, 16)");
+}
+
+// Mnogobufernyy PBKDF2 po polosam raven obychnomu, v tom chisle pri nepolnom pakete
+void multiBufferPbkdf2()
+{
+    std::vector<std::string> passwords;
+    std::vector<std::string> salts;
+    for (size_t lane = 0; lane < Sha256MultiBuffer::LANES; ++lane) {
+        passwords.push_back("parol' " + std::to_string(lane) + std::string(lane * 9, 'x'));
+        salts.push_back("sol' " + std::to_string(lane));
+    }
+    passwords[0] = "Password";
+    salts[0] = "NaCl";
+
+    for (size_t count : { Sha256MultiBuffer::LANES, size_t(3) }) {
+        uint8_t outputs[Sha256MultiBuffer::LANES * Sha256MultiBuffer::DIGEST_SIZE];
+        Sha256MultiBuffer::pbkdf2Sha256(passwords.data(), salts.data(), count, 80000, outputs);
+
+        bool same = true;
+        for (size_t lane = 0; lane < count; ++lane) {
+            uint8_t expected[Sha256MultiBuffer::DIGEST_SIZE];
+            PasswordHasher::pbkdf2Sha256(passwords[lane], salts[lane], 80000, expected, sizeof(expected));
+            same = same && std::memcmp(expected, outputs + lane * sizeof(expected), sizeof(expected)) == 0;
+        }
+        check(same, "mnogobufernyy PBKDF2 sovpadaet s obychnym");
+        check(toHex(outputs, 32) == "4ddcd8f60b98be21830cee5ef22701f9641a4418d04c0414aeff08876b34ab56",
+            "polosa 0: vektor RFC 7914");
+    }
+}
+
+// Paketnaya proverka daet te zhe otvety, chto proverka po odnoy
+void batchMatchesSequential()
+{
+    PasswordHasher::Params pbkdf2 = PasswordHasher::defaultParams();
+    pbkdf2.algorithm = PasswordHasher::PBKDF2_SHA256;
+    pbkdf2.iterations = 1000;
+    PasswordHasher::Params scrypt = PasswordHasher::defaultParams();
+    scrypt.algorithm = PasswordHasher::SCRYPT;
+    scrypt.scryptN = 1024;
+    scrypt.scryptR = 1;
+    scrypt.scryptP = 1;
+
+    PasswordHasher hasher(pbkdf2);
+    std::vector<std::string> records;
+    std::vector<std::string> passwords;
+    for (int i = 0; i < 11; ++i) {
+        std::string password = "user" + std::to_string(i);
+        const PasswordHasher::Params& params = i % 4 == 3 ? scrypt : pbkdf2;
+        records.push_back(hasher.hash(password, "salt" + std::to_string(i), params));
+        passwords.push_back(i % 3 == 1 ? password + "!" : password);
+    }
+
+    std::vector<bool> batch = hasher.verifyBatch(records, passwords);
+    bool same = batch.size() == records.size();
+    for (size_t i = 0; same && i < records.size(); ++i)
+        same = batch[i] == hasher.verify(records[i], passwords[i]) && batch[i] == (i % 3 != 1);
+    check(same, "paketnaya proverka sovpadaet s posledovatel'noy");
+}
+
+} // namespace
+
+int main()
+{
+    sha256KnownAnswer();
+    multiBufferKernels();
+    rfc7914Vectors();
+    multiBufferPbkdf2();
+    batchMatchesSequential();
+    if (failures == 0)
+        std::printf("test_password_hash: OK (%s)\n", Sha256MultiBuffer::kernelName());
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+// test_sync_cursor.cpp : Proverka kursora sinkhronizatsii istorii klienta.
+
+#include <cstdio>
+#include "SyncCursor.h"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* what)
+{
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        ++failures;
+    }
+}
+
+// Zhivye kadry posredi sinkhronizatsii ne sdvigayut kursor cherez propusk
+void liveTrafficDuringSync()
+{
+    SyncCursor cursor;
+    cursor.beginSync("all");
+    check(cursor.position("all") == 0, "zapros nachinaetsya s nulya");
+
+    // Pervaya stranitsa: 1..3, zatem zhivoy kadr 10, zatem "/synced all 3 more"
+    check(cursor.accept("all", 1), "stranitsa 1");
+    check(cursor.accept("all", 2), "stranitsa 2");
+    check(cursor.accept("all", 3), "stranitsa 3");
+    check(cursor.accept("all", 10), "zhivoy kadr 10");
+    check(cursor.finishPage("all", 3, true), "nuzhna sleduyushchaya stranitsa");
+    check(cursor.position("all") == 3, "prodolzhenie s 3, a ne s 10");
+
+    // Prodolzhenie: 4..10; 10 uzhe polucheno vzhivuyu
+    for (uint64_t id = 4; id < 10; ++id)
+        check(cursor.accept("all", id), "prodolzhenie 4..9");
+    check(!cursor.accept("all", 10), "povtor 10 otbroshen");
+    check(cursor.accept("all", 11), "zhivoy kadr 11");
+    check(!cursor.finishPage("all", 10, false), "sinkhronizatsiya zavershena");
+    check(!cursor.isSyncing("all"), "bez aktivnoy sinkhronizatsii");
+    check(cursor.position("all") == 11, "kursor na poslednem zhivom kadre");
+
+    // Posle "done" zhivye kadry dvigayut kursor srazu
+    check(cursor.accept("all", 12), "zhivoy kadr 12");
+    check(cursor.position("all") == 12, "kursor 12");
+    check(!cursor.accept("all", 5), "staryy kadr otbroshen");
+}
+
+// Razryv soedineniya: do "done" zhivye kadry ne schitayutsya nepreryvnymi
+void interruptedConnection()
+{
+    SyncCursor cursor;
+    check(cursor.accept("#room", 5), "zhivoy kadr 5");
+    check(cursor.position("#room") == 5, "kursor 5");
+
+    cursor.interrupt();
+    check(cursor.accept("#room", 20), "kadr 20 posle perepodklyucheniya");
+    check(cursor.position("#room") == 5, "kursor ne pereskakivaet propusk 6..19");
+
+    cursor.beginSync("#room");
+    check(!cursor.accept("#room", 20), "povtor 20 otbroshen");
+    check(cursor.accept("#room", 7), "propushchennyy 7");
+    check(!cursor.finishPage("#room", 19, false), "zaversheno");
+    check(cursor.position("#room") == 20, "kursor 20");
+}
+
+} // namespace
+
+int main()
+{
+    liveTrafficDuringSync();
+    interruptedConnection();
+    if (failures == 0)
+        std::printf("test_sync_cursor: OK\n");
+    return failures == 0 ? 0 : 1;
+}
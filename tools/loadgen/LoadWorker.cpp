@@ -0,0 +1,244 @@
+#include "LoadWorker.h"
+#include <QSslSocket>
+#include <chrono>
+#include "config.h"
+#include "ChatProtocol.h"
+
+namespace {
+
+// Shag otpravki: 1 ms, chtoby temp byl rovnym i pri vysokoy skorosti
+const int SEND_INTERVAL_MS = 1;
+
+} // namespace
+
+LoadWorker::LoadWorker(const LoadProfile& profile, int firstClient, int clientCount,
+    LoadStats* stats, QObject* parent)
+    : QObject(parent)
+    , m_profile(profile)
+    , m_firstClient(firstClient)
+    , m_clientCount(clientCount)
+    , m_stats(stats)
+    , m_sendTimer(nullptr)
+    , m_random(static_cast<quint32>(firstClient + 1))
+    , m_sequence(0)
+    , m_sentHere(0)
+    , m_nextSender(0)
+{
+}
+
+LoadWorker::~LoadWorker() = default;
+
+int64_t LoadWorker::monotonicNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LoadWorker::start()
+{
+    // Sokety sozdayutsya v potoke rabochego, chtoby ikh sobytiya shli syuda zhe
+    m_clients.resize(m_clientCount);
+    for (int i = 0; i < m_clientCount; ++i) {
+        int number = m_firstClient + i;
+        Client& client = m_clients[i];
+        client.name = "user" + QByteArray::number(number);
+        client.room = ROOM_PREFIX + QByteArray("room") + QByteArray::number(number % m_profile.rooms);
+        client.socket = m_profile.tls ? new QSslSocket(this) : new QTcpSocket(this);
+        client.socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+        QTcpSocket* socket = client.socket;
+        auto login = [this, i]() {
+            Client& c = m_clients[i];
+            int64_t handshakeNs = monotonicNs() - c.connectStartNs;
+            m_stats->handshake.record(handshakeNs > 0 ? static_cast<uint64_t>(handshakeNs / 1000) : 0);
+            // Server chitaet "/join" i dalee tol'ko posle proverki parolya;
+            // klient gotov k otpravke posle otveta "/token"
+            c.socket->write(LOGIN_COMMAND + c.name + ' ' + m_profile.password + '\n'
+                + ROOM_JOIN_COMMAND + c.room + '\n');
+            if (m_profile.compress) {
+                uint dictionaryId = m_profile.dictionary ? m_profile.dictionary->id() : 0;
+                c.socket->write(COMPRESS_COMMAND + QByteArray("zstd ") + QByteArray::number(dictionaryId) + '\n');
+            }
+        };
+        connect(socket, &QTcpSocket::readyRead, this, [this, i]() {
+            readClient(m_clients[i]);
+        });
+        connect(socket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::error),
+            this, [this, i](QAbstractSocket::SocketError) {
+            Client& c = m_clients[i];
+            if (c.ready)
+                m_stats->connected.fetch_sub(1, std::memory_order_relaxed);
+            c.ready = false;
+            m_stats->errors.fetch_add(1, std::memory_order_relaxed);
+        });
+
+        client.connectStartNs = monotonicNs();
+        if (QSslSocket* sslSocket = qobject_cast<QSslSocket*>(socket)) {
+            // Sertifikat testovogo servera ne proveryaetsya
+            sslSocket->setPeerVerifyMode(QSslSocket::VerifyNone);
+            connect(sslSocket, &QSslSocket::encrypted, this, login);
+            sslSocket->connectToHostEncrypted(m_profile.host, m_profile.port);
+        }
+        else {
+            connect(socket, &QTcpSocket::connected, this, login);
+            socket->connectToHost(m_profile.host, m_profile.port);
+        }
+    }
+
+    m_clock.start();
+    m_sendTimer = new QTimer(this);
+    m_sendTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_sendTimer, &QTimer::timeout, this, &LoadWorker::sendDue);
+    m_sendTimer->start(SEND_INTERVAL_MS);
+}
+
+void LoadWorker::stop()
+{
+    if (m_sendTimer)
+        m_sendTimer->stop();
+
+    for (Client& client : m_clients) {
+        if (client.socket) {
+            client.socket->disconnect(this);
+            client.socket->abort();
+        }
+        client.ready = false;
+    }
+}
+
+void LoadWorker::sendDue()
+{
+    // Skol'ko soobshcheniy dolzhno byt' otpravleno k tekushchemu momentu
+    double elapsed = m_clock.nsecsElapsed() / 1e9;
+    uint64_t due = static_cast<uint64_t>(elapsed * m_profile.ratePerClient * m_clientCount);
+
+    int attempts = 0;
+    while (m_sentHere < due && attempts < m_clientCount) {
+        Client& client = m_clients[m_nextSender];
+        m_nextSender = (m_nextSender + 1) % m_clientCount;
+
+        if (!client.ready) {
+            ++attempts;
+            continue;
+        }
+        sendOne(client);
+        attempts = 0;
+    }
+
+    // Otstavshie klienty ne nakaplivayut dolg otpravki
+    if (m_sentHere < due)
+        m_sentHere = due;
+}
+
+void LoadWorker::sendOne(Client& client)
+{
+    int totalWeight = m_profile.privateWeight + m_profile.groupWeight + m_profile.broadcastWeight;
+    int pick = totalWeight > 0 ? static_cast<int>(m_random.bounded(totalWeight)) : 0;
+
+    QByteArray recipient;
+    if (pick < m_profile.privateWeight) {
+        int peer = static_cast<int>(m_random.bounded(m_profile.totalClients));
+        recipient = "user" + QByteArray::number(peer);
+    }
+    else if (pick < m_profile.privateWeight + m_profile.groupWeight) {
+        recipient = client.room;
+    }
+    else {
+        recipient = "all";
+    }
+
+    QByteArray frame;
+    frame.reserve(client.name.size() + recipient.size() + 48);
+    frame.append(client.name).append(" -> ").append(recipient).append(": ");
+    frame.append(QByteArray::number(++m_sequence)).append(' ');
+    frame.append(QByteArray::number(static_cast<qlonglong>(monotonicNs()))).append('\n');
+
+    client.socket->write(frame);
+    ++m_sentHere;
+    m_stats->sent.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LoadWorker::readClient(Client& client)
+{
+    // Do otveta na zapros szhatiya - obychnye stroki
+    while (!client.decoder && client.socket->canReadLine()) {
+        QByteArray line = client.socket->readLine();
+        while (line.endsWith('\n') || line.endsWith('\r'))
+            line.chop(1);
+        if (line.startsWith(COMPRESS_COMMAND))
+            startDecoding(line.mid(static_cast<int>(qstrlen(COMPRESS_COMMAND))), client);
+        else if (!line.isEmpty())
+            handleLine(line, client);
+    }
+    if (!client.decoder)
+        return;
+
+    QByteArray data = client.socket->readAll();
+    if (!client.decoder->feed(data.constData(), static_cast<size_t>(data.size()), client.decoded)) {
+        m_stats->errors.fetch_add(1, std::memory_order_relaxed);
+        client.socket->abort();
+        return;
+    }
+
+    size_t start = 0;
+    size_t end;
+    while ((end = client.decoded.find('\n', start)) != std::string::npos) {
+        QByteArray line(client.decoded.data() + start, static_cast<int>(end - start));
+        if (line.endsWith('\r'))
+            line.chop(1);
+        if (!line.isEmpty())
+            handleLine(line, client);
+        start = end + 1;
+    }
+    client.decoded.erase(0, start);
+}
+
+void LoadWorker::startDecoding(const QByteArray& reply, Client& client)
+{
+    // "zstd <id slovarya>" - dal'she kadry FrameCodec, "none" - stroki
+    QList<QByteArray> parts = reply.split(' ');
+    if (parts.size() < 2 || parts.at(0) != FrameCodec::algorithm())
+        return;
+
+    DictionaryPtr dictionary;
+    uint dictionaryId = parts.at(1).toUInt();
+    if (dictionaryId != 0 && m_profile.dictionary && m_profile.dictionary->id() == dictionaryId)
+        dictionary = m_profile.dictionary;
+    client.decoder = QSharedPointer<FrameDecoder>::create(dictionary);
+}
+
+void LoadWorker::handleLine(const QByteArray& line, Client& client)
+{
+    if (line == PING_COMMAND) {
+        client.socket->write(PONG_COMMAND "\n");
+        return;
+    }
+    if (line.startsWith(SESSION_TOKEN_COMMAND)) {
+        if (!client.ready)
+            m_stats->connected.fetch_add(1, std::memory_order_relaxed);
+        client.ready = true;
+        return;
+    }
+    if (line == LOGIN_DENIED_COMMAND) {
+        m_stats->errors.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ChatLine chatLine;
+    if (!parseChatLine(QString::fromUtf8(line), chatLine))
+        return;
+
+    // Tekst: "<nomer> <vremya otpravki>"
+    int space = chatLine.text.indexOf(' ');
+    if (space < 0)
+        return;
+
+    bool ok = false;
+    qlonglong sentNs = chatLine.text.midRef(space + 1).toLongLong(&ok);
+    if (!ok)
+        return;
+
+    int64_t latencyNs = monotonicNs() - sentNs;
+    m_stats->latency.record(latencyNs > 0 ? static_cast<uint64_t>(latencyNs / 1000) : 0);
+    m_stats->received.fetch_add(1, std::memory_order_relaxed);
+}
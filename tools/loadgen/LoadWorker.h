@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QSharedPointer>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "LatencyHistogram.h"
+#include "FrameCodec.h"
+
+// Obshchaya statistika vsekh potokov generatora nagruzki
+struct LoadStats {
+    std::atomic<uint64_t> connected{0};
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> errors{0};
+    LatencyHistogram latency;           // Mikrosekundy ot otpravki do dostavki
+    LatencyHistogram handshake;         // Mikrosekundy ot connect do gotovnosti (TCP ili TLS)
+};
+
+// Parametry nagruzki
+struct LoadProfile {
+    QString host;
+    quint16 port = 0;
+    int totalClients = 0;               // Vsego klientov vo vsekh potokakh
+    int rooms = 1;                      // Chislo komnat #room0..#roomN-1
+    double ratePerClient = 1.0;         // Soobshcheniy v sekundu na klienta
+    int privateWeight = 70;             // Dolya privatnykh soobshcheniy
+    int groupWeight = 25;               // Dolya soobshcheniy v komnatu
+    int broadcastWeight = 5;            // Dolya soobshcheniy dlya "all"
+    bool tls = false;                   // Soedineniya cherez QSslSocket
+    bool compress = false;              // Zapros szhatiya kadrov servera
+    DictionaryPtr dictionary;           // Slovar' szhatiya, esli zadan
+    QByteArray password;                // Parol' uchetnykh zapisey userN na servere
+};
+
+// Gruppa klientov, obsluzhivaemaya odnim potokom.
+// Klient N logtsya kak userN s obshchim parolem i vkhodit v komnatu #room(N % rooms);
+// tekst soobshcheniya - "<nomer> <vremya otpravki v ns>".
+class LoadWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    LoadWorker(const LoadProfile& profile, int firstClient, int clientCount,
+        LoadStats* stats, QObject* parent = nullptr);
+    ~LoadWorker() override;
+
+    // Monotonnoe vremya v nanosekundakh, obshchee dlya vsekh potokov
+    static int64_t monotonicNs();
+
+public slots:
+    void start();
+    void stop();
+
+private slots:
+    void sendDue();
+
+private:
+    struct Client {
+        QTcpSocket* socket = nullptr;
+        QByteArray name;
+        QByteArray room;
+        int64_t connectStartNs = 0;
+        QSharedPointer<FrameDecoder> decoder;   // Posle soglasovaniya szhatiya
+        std::string decoded;
+        bool ready = false;
+    };
+
+    void readClient(Client& client);
+    void handleLine(const QByteArray& line, Client& client);
+    void startDecoding(const QByteArray& reply, Client& client);
+    void sendOne(Client& client);
+
+    LoadProfile m_profile;
+    int m_firstClient;
+    int m_clientCount;
+    LoadStats* m_stats;
+
+    QVector<Client> m_clients;
+    QTimer* m_sendTimer;
+    QElapsedTimer m_clock;
+    QRandomGenerator m_random;
+    uint64_t m_sequence;
+    uint64_t m_sentHere;
+    int m_nextSender;
+};
@@ -0,0 +1,165 @@
+// loadgen_main.cpp : Generator nagruzki dlya chat-server.
+// Otkryvaet N soedineniy po loopback, logit klientov i otpravlyaet soobshcheniya
+// s zadannoy skorost'yu i smes'yu; pechataet propusknuyu sposobnost' i
+// protsentili zaderzhki ot otpravki do dostavki.
+// Uchetnye zapisi user0..userN-1 s parolem -password dolzhny byt' na servere:
+// chat-server -add-users user <N> <parol'> (pri ostanovlennom servere).
+// Vse klienty idut s odnogo adresa: server zapuskaetsya s podnyatymi
+// limitami, naprimer chat-server -max-per-address 10000 -address-rate 50000:100000.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QTextStream>
+#include <cstdio>
+#include "config.h"
+#include "LoadWorker.h"
+
+namespace {
+
+// Stroka otcheta o zaderzhke v mikrosekundakh
+QString latencySummary(const LatencyHistogram& latency)
+{
+    return QString("p50 %1 us, p99 %2 us, p999 %3 us, max %4 us")
+        .arg(latency.percentile(50.0))
+        .arg(latency.percentile(99.0))
+        .arg(latency.percentile(99.9))
+        .arg(latency.max());
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("chat-loadgen");
+    QCoreApplication::setApplicationVersion(APP_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generator nagruzki dlya chat-server");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption hostOption("host", "Adres servera", "host", "127.0.0.1");
+    QCommandLineOption portOption("port", "Port servera", "port", QString::number(SERVER_PORT));
+    QCommandLineOption clientsOption("clients", "Chislo soedineniy", "count", "1000");
+    QCommandLineOption threadsOption("threads", "Chislo potokov", "count",
+        QString::number(qMax(1, QThread::idealThreadCount())));
+    QCommandLineOption rateOption("rate", "Soobshcheniy v sekundu na klienta", "rate", "1");
+    QCommandLineOption durationOption("duration", "Dlitel'nost' v sekundakh", "seconds", "30");
+    QCommandLineOption mixOption("mix", "Smes' private:group:broadcast", "weights", "70:25:5");
+    QCommandLineOption roomsOption("rooms", "Chislo komnat", "count", "10");
+    QCommandLineOption tlsOption("tls", "Soedineniya cherez TLS (server zapushchen s -tls)");
+    QCommandLineOption compressOption("compress", "Zapros szhatiya kadrov servera (zstd)");
+    QCommandLineOption dictionaryOption("dictionary", "Slovar' szhatiya, kak u servera", "file");
+    QCommandLineOption passwordOption("password", "Parol' uchetnykh zapisey userN", "password", "loadgen");
+    parser.addOptions({ hostOption, portOption, clientsOption, threadsOption,
+        rateOption, durationOption, mixOption, roomsOption, tlsOption,
+        compressOption, dictionaryOption, passwordOption });
+    parser.process(app);
+
+    LoadProfile profile;
+    profile.host = parser.value(hostOption);
+    profile.port = parser.value(portOption).toUShort();
+    profile.totalClients = qMax(1, parser.value(clientsOption).toInt());
+    profile.rooms = qBound(1, parser.value(roomsOption).toInt(), MAX_GROUPS);
+    profile.ratePerClient = qMax(0.0, parser.value(rateOption).toDouble());
+    profile.tls = parser.isSet(tlsOption);
+    profile.compress = parser.isSet(compressOption);
+    profile.password = parser.value(passwordOption).toUtf8();
+    if (parser.isSet(dictionaryOption)) {
+        auto dictionary = std::make_shared<CompressionDictionary>();
+        if (!dictionary->loadFile(parser.value(dictionaryOption).toStdString())) {
+            std::fprintf(stderr, "Ne udalos' zagruzit' slovar' szhatiya\n");
+            return 1;
+        }
+        profile.dictionary = dictionary;
+    }
+
+    const QStringList mix = parser.value(mixOption).split(':');
+    if (mix.size() != 3) {
+        std::fprintf(stderr, "Nevernyy format --mix, ozhidaetsya private:group:broadcast\n");
+        return 1;
+    }
+    profile.privateWeight = qMax(0, mix.at(0).toInt());
+    profile.groupWeight = qMax(0, mix.at(1).toInt());
+    profile.broadcastWeight = qMax(0, mix.at(2).toInt());
+
+    int threadCount = qBound(1, parser.value(threadsOption).toInt(), profile.totalClients);
+    int duration = qMax(1, parser.value(durationOption).toInt());
+
+    LoadStats stats;
+
+    // Klienty delyatsya mezhdu potokami porovnu
+    QVector<QThread*> threads;
+    QVector<LoadWorker*> workers;
+    int firstClient = 0;
+    for (int i = 0; i < threadCount; ++i) {
+        int count = profile.totalClients / threadCount + (i < profile.totalClients % threadCount ? 1 : 0);
+        QThread* thread = new QThread;
+        LoadWorker* worker = new LoadWorker(profile, firstClient, count, &stats);
+        worker->moveToThread(thread);
+        QObject::connect(thread, &QThread::started, worker, &LoadWorker::start);
+        threads.append(thread);
+        workers.append(worker);
+        firstClient += count;
+    }
+
+    QTextStream out(stdout);
+    out << "chat-loadgen: " << profile.totalClients << " klientov, " << threadCount
+        << " potokov, " << profile.ratePerClient << " soobshch./s na klienta, smes' "
+        << parser.value(mixOption) << ", " << duration << " s" << endl;
+
+    for (QThread* thread : threads)
+        thread->start();
+
+    // Ezhesekundnyy progress
+    uint64_t lastSent = 0;
+    uint64_t lastReceived = 0;
+    int seconds = 0;
+    QTimer progressTimer;
+    QObject::connect(&progressTimer, &QTimer::timeout, &app, [&]() {
+        ++seconds;
+        uint64_t sent = stats.sent.load();
+        uint64_t received = stats.received.load();
+        out << QString("[%1 s] soedineno %2, otpravleno %3/s, polucheno %4/s, oshibok %5")
+            .arg(seconds, 3)
+            .arg(stats.connected.load())
+            .arg(sent - lastSent)
+            .arg(received - lastReceived)
+            .arg(stats.errors.load())
+            << endl;
+        lastSent = sent;
+        lastReceived = received;
+
+        if (seconds >= duration)
+            app.quit();
+    });
+    progressTimer.start(1000);
+
+    app.exec();
+
+    for (LoadWorker* worker : workers)
+        QMetaObject::invokeMethod(worker, "stop", Qt::BlockingQueuedConnection);
+    for (int i = 0; i < threads.size(); ++i) {
+        threads[i]->quit();
+        threads[i]->wait();
+        delete workers[i];
+        delete threads[i];
+    }
+
+    double elapsed = static_cast<double>(duration);
+    out << "Itog: otpravleno " << stats.sent.load()
+        << ", polucheno " << stats.received.load()
+        << ", oshibok " << stats.errors.load() << endl;
+    out << "Propusknaya sposobnost': " << QString::number(stats.sent.load() / elapsed, 'f', 1)
+        << " otpr./s, " << QString::number(stats.received.load() / elapsed, 'f', 1)
+        << " dost./s" << endl;
+    out << "Zaderzhka: " << latencySummary(stats.latency) << endl;
+    out << (profile.tls ? "Rukopozhatie TLS: " : "Podklyuchenie TCP: ")
+        << latencySummary(stats.handshake) << endl;
+
+    return 0;
+}